@@ -1,29 +1,190 @@
 const {deviceEndpoints, temperature} = require('zigbee-herdsman-converters/lib/modernExtend');
 const reporting = require('zigbee-herdsman-converters/lib/reporting');
 
+// Number of DS18B20 probes on the node, the firmware creates endpoints 10, 11, ... one per probe
+const SENSOR_COUNT = 2;
+const FIRST_ENDPOINT = 10;
+
+const endpointIds = Array.from({length: SENSOR_COUNT}, (_, i) => FIRST_ENDPOINT + i);
+const endpointNames = endpointIds.map((id) => id.toString());
+
+// Manufacturer specific attribute 0x8000 on msTemperatureMeasurement carries the samples taken while the node
+// was off the network: u8 version, u8 sensor, u8 count, u32 age of the first sample (s),
+// then count * {u16 seconds since the previous sample, s16 centi-degrees}, all little endian
+const HISTORY_ATTRIBUTE_ID = 0x8000;
+
+const fzHistory = {
+    cluster: 'msTemperatureMeasurement',
+    type: ['attributeReport', 'readResponse'],
+    convert: (model, msg, publish, options, meta) => {
+        const frame = msg.data[HISTORY_ATTRIBUTE_ID];
+        if (!frame || frame.length < 7 || frame[0] !== 1) return;
+
+        const count = frame[2];
+        const receivedAt = Date.now();
+        let age = frame.readUInt32LE(3);
+        const samples = [];
+        for (let i = 0; i < count && 7 + i * 4 + 4 <= frame.length; i++) {
+            age -= frame.readUInt16LE(7 + i * 4);
+            samples.push({time: new Date(receivedAt - age * 1000).toISOString(),
+                          temperature: frame.readInt16LE(7 + i * 4 + 2) / 100});
+        }
+        return {[`history_${msg.endpoint.ID}`]: samples};
+    },
+};
+
+// Manufacturer specific window statistics on msTemperatureMeasurement of every endpoint, 0x8100 + 0x10 * window + field,
+// the windows follow ESP_TEMP_STATS_WINDOWS_S in main.h. 0x8000 (-327.68) marks a window without samples
+const STATS_WINDOWS = ['5min', '1h', '24h'];
+const STATS_FIELDS = ['min', 'max', 'mean', 'stddev', 'count'];
+
+const fzStats = {
+    cluster: 'msTemperatureMeasurement',
+    type: ['attributeReport', 'readResponse'],
+    convert: (model, msg, publish, options, meta) => {
+        const result = {};
+        for (const [key, value] of Object.entries(msg.data)) {
+            const id = Number(key);
+            if (id < 0x8100 || id >= 0x8100 + STATS_WINDOWS.length * 0x10 || (id & 0x0F) >= STATS_FIELDS.length) continue;
+            const window = STATS_WINDOWS[(id - 0x8100) >> 4];
+            const field = STATS_FIELDS[id & 0x0F];
+            if (field !== 'count' && value === -0x8000) continue;
+            result[`${field}_${window}_${msg.endpoint.ID}`] = field === 'count' ? value : value / 100;
+        }
+        return result;
+    },
+};
+
+// Manufacturer specific 1-Wire error counters on msTemperatureMeasurement of every endpoint, 0x8200 + field (u32),
+// see CUSTOM_TEMP_BUS_STATS_ATTR_ID in main.h
+const BUS_STATS_FIELDS = ['reads', 'crc_errors', 'bus_errors', 'power_on_values', 'retries', 'quarantines'];
+
+const fzBusStats = {
+    cluster: 'msTemperatureMeasurement',
+    type: ['attributeReport', 'readResponse'],
+    convert: (model, msg, publish, options, meta) => {
+        const result = {};
+        for (const [key, value] of Object.entries(msg.data)) {
+            const id = Number(key);
+            if (id < 0x8200 || id >= 0x8200 + BUS_STATS_FIELDS.length) continue;
+            result[`${BUS_STATS_FIELDS[id - 0x8200]}_${msg.endpoint.ID}`] = value;
+        }
+        return result;
+    },
+};
+
+// Manufacturer specific attribute 0x8005 on msTemperatureMeasurement: network time of the last sample in MeasuredValue,
+// seconds since 2000-01-01 UTC as read from the coordinator's Time cluster, 0xFFFFFFFF until the first sync
+const TIMESTAMP_ATTRIBUTE_ID = 0x8005;
+const ZCL_EPOCH_MS = Date.UTC(2000, 0, 1);
+
+const fzTimestamp = {
+    cluster: 'msTemperatureMeasurement',
+    type: ['attributeReport', 'readResponse'],
+    convert: (model, msg, publish, options, meta) => {
+        const seconds = msg.data[TIMESTAMP_ATTRIBUTE_ID];
+        if (seconds === undefined || seconds === 0xFFFFFFFF) return;
+        return {[`sampled_at_${msg.endpoint.ID}`]: new Date(ZCL_EPOCH_MS + seconds * 1000).toISOString()};
+    },
+};
+
+// Manufacturer specific latency statistics on the Diagnostics cluster of the first endpoint, see latency_stats.h
+const LATENCY_PHASES = ['trigger', 'conversion', 'read', 'cycle', 'queue', 'attr_set', 'slot'];
+const LATENCY_FIELDS = ['count', 'mean_us', 'max_us', 'histogram'];
+const LATENCY_COUNTERS = ['lock_busy'];
+// Commissioning metrics on the same cluster, see CUSTOM_DIAG_REJOIN_ATTR_ID in main.h
+const REJOIN_FIELDS = ['rejoin_last_ms', 'rejoin_last_attempts', 'rejoin_total_attempts', 'rejoin_joins'];
+// Network time metrics, see CUSTOM_DIAG_TIME_ATTR_ID in main.h
+const TIME_FIELDS = ['time_syncs', 'time_steps', 'time_uncertainty_us', 'time_skew_ppb', 'time_correction_us'];
+const MANUFACTURER_CODE = 0x131B;
+
+// Reporting configuration of every diagnostics attribute above, the firmware refreshes them once a minute
+// (ESP_TEMP_DIAGNOSTICS_PERIOD_MS in main.h)
+const diagnosticsReporting = () => {
+    const U32 = 0x23, S32 = 0x2b, OCTET_STRING = 0x41;
+    const attributes = [];
+    LATENCY_PHASES.forEach((_, phase) => LATENCY_FIELDS.forEach((field, i) =>
+        attributes.push({ID: 0x4000 + phase * 0x10 + i, type: field === 'histogram' ? OCTET_STRING : U32})));
+    LATENCY_COUNTERS.forEach((_, i) => attributes.push({ID: 0x4100 + i, type: U32}));
+    REJOIN_FIELDS.forEach((_, i) => attributes.push({ID: 0x4200 + i, type: U32}));
+    TIME_FIELDS.forEach((field, i) =>
+        attributes.push({ID: 0x4300 + i, type: ['time_skew_ppb', 'time_correction_us'].includes(field) ? S32 : U32}));
+    return attributes.map((attribute) => ({
+        attribute,
+        minimumReportInterval: 60,
+        maximumReportInterval: 3600,
+        reportableChange: 0,
+    }));
+};
+
+const fzLatency = {
+    cluster: 'haDiagnostic',
+    type: ['attributeReport', 'readResponse'],
+    convert: (model, msg, publish, options, meta) => {
+        const result = {};
+        for (const [key, value] of Object.entries(msg.data)) {
+            const id = Number(key);
+            if (id >= 0x4000 && id < 0x4000 + LATENCY_PHASES.length * 0x10 && (id & 0x0F) < LATENCY_FIELDS.length) {
+                const phase = LATENCY_PHASES[(id - 0x4000) >> 4];
+                const field = LATENCY_FIELDS[id & 0x0F];
+                result[`latency_${phase}_${field}`] = field === 'histogram'
+                    ? Array.from({length: value.length / 2}, (_, i) => value.readUInt16LE(i * 2)) : value;
+            } else if (id >= 0x4100 && id < 0x4100 + LATENCY_COUNTERS.length) {
+                result[LATENCY_COUNTERS[id - 0x4100]] = value;
+            } else if (id >= 0x4200 && id < 0x4200 + REJOIN_FIELDS.length) {
+                result[REJOIN_FIELDS[id - 0x4200]] = value;
+            } else if (id >= 0x4300 && id < 0x4300 + TIME_FIELDS.length) {
+                result[TIME_FIELDS[id - 0x4300]] = value;
+            }
+        }
+        return result;
+    },
+};
+
+// Manufacturer specific attribute 0x8006 on msTemperatureMeasurement of the first endpoint: a non-zero write makes the
+// node print its trace log to the serial port, decode it with tools/trace_decode.py
+const TRACE_DUMP_ATTRIBUTE_ID = 0x8006;
+
+const tzTraceDump = {
+    key: ['trace_dump'],
+    convertSet: async (entity, key, value, meta) => {
+        await meta.device.getEndpoint(FIRST_ENDPOINT).write('msTemperatureMeasurement',
+            {[TRACE_DUMP_ATTRIBUTE_ID]: {value: 1, type: 0x20}}, {manufacturerCode: MANUFACTURER_CODE});  // u8
+    },
+};
+
 const definition = {
     zigbeeModel: ['esp32c6'],
     model: 'esp32c6',
     vendor: 'ESPRESSIF',
     description: 'Automatically generated definition',
     extend: [
-        deviceEndpoints({"endpoints": {"10": 10, "11": 11}}),
-        temperature({"endpointNames": ["10", "11"]})
+        deviceEndpoints({"endpoints": Object.fromEntries(endpointIds.map((id) => [id.toString(), id]))}),
+        temperature({"endpointNames": endpointNames})
     ],
+    fromZigbee: [fzHistory, fzStats, fzBusStats, fzTimestamp, fzLatency],
+    toZigbee: [tzTraceDump],
     meta: {"multiEndpoint": true},
     
     configure: async (device, coordinatorEndpoint, logger) => {
-        // Get both endpoints for the two sensors
-        const endpoint10 = device.getEndpoint(10); // Endpoint for sensor 1
-        const endpoint11 = device.getEndpoint(11); // Endpoint for sensor 2
+        // Bind every sensor endpoint to the coordinator and configure temperature reporting
+        for (const id of endpointIds) {
+            const endpoint = device.getEndpoint(id);
+            if (!endpoint) continue;  // Fewer probes attached than SENSOR_COUNT
 
-        // Bind both endpoints to the coordinator and configure temperature reporting
-        await reporting.bind(endpoint10, coordinatorEndpoint, ['msTemperatureMeasurement']);
-        await reporting.temperature(endpoint10, {min: 30, max: 600, change: 5});   // Set up reporting for sensor 1 (every 30s to 10min, 0.5°C change)
+            await reporting.bind(endpoint, coordinatorEndpoint, ['msTemperatureMeasurement']);
+            await reporting.temperature(endpoint, {min: 30, max: 600, change: 50});  // Every 30s to 10min, 0.5°C change (centi-degrees)
+        }
 
-        await reporting.bind(endpoint11, coordinatorEndpoint, ['msTemperatureMeasurement']);
-        await reporting.temperature(endpoint11, {min: 30, max: 600, change: 5});  // Set up reporting for sensor 2 (every 30s to 10min, 0.5°C change)
+        // The node-wide diagnostics live on the first endpoint only, a few attributes per request to stay
+        // within one frame
+        const first = device.getEndpoint(FIRST_ENDPOINT);
+        await reporting.bind(first, coordinatorEndpoint, ['haDiagnostic']);
+        const diagnostics = diagnosticsReporting();
+        for (let i = 0; i < diagnostics.length; i += 4) {
+            await first.configureReporting('haDiagnostic', diagnostics.slice(i, i + 4), {manufacturerCode: MANUFACTURER_CODE});
+        }
     },
 };
 
-module.exports = definition;
\ No newline at end of file
+module.exports = definition;
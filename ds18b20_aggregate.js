@@ -0,0 +1,62 @@
+const {deviceEndpoints, temperature} = require('zigbee-herdsman-converters/lib/modernExtend');
+const reporting = require('zigbee-herdsman-converters/lib/reporting');
+
+// Converter for firmware built with ESP_TEMP_AGGREGATE_REPORT set to 1, use it instead of ds18b20.js.
+// Number of DS18B20 probes on the node, the firmware creates endpoints 10, 11, ... one per probe
+const SENSOR_COUNT = 2;
+const FIRST_ENDPOINT = 10;
+
+const endpointIds = Array.from({length: SENSOR_COUNT}, (_, i) => FIRST_ENDPOINT + i);
+const endpointNames = endpointIds.map((id) => id.toString());
+
+// Manufacturer specific attribute 0x8004 on msTemperatureMeasurement of the first endpoint carries all sensors
+// in one frame: u8 version, u8 count, then count * s16 centi-degrees, little endian. 0x8000 marks a sensor
+// without a valid reading. See main/aggregate_frame.h
+const AGGREGATE_ATTRIBUTE_ID = 0x8004;
+const AGGREGATE_INVALID = -0x8000;
+const MANUFACTURER_CODE = 0x131B;
+
+const fzAggregate = {
+    cluster: 'msTemperatureMeasurement',
+    type: ['attributeReport', 'readResponse'],
+    convert: (model, msg, publish, options, meta) => {
+        const frame = msg.data[AGGREGATE_ATTRIBUTE_ID];
+        if (!frame || frame.length < 2 || frame[0] !== 1) return;
+
+        const result = {};
+        for (let i = 0; i < frame[1] && 2 + i * 2 + 2 <= frame.length; i++) {
+            const value = frame.readInt16LE(2 + i * 2);
+            if (value !== AGGREGATE_INVALID) {
+                result[`temperature_${FIRST_ENDPOINT + i}`] = value / 100;
+            }
+        }
+        return result;
+    },
+};
+
+const definition = {
+    zigbeeModel: ['esp32c6'],
+    model: 'esp32c6',
+    vendor: 'ESPRESSIF',
+    description: 'Automatically generated definition, aggregate reporting',
+    extend: [
+        deviceEndpoints({"endpoints": Object.fromEntries(endpointIds.map((id) => [id.toString(), id]))}),
+        temperature({"endpointNames": endpointNames, "reporting": false})
+    ],
+    fromZigbee: [fzAggregate],
+    meta: {"multiEndpoint": true},
+
+    configure: async (device, coordinatorEndpoint, logger) => {
+        // One binding and one reporting configuration for all sensors, on the first endpoint
+        const endpoint = device.getEndpoint(FIRST_ENDPOINT);
+        await reporting.bind(endpoint, coordinatorEndpoint, ['msTemperatureMeasurement']);
+        await endpoint.configureReporting('msTemperatureMeasurement', [{
+            attribute: {ID: AGGREGATE_ATTRIBUTE_ID, type: 0x41},  // Octet string
+            minimumReportInterval: 30,
+            maximumReportInterval: 600,
+            reportableChange: 0,
+        }], {manufacturerCode: MANUFACTURER_CODE});  // Every 30s to 10min, the firmware filters changes below 0.5°C
+    },
+};
+
+module.exports = definition;
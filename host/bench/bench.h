@@ -0,0 +1,24 @@
+// bench.h
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Benchmarks of the host build. Two clocks: the CPU time the firmware code takes on the host (relative numbers,
+ * the ESP32-C6 is a lot slower) and the simulated clock, which counts bus slots and conversion waits like the
+ * target spends them. One result per line, "name value unit", so runs can be diffed.
+ */
+
+static inline int64_t bench_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#define BENCH_RESULT(name, value, unit) \
+    printf("%-48s %12.2f %s\n", (name), (double)(value), (unit))
+
+#endif // BENCH_H
@@ -0,0 +1,99 @@
+// bench_alarm_search.c: bus time of a sampling cycle with TH/TL thresholds on every probe, where one Alarm Search
+// after the broadcast conversion picks the probes to read and the others are read every
+// ESP_TEMP_SENSOR_ALARM_SLOW_CYCLES cycles, against the same bus without thresholds, where every probe is read
+// Usage: bench_alarm_search [sensors] [all | probes in alarm]
+
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "sim_node.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "ds18b20_sensor.h"
+#include "latency_stats.h"
+#include "main.h"
+
+#define BENCH_CYCLES        (10 * ESP_TEMP_SENSOR_ALARM_SLOW_CYCLES)
+#define BENCH_ALARM_LOW     10
+#define BENCH_ALARM_HIGH    30
+
+static uint32_t bench_sensor_reads(int sensor_num) {
+    uint32_t reads = 0;
+    for (int i = 0; i < sensor_num; i++) {
+        ds18b20_sensor_stats_t stats;
+        if (ds18b20_get_sensor_stats(i, &stats) == ESP_OK) {
+            reads += stats.reads;
+        }
+    }
+    return reads;
+}
+
+int main(int argc, char **argv) {
+    int sensor_num = argc > 1 ? atoi(argv[1]) : 64;
+    bool thresholds = argc <= 2 || strcmp(argv[2], "all") != 0;
+    int alarm_num = thresholds && argc > 2 ? atoi(argv[2]) : 0;
+    if (sensor_num > DS18B20_MAX_SENSORS || alarm_num > sensor_num) {
+        return 1;
+    }
+
+    // The probes in alarm are spread over the ROM codes, so the search walks branches all over the tree
+    int bus = onewire_sim_add_bus(0);
+    for (int i = 0; i < sensor_num; i++) {
+        bool alarming = alarm_num > 0 && i % (sensor_num / alarm_num) == 0 && i / (sensor_num / alarm_num) < alarm_num;
+        onewire_sim_add_device(bus, onewire_sim_rom(0x3000 + i), alarming ? 35.0 : 20.0 + (i % 8) * 0.25);
+    }
+    if (sim_node_init() != ESP_OK || ds18b20_get_sensor_count() != sensor_num) {
+        return 1;
+    }
+    sim_node_stack_started(ESP_OK, false);
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 0};
+    for (int i = 0; i < sensor_num; i++) {
+        zigbee_fake_set_temperature_reporting(HA_ESP_SENSOR_ENDPOINT + i, &reporting);
+    }
+    sensor_app_reporting_configured();
+
+    // The coordinator writes the thresholds, the sampler programs one probe per cycle
+    int16_t alarm_low = BENCH_ALARM_LOW * 100;
+    int16_t alarm_high = BENCH_ALARM_HIGH * 100;
+    for (int i = 0; thresholds && i < sensor_num; i++) {
+        sensor_app_attr_written(HA_ESP_SENSOR_ENDPOINT + i, CUSTOM_TEMP_ALARM_LOW_ATTRIBUTE_ID, &alarm_low);
+        sensor_app_attr_written(HA_ESP_SENSOR_ENDPOINT + i, CUSTOM_TEMP_ALARM_HIGH_ATTRIBUTE_ID, &alarm_high);
+    }
+    sim_node_run_for_ms((sensor_num + ESP_TEMP_SENSOR_ALARM_SLOW_CYCLES) * ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS);
+
+    onewire_sim_reset_stats(bus);
+    latency_histogram_t before;
+    latency_stats_get(LATENCY_PHASE_CYCLE, &before);
+    uint32_t reads_before = bench_sensor_reads(sensor_num);
+    sim_node_run_for_ms(BENCH_CYCLES * ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS);
+
+    latency_histogram_t after;
+    latency_stats_get(LATENCY_PHASE_CYCLE, &after);
+    onewire_sim_stats_t stats;
+    onewire_sim_get_stats(bus, &stats);
+    uint32_t cycles = after.count - before.count;
+    if (cycles == 0) {
+        return 1;
+    }
+
+    double reads = (double)(bench_sensor_reads(sensor_num) - reads_before) / cycles;
+    if (thresholds && reads >= sensor_num) {
+        return 1;  // The thresholds never took effect
+    }
+
+    char prefix[48];
+    char name[80];
+    if (thresholds) {
+        snprintf(prefix, sizeof(prefix), "alarm_search/%d_sensors/%d_in_alarm", sensor_num, alarm_num);
+    } else {
+        snprintf(prefix, sizeof(prefix), "alarm_search/%d_sensors/no_thresholds", sensor_num);
+    }
+    snprintf(name, sizeof(name), "%s/reads", prefix);
+    BENCH_RESULT(name, reads, "per_cycle");
+    snprintf(name, sizeof(name), "%s/bus_time", prefix);
+    BENCH_RESULT(name, stats.bus_time_us / 1000.0 / cycles, "ms");
+    snprintf(name, sizeof(name), "%s/latency", prefix);
+    BENCH_RESULT(name, (after.total_us - before.total_us) / 1000.0 / cycles, "ms");
+    return 0;
+}
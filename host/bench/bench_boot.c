@@ -0,0 +1,55 @@
+// bench_boot.c: sensor discovery at boot, a full ROM search of the bus against the ROM codes cached in NVS by the
+// boot before, where a Match-ROM per sensor confirms that every cached probe is still there
+// Usage: bench_boot [sensors]
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_clock.h"
+#include "sim_nvs.h"
+#include "onewire_sim.h"
+#include "ds18b20_sensor.h"
+
+// One ds18b20_init(), its simulated duration and the bus time it took
+static int bench_boot(int bus, int sensor_num, int64_t *boot_us, int64_t *bus_time_us) {
+    onewire_sim_reset_stats(bus);
+    int64_t start_us = sim_clock_now_us();
+    if (ds18b20_init() != ESP_OK || ds18b20_get_sensor_count() != sensor_num) {
+        return 1;
+    }
+    *boot_us = sim_clock_now_us() - start_us;
+    onewire_sim_stats_t stats;
+    onewire_sim_get_stats(bus, &stats);
+    *bus_time_us = stats.bus_time_us;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int sensor_num = argc > 1 ? atoi(argv[1]) : 8;
+    int bus = onewire_sim_add_bus(0);
+    for (int i = 0; i < sensor_num; i++) {
+        onewire_sim_add_device(bus, onewire_sim_rom(0x7000 + i), 20.0 + i * 0.25);
+    }
+
+    // The very first boot also clears the factory TH/TL of every new probe in its EEPROM, a one-off that
+    // would swamp the search. Boot once to get past it, then wipe NVS for the search
+    int64_t search_us, search_bus_us, cached_us, cached_bus_us;
+    if (bench_boot(bus, sensor_num, &search_us, &search_bus_us) != 0) {
+        return 1;
+    }
+    sim_nvs_erase();
+    if (bench_boot(bus, sensor_num, &search_us, &search_bus_us) != 0
+        || bench_boot(bus, sensor_num, &cached_us, &cached_bus_us) != 0) {
+        return 1;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "boot/%d_sensors/search", sensor_num);
+    BENCH_RESULT(name, search_us / 1000.0, "ms");
+    snprintf(name, sizeof(name), "boot/%d_sensors/search_bus_time", sensor_num);
+    BENCH_RESULT(name, search_bus_us / 1000.0, "ms");
+    snprintf(name, sizeof(name), "boot/%d_sensors/cached", sensor_num);
+    BENCH_RESULT(name, cached_us / 1000.0, "ms");
+    snprintf(name, sizeof(name), "boot/%d_sensors/cached_bus_time", sensor_num);
+    BENCH_RESULT(name, cached_bus_us / 1000.0, "ms");
+    return 0;
+}
@@ -0,0 +1,98 @@
+// bench_broadcast.c: one sampling cycle the old way, a Match-ROM Convert-T and a full conversion wait per sensor,
+// against one Skip-ROM Convert-T for the bus followed by the scratchpad reads (ds18b20_trigger_conversion_all())
+// Usage: bench_broadcast [sensors]
+
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "sim_clock.h"
+#include "onewire_sim.h"
+#include "onewire_hal.h"
+#include "onewire_cmd.h"
+#include "ds18b20_sensor.h"
+
+#define BENCH_CYCLES            10
+#define DS18B20_CMD_CONVERT_T   0x44
+#define DS18B20_CMD_READ_SCRATCHPAD 0xBE
+
+// Reset and address one device by its ROM code, then send a function command
+static void bench_match_rom(onewire_bus_handle_t bus, onewire_device_address_t rom, uint8_t command) {
+    uint8_t tx[1 + sizeof(rom) + 1] = {ONEWIRE_CMD_MATCH_ROM};
+    memcpy(&tx[1], &rom, sizeof(rom));  // LSB (family code) first
+    tx[1 + sizeof(rom)] = command;
+    onewire_bus_reset(bus);
+    onewire_bus_write_bytes(bus, tx, sizeof(tx));
+}
+
+// The per-sensor path the driver had before the broadcast: convert, wait, read, one sensor after the other
+static void bench_sequential_cycle(onewire_bus_handle_t bus, const onewire_device_address_t *roms, int sensor_num) {
+    for (int i = 0; i < sensor_num; i++) {
+        bench_match_rom(bus, roms[i], DS18B20_CMD_CONVERT_T);
+        sim_clock_advance_us((int64_t)ds18b20_resolution_conversion_time_ms(DS18B20_RESOLUTION_12B) * 1000);
+        bench_match_rom(bus, roms[i], DS18B20_CMD_READ_SCRATCHPAD);
+        uint8_t scratchpad[9];
+        onewire_bus_read_bytes(bus, scratchpad, sizeof(scratchpad));
+    }
+}
+
+static void bench_broadcast_cycle(int sensor_num) {
+    ds18b20_trigger_conversion_all();
+    sim_clock_advance_us((int64_t)ds18b20_get_conversion_time_ms() * 1000);
+    for (int i = 0; i < sensor_num; i++) {
+        int16_t temperature;
+        ds18b20_read_conversion_result(i, &temperature);
+    }
+}
+
+int main(int argc, char **argv) {
+    int sensor_num = argc > 1 ? atoi(argv[1]) : 8;
+    int sim_bus = onewire_sim_add_bus(0);
+    onewire_device_address_t roms[ONEWIRE_SIM_MAX_DEVICES];
+    for (int i = 0; i < sensor_num; i++) {
+        roms[i] = onewire_sim_rom(0x6000 + i);
+        onewire_sim_add_device(sim_bus, roms[i], 20.0 + i * 0.25);
+    }
+    if (ds18b20_init() != ESP_OK || ds18b20_get_sensor_count() != sensor_num) {
+        return 1;
+    }
+    onewire_bus_handle_t bus;
+    if (onewire_hal_new_bus(0, &bus) != ESP_OK) {
+        return 1;
+    }
+
+    char name[64];
+    int64_t start_us = sim_clock_now_us();
+    int64_t cpu_start_ns = bench_cpu_ns();
+    for (int cycle = 0; cycle < BENCH_CYCLES; cycle++) {
+        bench_sequential_cycle(bus, roms, sensor_num);
+    }
+    int64_t cpu_ns = bench_cpu_ns() - cpu_start_ns;
+    int64_t sequential_us = (sim_clock_now_us() - start_us) / BENCH_CYCLES;
+    snprintf(name, sizeof(name), "cycle/%d_sensors/sequential", sensor_num);
+    BENCH_RESULT(name, sequential_us / 1000.0, "ms");
+    snprintf(name, sizeof(name), "cycle/%d_sensors/sequential_host_cpu", sensor_num);
+    BENCH_RESULT(name, cpu_ns / 1000.0 / BENCH_CYCLES, "us");
+
+    start_us = sim_clock_now_us();
+    cpu_start_ns = bench_cpu_ns();
+    for (int cycle = 0; cycle < BENCH_CYCLES; cycle++) {
+        bench_broadcast_cycle(sensor_num);
+    }
+    cpu_ns = bench_cpu_ns() - cpu_start_ns;
+    int64_t broadcast_us = (sim_clock_now_us() - start_us) / BENCH_CYCLES;
+    snprintf(name, sizeof(name), "cycle/%d_sensors/broadcast", sensor_num);
+    BENCH_RESULT(name, broadcast_us / 1000.0, "ms");
+    snprintf(name, sizeof(name), "cycle/%d_sensors/broadcast_host_cpu", sensor_num);
+    BENCH_RESULT(name, cpu_ns / 1000.0 / BENCH_CYCLES, "us");
+    snprintf(name, sizeof(name), "cycle/%d_sensors/speedup", sensor_num);
+    BENCH_RESULT(name, (double)sequential_us / broadcast_us, "x");
+
+    // Every reading made it through, so both paths did the same work
+    ds18b20_sensor_stats_t stats;
+    for (int i = 0; i < sensor_num; i++) {
+        if (ds18b20_get_sensor_stats(i, &stats) != ESP_OK || stats.reads != BENCH_CYCLES) {
+            return 1;
+        }
+    }
+    return broadcast_us < sequential_us || sensor_num < 2 ? 0 : 1;
+}
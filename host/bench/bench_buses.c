@@ -0,0 +1,70 @@
+// bench_buses.c: the limit of a second bus, the same sensors spread over the 1-Wire buses of the build
+// (DS18B20_ONEWIRE_BUS_GPIOS). The conversions of all buses overlap, the scratchpad reads take turns, so the cycle
+// latency stays the same. Only the time each bus is busy drops, the busiest bus is what the cycle would cost if
+// the reads overlapped too
+// Usage: bench_buses [sensors]
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_node.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "ds18b20_sensor.h"
+#include "latency_stats.h"
+#include "main.h"
+
+#define BENCH_CYCLES    100
+
+static const int bench_bus_gpios[] = {DS18B20_ONEWIRE_BUS_GPIOS};
+#define BENCH_BUS_NUM   (int)(sizeof(bench_bus_gpios) / sizeof(bench_bus_gpios[0]))
+
+int main(int argc, char **argv) {
+    int sensor_num = argc > 1 ? atoi(argv[1]) : 16;
+    int buses[BENCH_BUS_NUM];
+    for (int b = 0; b < BENCH_BUS_NUM; b++) {
+        buses[b] = onewire_sim_add_bus(bench_bus_gpios[b]);
+    }
+    for (int i = 0; i < sensor_num; i++) {
+        onewire_sim_add_device(buses[i % BENCH_BUS_NUM], onewire_sim_rom(0x8000 + i), 20.0 + i * 0.25);
+    }
+    if (sim_node_init() != ESP_OK || ds18b20_get_bus_count() != BENCH_BUS_NUM) {
+        return 1;
+    }
+    sim_node_stack_started(ESP_OK, false);
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 0};
+    for (int i = 0; i < sensor_num; i++) {
+        zigbee_fake_set_temperature_reporting(HA_ESP_SENSOR_ENDPOINT + i, &reporting);
+    }
+    sensor_app_reporting_configured();
+    sim_node_run_for_ms(10000);
+
+    for (int b = 0; b < BENCH_BUS_NUM; b++) {
+        onewire_sim_reset_stats(buses[b]);
+    }
+    latency_histogram_t before, after;
+    latency_stats_get(LATENCY_PHASE_CYCLE, &before);
+    sim_node_run_for_ms(BENCH_CYCLES * ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS);
+    latency_stats_get(LATENCY_PHASE_CYCLE, &after);
+    uint32_t cycles = after.count - before.count;
+    if (cycles == 0) {
+        return 1;
+    }
+
+    int64_t bus_time_us = 0, busiest_us = 0;
+    for (int b = 0; b < BENCH_BUS_NUM; b++) {
+        onewire_sim_stats_t stats;
+        onewire_sim_get_stats(buses[b], &stats);
+        bus_time_us += stats.bus_time_us;
+        busiest_us = stats.bus_time_us > busiest_us ? stats.bus_time_us : busiest_us;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "cycle/%d_sensors/%d_buses/latency", sensor_num, BENCH_BUS_NUM);
+    BENCH_RESULT(name, (after.total_us - before.total_us) / 1000.0 / cycles, "ms");
+    snprintf(name, sizeof(name), "cycle/%d_sensors/%d_buses/bus_time", sensor_num, BENCH_BUS_NUM);
+    BENCH_RESULT(name, bus_time_us / 1000.0 / cycles, "ms");
+    snprintf(name, sizeof(name), "cycle/%d_sensors/%d_buses/busiest_bus", sensor_num, BENCH_BUS_NUM);
+    BENCH_RESULT(name, busiest_us / 1000.0 / cycles, "ms");
+    return 0;
+}
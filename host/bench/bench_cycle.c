@@ -0,0 +1,56 @@
+// bench_cycle.c: cost of one sampling cycle, host CPU time of the firmware and simulated bus time
+// Usage: bench_cycle [sensors]
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_node.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "latency_stats.h"
+#include "main.h"
+
+#define BENCH_CYCLES    200
+
+int main(int argc, char **argv) {
+    int sensor_num = argc > 1 ? atoi(argv[1]) : 8;
+    int bus = onewire_sim_add_bus(0);
+    for (int i = 0; i < sensor_num; i++) {
+        onewire_sim_add_device(bus, onewire_sim_rom(0x2000 + i), 20.0 + i * 0.25);
+    }
+    if (sim_node_init() != ESP_OK) {
+        return 1;
+    }
+    sim_node_stack_started(ESP_OK, false);
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 0};
+    for (int i = 0; i < sensor_num; i++) {
+        zigbee_fake_set_temperature_reporting(HA_ESP_SENSOR_ENDPOINT + i, &reporting);
+    }
+    sensor_app_reporting_configured();
+    sim_node_run_for_ms(10000);
+
+    onewire_sim_reset_stats(bus);
+    latency_histogram_t before;
+    latency_stats_get(LATENCY_PHASE_CYCLE, &before);
+    int64_t cpu_start_ns = bench_cpu_ns();
+    sim_node_run_for_ms(BENCH_CYCLES * ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS);
+    int64_t cpu_ns = bench_cpu_ns() - cpu_start_ns;
+
+    latency_histogram_t after;
+    latency_stats_get(LATENCY_PHASE_CYCLE, &after);
+    onewire_sim_stats_t stats;
+    onewire_sim_get_stats(bus, &stats);
+    uint32_t cycles = after.count - before.count;
+    if (cycles == 0) {
+        return 1;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "cycle/%d_sensors/host_cpu", sensor_num);
+    BENCH_RESULT(name, cpu_ns / 1000.0 / cycles, "us");
+    snprintf(name, sizeof(name), "cycle/%d_sensors/bus_time", sensor_num);
+    BENCH_RESULT(name, stats.bus_time_us / 1000.0 / cycles, "ms");
+    snprintf(name, sizeof(name), "cycle/%d_sensors/latency", sensor_num);
+    BENCH_RESULT(name, (after.total_us - before.total_us) / 1000.0 / cycles, "ms");
+    return 0;
+}
@@ -0,0 +1,40 @@
+// bench_raw_conversion.c: raw to centi-degrees in integer arithmetic against the float version it replaced,
+// per conversion and per 32-sensor cycle. The host has an FPU, the ESP32-C6 does not: there every float
+// operation is a soft-float library call, so the host ratio understates the saving on the target
+
+#include <math.h>
+#include "bench.h"
+#include "ds18b20_sensor.h"
+
+#define BENCH_ROUNDS    200
+
+static volatile int32_t bench_sink;
+
+static int32_t raw_to_centi_degrees_float(int16_t raw) {
+    return (int32_t)lroundf(raw * 6.25f);
+}
+
+int main(void) {
+    const int codes = 2001 + 880;  // Measuring range, -55 to 125 °C
+    int64_t start_ns = bench_cpu_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int raw = -880; raw <= 2000; raw++) {
+            bench_sink = raw_to_centi_degrees_float((int16_t)raw);
+        }
+    }
+    double float_ns = (double)(bench_cpu_ns() - start_ns) / BENCH_ROUNDS / codes;
+
+    start_ns = bench_cpu_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int raw = -880; raw <= 2000; raw++) {
+            bench_sink = ds18b20_raw_to_centi_degrees((int16_t)raw);
+        }
+    }
+    double fixed_ns = (double)(bench_cpu_ns() - start_ns) / BENCH_ROUNDS / codes;
+
+    BENCH_RESULT("raw_conversion/float/per_sample", float_ns, "ns");
+    BENCH_RESULT("raw_conversion/fixed/per_sample", fixed_ns, "ns");
+    BENCH_RESULT("raw_conversion/float/per_32_sensor_cycle", float_ns * 32 / 1000, "us");
+    BENCH_RESULT("raw_conversion/fixed/per_32_sensor_cycle", fixed_ns * 32 / 1000, "us");
+    return 0;
+}
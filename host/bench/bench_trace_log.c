@@ -0,0 +1,57 @@
+// bench_trace_log.c: per-sample logging overhead, the two ESP_LOGI lines a sample used to print against the two
+// trace records that replaced them. The text side is formatted into a buffer the way esp_log_writev() does before
+// the UART, the transmission itself is counted from the line length at the console baud rate. As with
+// bench_raw_conversion, the host FPU makes %.2f a lot cheaper than the soft-float printf of the ESP32-C6
+
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "ds18b20_sensor.h"
+#include "trace_log.h"
+
+#define BENCH_SAMPLES       200000
+#define BENCH_CONSOLE_BAUD  115200
+#define BENCH_UART_FRAME    10      // Start, 8 data and stop bit
+
+static volatile size_t bench_sink;
+
+// The lines of ds18b20_read_temperature() and temp_sensor_value_update() before the trace log, prefix included
+static size_t format_sample_lines(char *line, size_t size, unsigned long timestamp, int index, int16_t value,
+                                  int16_t delta) {
+    size_t length = (size_t)snprintf(line, size, "I (%lu) %s: Temperature read from DS18B20[%d]: %.2f°C\n",
+                                     timestamp, "DS18B20_SENSOR", index, value / 100.0f);
+    length += (size_t)snprintf(line, size, "I (%lu) %s: Temperature %d: " CENTI_DEGREES_FMT ", Delta %d: "
+                               CENTI_DEGREES_FMT "\n", timestamp, "MAIN", index + 1, CENTI_DEGREES_ARG(value),
+                               index + 1, CENTI_DEGREES_ARG(delta));
+    return length;
+}
+
+int main(void) {
+    char line[256];
+    size_t uart_bytes = 0;
+    int64_t start_ns = bench_cpu_ns();
+    for (int sample = 0; sample < BENCH_SAMPLES; sample++) {
+        int16_t value = (int16_t)(2000 + sample % 500);
+        uart_bytes += format_sample_lines(line, sizeof(line), 5000UL * (unsigned long)sample, sample % 32, value,
+                                          (int16_t)(sample % 7 - 3));
+    }
+    bench_sink = uart_bytes;
+    double text_ns = (double)(bench_cpu_ns() - start_ns) / BENCH_SAMPLES;
+    double uart_us = (double)uart_bytes / BENCH_SAMPLES * BENCH_UART_FRAME * 1e6 / BENCH_CONSOLE_BAUD;
+
+    start_ns = bench_cpu_ns();
+    for (int sample = 0; sample < BENCH_SAMPLES; sample++) {
+        int16_t value = (int16_t)(2000 + sample % 500);
+        trace_log_write(TRACE_EVENT_SAMPLE, (uint8_t)(sample % 32), value);
+        trace_log_write(TRACE_EVENT_REPORT, (uint8_t)(sample % 32), value);
+    }
+    double trace_ns = (double)(bench_cpu_ns() - start_ns) / BENCH_SAMPLES;
+
+    BENCH_RESULT("trace_log/text/format_per_sample", text_ns, "ns");
+    BENCH_RESULT("trace_log/text/uart_per_sample", uart_us, "us");
+    BENCH_RESULT("trace_log/binary/write_per_sample", trace_ns, "ns");
+    BENCH_RESULT("trace_log/text/format_per_32_sensor_cycle", text_ns * 32 / 1000, "us");
+    BENCH_RESULT("trace_log/text/uart_per_32_sensor_cycle", uart_us * 32 / 1000, "ms");
+    BENCH_RESULT("trace_log/binary/write_per_32_sensor_cycle", trace_ns * 32 / 1000, "us");
+    return 0;
+}
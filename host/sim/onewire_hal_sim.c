@@ -0,0 +1,13 @@
+// onewire_hal_sim.c, onewire_hal.h of the host build: the buses come from the simulation (onewire_sim.h)
+
+#include "onewire_hal.h"
+#include "onewire_sim.h"
+#include "sim_clock.h"
+
+esp_err_t onewire_hal_new_bus(int gpio_num, onewire_bus_handle_t *ret_bus) {
+    return onewire_sim_new_bus(gpio_num, ret_bus);
+}
+
+void onewire_hal_delay_ms(uint32_t ms) {
+    sim_clock_advance_us((int64_t)ms * 1000);
+}
@@ -0,0 +1,445 @@
+// onewire_sim.c
+
+#include <math.h>
+#include <string.h>
+#include "onewire_sim.h"
+#include "onewire_cmd.h"
+#include "onewire_crc.h"
+#include "sim_clock.h"
+
+#define SIM_DS18B20_FAMILY_CODE     0x28
+#define SIM_CMD_CONVERT_TEMP        0x44
+#define SIM_CMD_READ_SCRATCHPAD     0xBE
+#define SIM_CMD_WRITE_SCRATCHPAD    0x4E
+#define SIM_CMD_COPY_SCRATCHPAD     0x48
+#define SIM_SCRATCHPAD_SIZE         9
+#define SIM_POWER_ON_RAW            0x0550
+#define SIM_CONVERSION_TIME_US      750000  // 12 bit, halved for every bit less
+
+// EEPROM of a DS18B20 from the factory: TH 75 °C, TL 70 °C, 12 bit
+#define SIM_FACTORY_TH              75
+#define SIM_FACTORY_TL              70
+#define SIM_FACTORY_CONFIG          0x7F
+
+typedef struct {
+    bool used;
+    bool present;
+    bool active;                // Takes part in the running transaction
+    int bus;
+    onewire_device_address_t rom;
+    double celsius;
+    uint8_t scratchpad[SIM_SCRATCHPAD_SIZE];   // CRC byte filled in when read
+    uint8_t eeprom[3];          // TH, TL, config
+    int64_t conversion_end_us;  // 0 if no conversion is running
+    bool conversion_brownout;   // The running conversion ends in a power-on reset
+    bool alarm_flag;
+} sim_device_t;
+
+typedef enum {
+    SIM_BUS_IDLE,               // Waits for a reset
+    SIM_BUS_ROM_COMMAND,
+    SIM_BUS_MATCH_ROM,
+    SIM_BUS_FUNCTION_COMMAND,
+    SIM_BUS_WRITE_SCRATCHPAD,
+    SIM_BUS_READ,
+    SIM_BUS_SEARCH,
+} sim_bus_state_t;
+
+typedef struct {
+    struct onewire_bus_t base;  // First, the handle points here
+    bool used;
+    int gpio;
+    sim_bus_state_t state;
+    uint8_t buffer[SIM_SCRATCHPAD_SIZE];    // Match ROM bytes, Write Scratchpad bytes or the bytes to read
+    int buffer_len;
+    int buffer_pos;
+    int search_bit;
+    int search_slot;            // 0: id bit, 1: complement, 2: direction
+    onewire_sim_faults_t faults;
+    onewire_sim_stats_t stats;
+} sim_bus_t;
+
+static sim_bus_t sim_buses[ONEWIRE_SIM_MAX_BUSES];
+static sim_device_t sim_devices[ONEWIRE_SIM_MAX_DEVICES];
+static uint32_t sim_random_state = 0x6A09E667;
+
+void onewire_sim_seed(uint32_t seed) {
+    sim_random_state = seed != 0 ? seed : 0x6A09E667;
+}
+
+// xorshift32, faults repeat exactly for the same seed
+static uint32_t sim_random(void) {
+    sim_random_state ^= sim_random_state << 13;
+    sim_random_state ^= sim_random_state >> 17;
+    sim_random_state ^= sim_random_state << 5;
+    return sim_random_state;
+}
+
+static bool sim_chance(uint32_t ppm) {
+    return ppm > 0 && sim_random() % 1000000 < ppm;
+}
+
+static void sim_bus_time(sim_bus_t *bus, int64_t us) {
+    bus->stats.bus_time_us += us;
+    sim_clock_advance_us(us);
+}
+
+void onewire_sim_clear(void) {
+    memset(sim_buses, 0, sizeof(sim_buses));
+    memset(sim_devices, 0, sizeof(sim_devices));
+}
+
+int onewire_sim_add_bus(int gpio) {
+    for (int b = 0; b < ONEWIRE_SIM_MAX_BUSES; b++) {
+        if (sim_buses[b].used && sim_buses[b].gpio == gpio) {
+            return b;
+        }
+    }
+    for (int b = 0; b < ONEWIRE_SIM_MAX_BUSES; b++) {
+        if (!sim_buses[b].used) {
+            memset(&sim_buses[b], 0, sizeof(sim_buses[b]));
+            sim_buses[b].used = true;
+            sim_buses[b].gpio = gpio;
+            return b;
+        }
+    }
+    return -1;
+}
+
+onewire_device_address_t onewire_sim_rom(uint64_t serial) {
+    onewire_device_address_t rom = SIM_DS18B20_FAMILY_CODE | ((serial & 0xFFFFFFFFFFFFULL) << 8);
+    uint8_t crc = onewire_crc8(0, (uint8_t *)&rom, 7);
+    return rom | ((onewire_device_address_t)crc << 56);
+}
+
+// Power-on reset: the scratchpad is loaded from the EEPROM and holds 85 °C until the first conversion
+static void sim_device_power_on(sim_device_t *device) {
+    device->scratchpad[0] = SIM_POWER_ON_RAW & 0xFF;
+    device->scratchpad[1] = SIM_POWER_ON_RAW >> 8;
+    memcpy(&device->scratchpad[2], device->eeprom, sizeof(device->eeprom));
+    device->scratchpad[5] = 0xFF;
+    device->scratchpad[6] = 0x0C;
+    device->scratchpad[7] = 0x10;
+    device->conversion_end_us = 0;
+    device->conversion_brownout = false;
+    device->alarm_flag = false;
+}
+
+int onewire_sim_add_device(int bus, onewire_device_address_t rom, double celsius) {
+    for (int d = 0; d < ONEWIRE_SIM_MAX_DEVICES; d++) {
+        sim_device_t *device = &sim_devices[d];
+        if (!device->used) {
+            memset(device, 0, sizeof(*device));
+            device->used = true;
+            device->present = true;
+            device->bus = bus;
+            device->rom = rom;
+            device->celsius = celsius;
+            device->eeprom[0] = SIM_FACTORY_TH;
+            device->eeprom[1] = SIM_FACTORY_TL;
+            device->eeprom[2] = SIM_FACTORY_CONFIG;
+            sim_device_power_on(device);
+            return d;
+        }
+    }
+    return -1;
+}
+
+void onewire_sim_set_temperature(int device, double celsius) {
+    sim_devices[device].celsius = celsius;
+}
+
+void onewire_sim_set_present(int device, bool present) {
+    if (present && !sim_devices[device].present) {
+        sim_device_power_on(&sim_devices[device]);
+    }
+    sim_devices[device].present = present;
+}
+
+void onewire_sim_set_eeprom_alarm(int device, int8_t low, int8_t high) {
+    sim_devices[device].eeprom[0] = (uint8_t)high;
+    sim_devices[device].eeprom[1] = (uint8_t)low;
+    sim_devices[device].scratchpad[2] = (uint8_t)high;
+    sim_devices[device].scratchpad[3] = (uint8_t)low;
+}
+
+void onewire_sim_get_alarm(int device, int8_t *low, int8_t *high) {
+    *high = (int8_t)sim_devices[device].scratchpad[2];
+    *low = (int8_t)sim_devices[device].scratchpad[3];
+}
+
+int onewire_sim_get_resolution_bits(int device) {
+    return 9 + ((sim_devices[device].scratchpad[4] >> 5) & 0x03);
+}
+
+// Finish a conversion whose time is over: the temperature, rounded to the resolution, goes into the scratchpad
+// and the alarm flag compares its integer part against TH/TL
+static void sim_device_settle(sim_device_t *device) {
+    if (device->conversion_end_us == 0 || sim_clock_now_us() < device->conversion_end_us) {
+        return;
+    }
+    if (device->conversion_brownout) {
+        sim_device_power_on(device);
+        return;
+    }
+    device->conversion_end_us = 0;
+
+    double celsius = device->celsius < -55 ? -55 : (device->celsius > 125 ? 125 : device->celsius);
+    int bits = 9 + ((device->scratchpad[4] >> 5) & 0x03);
+    int16_t raw = (int16_t)lround(celsius * 16);
+    raw = (int16_t)(raw & ~((1 << (12 - bits)) - 1));  // The undefined low bits read as zeros
+    device->scratchpad[0] = (uint8_t)(raw & 0xFF);
+    device->scratchpad[1] = (uint8_t)((uint16_t)raw >> 8);
+
+    int8_t degrees = (int8_t)(raw >> 4);
+    device->alarm_flag = degrees >= (int8_t)device->scratchpad[2] || degrees <= (int8_t)device->scratchpad[3];
+}
+
+bool onewire_sim_get_alarm_flag(int device) {
+    sim_device_settle(&sim_devices[device]);
+    return sim_devices[device].alarm_flag;
+}
+
+void onewire_sim_set_faults(int bus, const onewire_sim_faults_t *faults) {
+    sim_buses[bus].faults = *faults;
+}
+
+void onewire_sim_get_stats(int bus, onewire_sim_stats_t *stats) {
+    *stats = sim_buses[bus].stats;
+}
+
+void onewire_sim_reset_stats(int bus) {
+    memset(&sim_buses[bus].stats, 0, sizeof(sim_buses[bus].stats));
+}
+
+#define SIM_FOR_ACTIVE(bus, device) \
+    for (sim_device_t *device = sim_devices; device < &sim_devices[ONEWIRE_SIM_MAX_DEVICES]; device++) \
+        if (device->used && device->active && device->bus == (int)((bus) - sim_buses))
+
+static esp_err_t sim_bus_reset(onewire_bus_handle_t handle) {
+    sim_bus_t *bus = (sim_bus_t *)handle;
+    bus->stats.resets++;
+    sim_bus_time(bus, ONEWIRE_SIM_RESET_US);
+    bus->state = SIM_BUS_IDLE;
+
+    bool presence = false;
+    for (int d = 0; d < ONEWIRE_SIM_MAX_DEVICES; d++) {
+        sim_device_t *device = &sim_devices[d];
+        if (!device->used || device->bus != (int)(bus - sim_buses)) {
+            continue;
+        }
+        sim_device_settle(device);
+        device->active = device->present;
+        if (device->active && sim_chance(bus->faults.dropout_ppm)) {
+            device->active = false;
+            bus->stats.dropouts++;
+        }
+        presence |= device->active;
+    }
+    if (presence && sim_chance(bus->faults.reset_fail_ppm)) {
+        presence = false;
+        bus->stats.reset_failures++;
+    }
+    if (!presence) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    bus->state = SIM_BUS_ROM_COMMAND;
+    return ESP_OK;
+}
+
+static void sim_bus_rom_command(sim_bus_t *bus, uint8_t command) {
+    switch (command) {
+    case ONEWIRE_CMD_SKIP_ROM:
+        bus->state = SIM_BUS_FUNCTION_COMMAND;
+        break;
+    case ONEWIRE_CMD_MATCH_ROM:
+        bus->buffer_len = 0;
+        bus->state = SIM_BUS_MATCH_ROM;
+        break;
+    case ONEWIRE_CMD_SEARCH_ALARM:
+        SIM_FOR_ACTIVE(bus, device) {
+            device->active = device->alarm_flag;
+        }
+        // Fall through
+    case ONEWIRE_CMD_SEARCH_NORMAL:
+        bus->search_bit = 0;
+        bus->search_slot = 0;
+        bus->state = SIM_BUS_SEARCH;
+        break;
+    default:
+        bus->state = SIM_BUS_IDLE;
+        break;
+    }
+}
+
+static void sim_bus_function_command(sim_bus_t *bus, uint8_t command) {
+    bus->state = SIM_BUS_IDLE;
+    switch (command) {
+    case SIM_CMD_CONVERT_TEMP:
+        bus->stats.conversions++;
+        bus->stats.last_conversion_us = sim_clock_now_us();
+        SIM_FOR_ACTIVE(bus, device) {
+            int bits = 9 + ((device->scratchpad[4] >> 5) & 0x03);
+            device->conversion_end_us = sim_clock_now_us() + (SIM_CONVERSION_TIME_US >> (12 - bits));
+            device->conversion_brownout = sim_chance(bus->faults.power_on_ppm);
+            bus->stats.power_ons += device->conversion_brownout;
+        }
+        break;
+    case SIM_CMD_READ_SCRATCHPAD:
+        // Open drain: several devices answering at once read as the AND of their bits, nobody as all ones
+        memset(bus->buffer, 0xFF, sizeof(bus->buffer));
+        SIM_FOR_ACTIVE(bus, device) {
+            uint8_t scratchpad[SIM_SCRATCHPAD_SIZE];
+            memcpy(scratchpad, device->scratchpad, sizeof(scratchpad));
+            scratchpad[8] = onewire_crc8(0, scratchpad, 8);
+            for (int i = 0; i < SIM_SCRATCHPAD_SIZE; i++) {
+                bus->buffer[i] &= scratchpad[i];
+            }
+        }
+        bus->buffer_len = SIM_SCRATCHPAD_SIZE;
+        bus->buffer_pos = 0;
+        bus->state = SIM_BUS_READ;
+        break;
+    case SIM_CMD_WRITE_SCRATCHPAD:
+        bus->buffer_len = 0;
+        bus->state = SIM_BUS_WRITE_SCRATCHPAD;
+        break;
+    case SIM_CMD_COPY_SCRATCHPAD:
+        SIM_FOR_ACTIVE(bus, device) {
+            memcpy(device->eeprom, &device->scratchpad[2], sizeof(device->eeprom));
+            bus->stats.eeprom_writes++;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static esp_err_t sim_bus_write_bytes(onewire_bus_handle_t handle, const uint8_t *tx_data, uint8_t tx_data_size) {
+    sim_bus_t *bus = (sim_bus_t *)handle;
+    for (int i = 0; i < tx_data_size; i++) {
+        uint8_t byte = tx_data[i];
+        bus->stats.bytes_written++;
+        sim_bus_time(bus, 8 * ONEWIRE_SIM_SLOT_US);
+        switch (bus->state) {
+        case SIM_BUS_ROM_COMMAND:
+            sim_bus_rom_command(bus, byte);
+            break;
+        case SIM_BUS_MATCH_ROM:
+            bus->buffer[bus->buffer_len++] = byte;
+            if (bus->buffer_len == 8) {
+                onewire_device_address_t rom;
+                memcpy(&rom, bus->buffer, sizeof(rom));
+                SIM_FOR_ACTIVE(bus, device) {
+                    device->active = device->rom == rom;
+                }
+                bus->state = SIM_BUS_FUNCTION_COMMAND;
+            }
+            break;
+        case SIM_BUS_FUNCTION_COMMAND:
+            sim_bus_function_command(bus, byte);
+            break;
+        case SIM_BUS_WRITE_SCRATCHPAD:
+            bus->buffer[bus->buffer_len++] = byte;
+            if (bus->buffer_len == 3) {
+                SIM_FOR_ACTIVE(bus, device) {
+                    device->scratchpad[2] = bus->buffer[0];
+                    device->scratchpad[3] = bus->buffer[1];
+                    device->scratchpad[4] = (bus->buffer[2] & 0x60) | 0x1F;
+                }
+                bus->state = SIM_BUS_IDLE;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sim_bus_read_bytes(onewire_bus_handle_t handle, uint8_t *rx_buf, size_t rx_buf_size) {
+    sim_bus_t *bus = (sim_bus_t *)handle;
+    for (size_t i = 0; i < rx_buf_size; i++) {
+        uint8_t byte = 0xFF;
+        if (bus->state == SIM_BUS_READ && bus->buffer_pos < bus->buffer_len) {
+            byte = bus->buffer[bus->buffer_pos++];
+            if (sim_chance(bus->faults.crc_error_ppm)) {
+                byte ^= 1 << (sim_random() % 8);
+                bus->stats.crc_errors++;
+            }
+        }
+        rx_buf[i] = byte;
+        bus->stats.bytes_read++;
+        sim_bus_time(bus, 8 * ONEWIRE_SIM_SLOT_US);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sim_bus_read_bit(onewire_bus_handle_t handle, uint8_t *rx_bit) {
+    sim_bus_t *bus = (sim_bus_t *)handle;
+    bus->stats.bits++;
+    sim_bus_time(bus, ONEWIRE_SIM_SLOT_US);
+    if (bus->state != SIM_BUS_SEARCH || bus->search_slot > 1) {
+        *rx_bit = 1;
+        return ESP_OK;
+    }
+
+    // Every device still in the search sends its ROM bit, then its complement
+    uint8_t bit = 1;
+    SIM_FOR_ACTIVE(bus, device) {
+        uint8_t rom_bit = (device->rom >> bus->search_bit) & 1;
+        bit &= bus->search_slot == 0 ? rom_bit : !rom_bit;
+    }
+    if (bit == 0 && sim_chance(bus->faults.search_glitch_ppm)) {
+        bit = 1;
+        bus->stats.search_glitches++;
+    }
+    bus->search_slot++;
+    *rx_bit = bit;
+    return ESP_OK;
+}
+
+static esp_err_t sim_bus_write_bit(onewire_bus_handle_t handle, uint8_t tx_bit) {
+    sim_bus_t *bus = (sim_bus_t *)handle;
+    bus->stats.bits++;
+    sim_bus_time(bus, ONEWIRE_SIM_SLOT_US);
+    if (bus->state != SIM_BUS_SEARCH) {
+        return ESP_OK;
+    }
+
+    // Devices whose bit differs from the chosen direction leave the search until the next reset
+    SIM_FOR_ACTIVE(bus, device) {
+        if (((device->rom >> bus->search_bit) & 1) != (tx_bit & 1)) {
+            device->active = false;
+        }
+    }
+    bus->search_slot = 0;
+    if (++bus->search_bit == 64) {
+        bus->state = SIM_BUS_FUNCTION_COMMAND;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sim_bus_del(onewire_bus_handle_t handle) {
+    sim_bus_t *bus = (sim_bus_t *)handle;
+    bus->state = SIM_BUS_IDLE;
+    return ESP_OK;
+}
+
+esp_err_t onewire_sim_new_bus(int gpio, onewire_bus_handle_t *ret_bus) {
+    int b = onewire_sim_add_bus(gpio);  // A GPIO without a bus of its own gets an empty one, like an unwired pin
+    if (b < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    sim_bus_t *bus = &sim_buses[b];
+    bus->base.reset = sim_bus_reset;
+    bus->base.write_bytes = sim_bus_write_bytes;
+    bus->base.read_bytes = sim_bus_read_bytes;
+    bus->base.write_bit = sim_bus_write_bit;
+    bus->base.read_bit = sim_bus_read_bit;
+    bus->base.del = sim_bus_del;
+    bus->state = SIM_BUS_IDLE;
+    bus->stats.creates++;
+    *ret_bus = &bus->base;
+    return ESP_OK;
+}
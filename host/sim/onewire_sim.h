@@ -0,0 +1,91 @@
+// onewire_sim.h
+
+#ifndef ONEWIRE_SIM_H
+#define ONEWIRE_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "onewire_bus.h"
+
+/* Simulated 1-Wire buses with DS18B20 devices, a backend of the onewire_bus_t interface for the host build.
+ * The devices answer the ROM commands (Skip, Match, Search, Alarm Search) and the DS18B20 function commands
+ * (Convert-T, Read/Write/Copy Scratchpad) bit by bit like the real ones: a conversion latches the temperature
+ * when its resolution dependent conversion time is over, TH/TL and the configuration live in an EEPROM that
+ * survives a power cycle, and a device powers up with the 85 °C value in its scratchpad.
+ * Every slot advances the simulated clock (sim_clock.h) by its duration on a real bus, so the bus time of the
+ * firmware shows up in its latency statistics and in onewire_sim_stats_t.
+ */
+
+#define ONEWIRE_SIM_MAX_BUSES       4
+#define ONEWIRE_SIM_MAX_DEVICES     128
+
+// Bus timing of the standard speed, in microseconds
+#define ONEWIRE_SIM_RESET_US        960     // Reset pulse and presence detect
+#define ONEWIRE_SIM_SLOT_US         70      // One read or write slot, a byte is eight
+
+// Faults injected per bus, in parts per million, drawn from a seeded generator so a run repeats exactly
+typedef struct {
+    uint32_t reset_fail_ppm;    // A reset sees no presence pulse
+    uint32_t dropout_ppm;       // A device misses one transaction (from a reset to the next), per device
+    uint32_t crc_error_ppm;     // A byte read from a scratchpad has one bit flipped, per byte
+    uint32_t search_glitch_ppm; // A search read slot returns 1 although a device pulled it low, per slot
+    uint32_t power_on_ppm;      // A device browns out during a conversion and powers up again, per conversion
+} onewire_sim_faults_t;
+
+// Bus activity since the bus was added
+typedef struct {
+    uint32_t resets;
+    uint32_t bytes_written;
+    uint32_t bytes_read;
+    uint32_t bits;              // Single bit slots (search)
+    uint32_t conversions;       // Convert-T commands, each starts the conversion of every selected device
+    uint32_t eeprom_writes;     // Copy Scratchpad
+    uint32_t crc_errors;        // Injected faults
+    uint32_t dropouts;
+    uint32_t reset_failures;
+    uint32_t search_glitches;
+    uint32_t power_ons;
+    uint32_t creates;           // onewire_sim_new_bus() calls, the first and every one after a del
+    int64_t bus_time_us;        // Time spent in slots and resets
+    int64_t last_conversion_us; // Clock at the last Convert-T, 0 before the first
+} onewire_sim_stats_t;
+
+// Remove all buses and devices
+void onewire_sim_clear(void);
+
+// Add a bus on a GPIO, the firmware gets it from onewire_hal_new_bus() of the same GPIO. Returns the bus id
+int onewire_sim_add_bus(int gpio);
+
+// ROM code of a DS18B20 with the given serial number, family code and CRC included
+onewire_device_address_t onewire_sim_rom(uint64_t serial);
+
+// Add a powered DS18B20 to a bus, it holds the power-on value until its first conversion. Returns the device id
+int onewire_sim_add_device(int bus, onewire_device_address_t rom, double celsius);
+
+// Temperature the device measures from the next conversion end on
+void onewire_sim_set_temperature(int device, double celsius);
+
+// Unplug (false) or plug a device, a plugged device powers up
+void onewire_sim_set_present(int device, bool present);
+
+// TH/TL the device holds in its EEPROM, set before the firmware boots to model a sensor programmed elsewhere
+void onewire_sim_set_eeprom_alarm(int device, int8_t low, int8_t high);
+
+// TH/TL and resolution the device currently uses (scratchpad)
+void onewire_sim_get_alarm(int device, int8_t *low, int8_t *high);
+int onewire_sim_get_resolution_bits(int device);
+
+// Alarm flag of the last conversion
+bool onewire_sim_get_alarm_flag(int device);
+
+void onewire_sim_set_faults(int bus, const onewire_sim_faults_t *faults);
+void onewire_sim_seed(uint32_t seed);
+
+void onewire_sim_get_stats(int bus, onewire_sim_stats_t *stats);
+void onewire_sim_reset_stats(int bus);
+
+// onewire_bus_t of the bus on gpio, used by onewire_hal_new_bus()
+esp_err_t onewire_sim_new_bus(int gpio, onewire_bus_handle_t *ret_bus);
+
+#endif // ONEWIRE_SIM_H
@@ -0,0 +1,27 @@
+// sim_clock.c
+
+#include "sim_clock.h"
+#include "esp_timer.h"
+
+// Boots do not start at 0 on the target either, a clock that starts later catches code that assumes it does
+static int64_t sim_clock_us = 1000000;
+
+int64_t sim_clock_now_us(void) {
+    return sim_clock_us;
+}
+
+void sim_clock_advance_us(int64_t us) {
+    if (us > 0) {
+        sim_clock_us += us;
+    }
+}
+
+void sim_clock_advance_to_us(int64_t at_us) {
+    if (at_us > sim_clock_us) {
+        sim_clock_us = at_us;
+    }
+}
+
+int64_t esp_timer_get_time(void) {
+    return sim_clock_us;
+}
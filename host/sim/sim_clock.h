@@ -0,0 +1,18 @@
+// sim_clock.h
+
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+
+/* Simulated time of the host build, esp_timer_get_time() reads it. It only moves forward when the simulation
+ * advances it: the simulated 1-Wire bus for its slots, sim_node.h to the next timer or scheduler callback.
+ */
+int64_t sim_clock_now_us(void);
+
+void sim_clock_advance_us(int64_t us);
+
+// Move the clock to at_us, an instant that already passed leaves it where it is
+void sim_clock_advance_to_us(int64_t at_us);
+
+#endif // SIM_CLOCK_H
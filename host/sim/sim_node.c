@@ -0,0 +1,84 @@
+// sim_node.c
+
+#include <stdint.h>
+#include "sim_node.h"
+#include "sim_clock.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "ds18b20_sensor.h"
+#include "trace_log.h"
+#include "esp_check.h"
+
+static const char *TAG = "SIM_NODE";
+
+// The one-shot sampling timer of main.c, INT64_MAX while it is stopped
+static int64_t sim_node_timer_due_us = INT64_MAX;
+static uint32_t sim_node_sampler_steps = 0;
+
+static bool sim_node_sampler_start(void) {
+    sim_node_timer_due_us = sim_clock_now_us();
+    return true;
+}
+
+static void sim_node_sampler_wake(void) {
+    sim_node_timer_due_us = sim_clock_now_us() + 1000;  // One tick, like xTimerChangePeriod(timer, 1, 0)
+}
+
+// The dump task of main.c, run right away: nothing else runs on the host meanwhile
+static uint32_t sim_node_trace_dumps = 0;
+
+static void sim_node_trace_dump(void) {
+    sim_node_trace_dumps++;
+    trace_log_dump();
+}
+
+static const sensor_app_platform_t sim_node_platform = {
+    .sampler_start = sim_node_sampler_start,
+    .sampler_wake = sim_node_sampler_wake,
+    .trace_dump = sim_node_trace_dump,
+};
+
+static void sim_node_sampler_step(void) {
+    sim_node_sampler_steps++;
+    uint32_t delay_ms = sensor_app_sampler_step();
+    sim_node_timer_due_us = sim_clock_now_us() + (int64_t)(delay_ms > 0 ? delay_ms : 1) * 1000;
+}
+
+esp_err_t sim_node_init(void) {
+    ESP_RETURN_ON_ERROR(ds18b20_init(), TAG, "Failed to initialize the DS18B20 sensors");
+    return sensor_app_init(&sim_node_platform);
+}
+
+void sim_node_stack_started(esp_err_t status, bool factory_new) {
+    sensor_app_stack_started(status, factory_new);
+}
+
+void sim_node_run_until(int64_t until_us) {
+    for (;;) {
+        int64_t zigbee_due_us = zigbee_fake_next_due_us();
+        int64_t next_us = zigbee_due_us < sim_node_timer_due_us ? zigbee_due_us : sim_node_timer_due_us;
+        if (next_us > until_us) {
+            break;
+        }
+        // Bus slots advance the clock, a callback may already be late
+        sim_clock_advance_to_us(next_us);
+        if (zigbee_due_us <= sim_node_timer_due_us) {
+            zigbee_fake_run_due(sim_clock_now_us());
+        } else {
+            sim_node_sampler_step();
+        }
+    }
+    sim_clock_advance_to_us(until_us);
+}
+
+void sim_node_run_for_ms(uint32_t ms) {
+    sim_node_run_until(sim_clock_now_us() + (int64_t)ms * 1000);
+}
+
+uint32_t sim_node_get_sampler_steps(void) {
+    return sim_node_sampler_steps;
+}
+
+uint32_t sim_node_get_trace_dumps(void) {
+    return sim_node_trace_dumps;
+}
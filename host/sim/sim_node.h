@@ -0,0 +1,33 @@
+// sim_node.h
+
+#ifndef SIM_NODE_H
+#define SIM_NODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/* One node of the host build: the firmware of main/ on the simulated buses (onewire_sim.h) and the fake stack
+ * (zigbee_fake.h). It stands in for main.c: the sampling timer and the Zigbee task both run on the simulated clock,
+ * one callback at a time in the order they become due. The module state of the firmware lives for the process,
+ * a test boots one node.
+ */
+
+// Discover the sensors and create the application state, as app_main() does
+esp_err_t sim_node_init(void);
+
+// The stack finished BDB initialization, as the first start or reboot signal does
+void sim_node_stack_started(esp_err_t status, bool factory_new);
+
+// Run timer and scheduler callbacks until the clock reaches until_us, the clock ends at until_us
+void sim_node_run_until(int64_t until_us);
+
+void sim_node_run_for_ms(uint32_t ms);
+
+// Sampling timer callbacks run so far
+uint32_t sim_node_get_sampler_steps(void);
+
+// Trace dumps the firmware requested (sensor_app_platform_t.trace_dump)
+uint32_t sim_node_get_trace_dumps(void);
+
+#endif // SIM_NODE_H
@@ -0,0 +1,487 @@
+// zigbee_fake.c
+
+#include <string.h>
+#include "zigbee_fake.h"
+#include "zigbee_hal.h"
+#include "sensor_app.h"
+#include "main.h"
+#include "latency_stats.h"
+#include "sim_clock.h"
+
+#define ZIGBEE_FAKE_ATTR_TABLE_SIZE 4096    // Power of two, open addressing
+#define ZIGBEE_FAKE_REPORTING_NUM   256
+#define ZIGBEE_FAKE_SCHEDULER_SIZE  128
+
+#define ZIGBEE_FAKE_MEASURED_VALUE_ID   0x0000
+
+typedef struct {
+    bool used;
+    uint64_t key;
+    uint32_t writes;
+    size_t size;
+    uint8_t value[ZIGBEE_FAKE_VALUE_MAX_SIZE];
+} zigbee_fake_attr_t;
+
+typedef struct {
+    bool used;
+    uint8_t endpoint;
+    uint16_t attr_id;       // ZIGBEE_FAKE_MEASURED_VALUE_ID for MeasuredValue, otherwise manufacturer specific
+    zigbee_hal_reporting_t reporting;
+} zigbee_fake_reporting_entry_t;
+
+typedef struct {
+    bool used;
+    int64_t due_us;
+    uint32_t seq;           // Callbacks due at the same time run in the order they were scheduled
+    zigbee_hal_callback_t callback;
+    uint8_t param;
+} zigbee_fake_alarm_t;
+
+static zigbee_fake_attr_t fake_attrs[ZIGBEE_FAKE_ATTR_TABLE_SIZE];
+static zigbee_fake_report_t fake_reports[ZIGBEE_FAKE_REPORT_LOG_SIZE];
+static uint32_t fake_report_count = 0;
+static esp_err_t fake_report_status = ESP_OK;
+static uint8_t fake_report_tsn = 0;
+static esp_err_t fake_confirm_status = ESP_OK;
+static uint32_t fake_confirm_delay_ms = 20;
+static zigbee_fake_reporting_entry_t fake_reportings[ZIGBEE_FAKE_REPORTING_NUM];
+static zigbee_fake_alarm_t fake_alarms[ZIGBEE_FAKE_SCHEDULER_SIZE];
+static uint32_t fake_alarm_seq = 0;
+static bool fake_lock_busy = false;
+static uint32_t fake_lock_busy_count = 0;
+
+static struct {
+    bool up;
+    uint8_t channel;
+    uint16_t pan_id;
+    uint32_t steering_ms;
+    uint32_t steering_count;
+    uint32_t last_channel_mask;
+    int64_t last_steering_us;
+} fake_network = {.up = true, .channel = 15, .pan_id = 0x1A62, .steering_ms = 2000};
+
+static struct {
+    uint32_t failures;
+    bool factory_new;
+    uint32_t init_ms;
+    uint32_t count;
+    int64_t last_us;
+} fake_initialization = {.init_ms = 500};
+
+static struct {
+    bool present;
+    uint32_t network_s;
+    int32_t skew_ppm;
+    uint32_t latency_ms;
+    uint32_t reads;
+    uint32_t answer_s;      // Answer of the read in flight
+} fake_time = {.present = true, .network_s = 800000000, .latency_ms = 40};
+
+static uint32_t fake_poll_count = 0;
+
+void zigbee_fake_clear(void) {
+    memset(fake_attrs, 0, sizeof(fake_attrs));
+    memset(fake_reportings, 0, sizeof(fake_reportings));
+    memset(fake_alarms, 0, sizeof(fake_alarms));
+    fake_report_count = 0;
+    fake_report_status = ESP_OK;
+    fake_confirm_status = ESP_OK;
+    fake_confirm_delay_ms = 20;
+    fake_lock_busy = false;
+    fake_lock_busy_count = 0;
+    fake_poll_count = 0;
+    fake_network.steering_count = 0;
+    fake_initialization.count = 0;
+    fake_time.reads = 0;
+}
+
+static uint64_t fake_attr_key(uint16_t cluster, uint8_t endpoint, uint16_t attr_id) {
+    return ((uint64_t)endpoint << 32) | ((uint64_t)cluster << 16) | attr_id;
+}
+
+static zigbee_fake_attr_t *fake_attr_find(uint64_t key, bool create) {
+    uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 52) & (ZIGBEE_FAKE_ATTR_TABLE_SIZE - 1);
+    for (int probe = 0; probe < ZIGBEE_FAKE_ATTR_TABLE_SIZE; probe++) {
+        zigbee_fake_attr_t *attr = &fake_attrs[(slot + probe) & (ZIGBEE_FAKE_ATTR_TABLE_SIZE - 1)];
+        if (attr->used && attr->key == key) {
+            return attr;
+        }
+        if (!attr->used) {
+            if (!create) {
+                return NULL;
+            }
+            attr->used = true;
+            attr->key = key;
+            return attr;
+        }
+    }
+    return NULL;
+}
+
+// Size of a value as the stack knows it from the attribute type, 0 for an attribute the endpoints do not have
+static size_t fake_attr_size(uint16_t cluster, uint16_t attr_id, const void *value) {
+    const uint8_t *octets = value;
+    if (cluster == ZIGBEE_FAKE_CLUSTER_DIAGNOSTICS) {
+        if (attr_id >= CUSTOM_DIAG_LATENCY_ATTR_ID(0, 0) && attr_id < CUSTOM_DIAG_LATENCY_ATTR_ID(LATENCY_PHASE_NUM, 0)) {
+            return (attr_id & 0x0F) == CUSTOM_DIAG_LATENCY_BUCKETS ? 1 + (size_t)octets[0] : sizeof(uint32_t);
+        }
+        if ((attr_id >= CUSTOM_DIAG_COUNTER_ATTR_ID(0) && attr_id < CUSTOM_DIAG_COUNTER_ATTR_ID(LATENCY_COUNTER_NUM)) ||
+            (attr_id >= CUSTOM_DIAG_REJOIN_ATTR_ID(0) && attr_id < CUSTOM_DIAG_REJOIN_ATTR_ID(CUSTOM_DIAG_REJOIN_NUM)) ||
+            (attr_id >= CUSTOM_DIAG_TIME_ATTR_ID(0) && attr_id < CUSTOM_DIAG_TIME_ATTR_ID(CUSTOM_DIAG_TIME_NUM))) {
+            return sizeof(uint32_t);
+        }
+        return 0;
+    }
+
+    switch (attr_id) {
+    case ZIGBEE_FAKE_MEASURED_VALUE_ID:
+    case CUSTOM_TEMP_SAMPLE_PERIOD_ATTRIBUTE_ID:
+    case CUSTOM_TEMP_ALARM_LOW_ATTRIBUTE_ID:
+    case CUSTOM_TEMP_ALARM_HIGH_ATTRIBUTE_ID:
+        return sizeof(int16_t);
+    case CUSTOM_TEMP_HISTORY_ATTRIBUTE_ID:
+    case CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID:
+        return 1 + (size_t)octets[0];
+    case CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID:
+        return sizeof(uint32_t);
+    case CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID:
+        return sizeof(uint8_t);
+    default:
+        break;
+    }
+    if (attr_id >= CUSTOM_TEMP_STATS_ATTR_ID(0, 0) && attr_id < CUSTOM_TEMP_STATS_ATTR_ID(ESP_TEMP_STATS_WINDOW_NUM, 0)) {
+        return (attr_id & 0x0F) <= CUSTOM_TEMP_STATS_COUNT ? sizeof(uint16_t) : 0;
+    }
+    if (attr_id >= CUSTOM_TEMP_BUS_STATS_ATTR_ID(0) && attr_id < CUSTOM_TEMP_BUS_STATS_ATTR_ID(CUSTOM_TEMP_BUS_STATS_NUM)) {
+        return sizeof(uint32_t);
+    }
+    return 0;
+}
+
+static esp_err_t fake_attr_set(uint16_t cluster, uint8_t endpoint, uint16_t attr_id, const void *value) {
+    size_t size = fake_attr_size(cluster, attr_id, value);
+    if (size == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    zigbee_fake_attr_t *attr = fake_attr_find(fake_attr_key(cluster, endpoint, attr_id), true);
+    if (attr == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(attr->value, value, size);
+    attr->size = size;
+    attr->writes++;
+    return ESP_OK;
+}
+
+static void fake_confirm_cb(uint8_t tsn) {
+    sensor_app_report_sent(tsn, fake_confirm_status);
+}
+
+static esp_err_t fake_report(uint16_t cluster, uint8_t endpoint, uint16_t attr_id, uint8_t *tsn) {
+    if (fake_report_status != ESP_OK) {
+        return fake_report_status;
+    }
+    zigbee_fake_attr_t *attr = fake_attr_find(fake_attr_key(cluster, endpoint, attr_id), false);
+    if (attr == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    zigbee_fake_report_t *report = &fake_reports[fake_report_count % ZIGBEE_FAKE_REPORT_LOG_SIZE];
+    report->time_us = sim_clock_now_us();
+    report->endpoint = endpoint;
+    report->cluster = cluster;
+    report->attr_id = attr_id;
+    report->size = attr->size;
+    memcpy(report->value, attr->value, attr->size);
+    report->tsn = fake_report_tsn++;
+    fake_report_count++;
+    if (fake_confirm_delay_ms != UINT32_MAX) {
+        zigbee_hal_schedule(fake_confirm_cb, report->tsn, fake_confirm_delay_ms);
+    }
+    if (tsn != NULL) {
+        *tsn = report->tsn;
+    }
+    return ESP_OK;
+}
+
+bool zigbee_fake_get_attr(uint16_t cluster, uint8_t endpoint, uint16_t attr_id, void *value, size_t size) {
+    zigbee_fake_attr_t *attr = fake_attr_find(fake_attr_key(cluster, endpoint, attr_id), false);
+    if (attr == NULL) {
+        return false;
+    }
+    memcpy(value, attr->value, size < attr->size ? size : attr->size);
+    return true;
+}
+
+uint32_t zigbee_fake_get_attr_writes(uint16_t cluster, uint8_t endpoint, uint16_t attr_id) {
+    zigbee_fake_attr_t *attr = fake_attr_find(fake_attr_key(cluster, endpoint, attr_id), false);
+    return attr != NULL ? attr->writes : 0;
+}
+
+bool zigbee_fake_get_temperature(uint8_t endpoint, int16_t *value) {
+    return zigbee_fake_get_attr(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, endpoint, ZIGBEE_FAKE_MEASURED_VALUE_ID, value, sizeof(*value));
+}
+
+uint32_t zigbee_fake_get_report_count(void) {
+    return fake_report_count;
+}
+
+const zigbee_fake_report_t *zigbee_fake_get_report(uint32_t index) {
+    if (index >= fake_report_count || fake_report_count - index > ZIGBEE_FAKE_REPORT_LOG_SIZE) {
+        return NULL;
+    }
+    return &fake_reports[index % ZIGBEE_FAKE_REPORT_LOG_SIZE];
+}
+
+void zigbee_fake_set_report_status(esp_err_t status) {
+    fake_report_status = status;
+}
+
+void zigbee_fake_set_confirm(esp_err_t status, uint32_t delay_ms) {
+    fake_confirm_status = status;
+    fake_confirm_delay_ms = delay_ms;
+}
+
+static zigbee_fake_reporting_entry_t *fake_reporting_find(uint8_t endpoint, uint16_t attr_id, bool create) {
+    zigbee_fake_reporting_entry_t *free_entry = NULL;
+    for (int i = 0; i < ZIGBEE_FAKE_REPORTING_NUM; i++) {
+        zigbee_fake_reporting_entry_t *entry = &fake_reportings[i];
+        if (entry->used && entry->endpoint == endpoint && entry->attr_id == attr_id) {
+            return entry;
+        }
+        if (!entry->used && free_entry == NULL) {
+            free_entry = entry;
+        }
+    }
+    if (!create || free_entry == NULL) {
+        return NULL;
+    }
+    free_entry->used = true;
+    free_entry->endpoint = endpoint;
+    free_entry->attr_id = attr_id;
+    return free_entry;
+}
+
+static void fake_reporting_set(uint8_t endpoint, uint16_t attr_id, const zigbee_hal_reporting_t *reporting) {
+    zigbee_fake_reporting_entry_t *entry = fake_reporting_find(endpoint, attr_id, reporting != NULL);
+    if (entry == NULL) {
+        return;
+    }
+    if (reporting == NULL) {
+        entry->used = false;
+    } else {
+        entry->reporting = *reporting;
+    }
+}
+
+void zigbee_fake_set_temperature_reporting(uint8_t endpoint, const zigbee_hal_reporting_t *reporting) {
+    fake_reporting_set(endpoint, ZIGBEE_FAKE_MEASURED_VALUE_ID, reporting);
+}
+
+void zigbee_fake_set_manufacturer_reporting(uint8_t endpoint, uint16_t attr_id, const zigbee_hal_reporting_t *reporting) {
+    fake_reporting_set(endpoint, attr_id, reporting);
+}
+
+static zigbee_fake_alarm_t *fake_alarm_next(void) {
+    zigbee_fake_alarm_t *next = NULL;
+    for (int i = 0; i < ZIGBEE_FAKE_SCHEDULER_SIZE; i++) {
+        zigbee_fake_alarm_t *alarm = &fake_alarms[i];
+        if (alarm->used && (next == NULL || alarm->due_us < next->due_us ||
+                            (alarm->due_us == next->due_us && (int32_t)(alarm->seq - next->seq) < 0))) {
+            next = alarm;
+        }
+    }
+    return next;
+}
+
+int64_t zigbee_fake_next_due_us(void) {
+    zigbee_fake_alarm_t *next = fake_alarm_next();
+    return next != NULL ? next->due_us : INT64_MAX;
+}
+
+bool zigbee_fake_run_due(int64_t now_us) {
+    zigbee_fake_alarm_t *next = fake_alarm_next();
+    if (next == NULL || next->due_us > now_us) {
+        return false;
+    }
+    zigbee_hal_callback_t callback = next->callback;
+    uint8_t param = next->param;
+    next->used = false;
+    callback(param);
+    return true;
+}
+
+void zigbee_fake_set_lock_busy(bool busy) {
+    fake_lock_busy = busy;
+}
+
+uint32_t zigbee_fake_get_lock_busy_count(void) {
+    return fake_lock_busy_count;
+}
+
+void zigbee_fake_set_initialization(uint32_t failures, bool factory_new, uint32_t init_ms) {
+    fake_initialization.failures = failures;
+    fake_initialization.factory_new = factory_new;
+    fake_initialization.init_ms = init_ms;
+}
+
+uint32_t zigbee_fake_get_initialization_count(void) {
+    return fake_initialization.count;
+}
+
+int64_t zigbee_fake_get_last_initialization_us(void) {
+    return fake_initialization.last_us;
+}
+
+void zigbee_fake_set_network(bool up, uint8_t channel, uint16_t pan_id, uint32_t steering_ms) {
+    fake_network.up = up;
+    fake_network.channel = channel;
+    fake_network.pan_id = pan_id;
+    fake_network.steering_ms = steering_ms;
+}
+
+uint32_t zigbee_fake_get_steering_count(void) {
+    return fake_network.steering_count;
+}
+
+uint32_t zigbee_fake_get_last_channel_mask(void) {
+    return fake_network.last_channel_mask;
+}
+
+int64_t zigbee_fake_get_last_steering_us(void) {
+    return fake_network.last_steering_us;
+}
+
+void zigbee_fake_set_time_server(bool present, uint32_t network_s, int32_t skew_ppm, uint32_t latency_ms) {
+    fake_time.present = present;
+    fake_time.network_s = network_s;
+    fake_time.skew_ppm = skew_ppm;
+    fake_time.latency_ms = latency_ms;
+}
+
+uint32_t zigbee_fake_get_time_read_count(void) {
+    return fake_time.reads;
+}
+
+int64_t zigbee_fake_network_us(int64_t local_us) {
+    return (int64_t)fake_time.network_s * 1000000 + local_us + local_us / 1000000 * fake_time.skew_ppm;
+}
+
+uint32_t zigbee_fake_get_poll_count(void) {
+    return fake_poll_count;
+}
+
+// zigbee_hal.h
+
+esp_err_t zigbee_hal_set_temperature(uint8_t endpoint, int16_t value) {
+    return fake_attr_set(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, endpoint, ZIGBEE_FAKE_MEASURED_VALUE_ID, &value);
+}
+
+esp_err_t zigbee_hal_report_temperature(uint8_t endpoint) {
+    return fake_report(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, endpoint, ZIGBEE_FAKE_MEASURED_VALUE_ID, NULL);
+}
+
+esp_err_t zigbee_hal_set_manufacturer_attr(uint8_t endpoint, uint16_t attr_id, void *value) {
+    return fake_attr_set(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, endpoint, attr_id, value);
+}
+
+esp_err_t zigbee_hal_report_manufacturer_attr(uint8_t endpoint, uint16_t attr_id, void *value, uint8_t *tsn) {
+    esp_err_t ret = fake_attr_set(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, endpoint, attr_id, value);
+    return ret == ESP_OK ? fake_report(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, endpoint, attr_id, tsn) : ret;
+}
+
+esp_err_t zigbee_hal_set_diagnostics_attr(uint8_t endpoint, uint16_t attr_id, void *value) {
+    return fake_attr_set(ZIGBEE_FAKE_CLUSTER_DIAGNOSTICS, endpoint, attr_id, value);
+}
+
+void zigbee_hal_schedule(zigbee_hal_callback_t callback, uint8_t param, uint32_t delay_ms) {
+    for (int i = 0; i < ZIGBEE_FAKE_SCHEDULER_SIZE; i++) {
+        zigbee_fake_alarm_t *alarm = &fake_alarms[i];
+        if (!alarm->used) {
+            alarm->used = true;
+            alarm->due_us = sim_clock_now_us() + (int64_t)delay_ms * 1000;
+            alarm->seq = fake_alarm_seq++;
+            alarm->callback = callback;
+            alarm->param = param;
+            return;
+        }
+    }
+}
+
+bool zigbee_hal_try_lock(void) {
+    if (fake_lock_busy) {
+        fake_lock_busy_count++;
+        return false;
+    }
+    return true;
+}
+
+void zigbee_hal_unlock(void) {
+}
+
+bool zigbee_hal_get_temperature_reporting(uint8_t endpoint, zigbee_hal_reporting_t *reporting) {
+    zigbee_fake_reporting_entry_t *entry = fake_reporting_find(endpoint, ZIGBEE_FAKE_MEASURED_VALUE_ID, false);
+    if (entry == NULL) {
+        return false;
+    }
+    *reporting = entry->reporting;
+    return true;
+}
+
+bool zigbee_hal_get_manufacturer_reporting(uint8_t endpoint, uint16_t attr_id, zigbee_hal_reporting_t *reporting) {
+    zigbee_fake_reporting_entry_t *entry = fake_reporting_find(endpoint, attr_id, false);
+    if (entry == NULL) {
+        return false;
+    }
+    *reporting = entry->reporting;
+    return true;
+}
+
+static void fake_time_response_cb(uint8_t param) {
+    sensor_app_time_response(fake_time.answer_s);
+}
+
+esp_err_t zigbee_hal_read_network_time(uint8_t endpoint) {
+    fake_time.reads++;
+    int64_t answered_us = sim_clock_now_us() + (int64_t)fake_time.latency_ms * 500;
+    fake_time.answer_s = fake_time.present ? (uint32_t)(zigbee_fake_network_us(answered_us) / 1000000) : CUSTOM_TEMP_TIMESTAMP_INVALID;
+    zigbee_hal_schedule(fake_time_response_cb, 0, fake_time.latency_ms);
+    return ESP_OK;
+}
+
+static void fake_initialization_done_cb(uint8_t param) {
+    if (fake_initialization.failures > 0) {
+        fake_initialization.failures--;
+        sensor_app_stack_started(ESP_FAIL, false);
+    } else {
+        sensor_app_stack_started(ESP_OK, fake_initialization.factory_new);
+    }
+}
+
+esp_err_t zigbee_hal_start_initialization(void) {
+    fake_initialization.count++;
+    fake_initialization.last_us = sim_clock_now_us();
+    zigbee_hal_schedule(fake_initialization_done_cb, 0, fake_initialization.init_ms);
+    return ESP_OK;
+}
+
+static void fake_steering_done_cb(uint8_t param) {
+    bool found = fake_network.up && (fake_network.last_channel_mask & (1UL << fake_network.channel));
+    sensor_app_steering_done(found ? ESP_OK : ESP_FAIL);
+}
+
+esp_err_t zigbee_hal_start_steering(uint32_t channel_mask) {
+    fake_network.steering_count++;
+    fake_network.last_channel_mask = channel_mask;
+    fake_network.last_steering_us = sim_clock_now_us();
+    zigbee_hal_schedule(fake_steering_done_cb, 0, fake_network.steering_ms);
+    return ESP_OK;
+}
+
+void zigbee_hal_get_network(uint8_t *channel, uint16_t *pan_id) {
+    *channel = fake_network.channel;
+    *pan_id = fake_network.pan_id;
+}
+
+void zigbee_hal_poll_parent(void) {
+    fake_poll_count++;
+}
@@ -0,0 +1,96 @@
+// zigbee_fake.h
+
+#ifndef ZIGBEE_FAKE_H
+#define ZIGBEE_FAKE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "zigbee_hal.h"
+
+/* zigbee_hal.h of the host build: an attribute table, a log of the reports sent, the scheduler of the Zigbee task
+ * on the simulated clock, network steering against a configurable network and a coordinator with its own clock
+ * answering Time attribute reads. The answers go to sensor_app.h like main.c forwards them on the target.
+ */
+
+#define ZIGBEE_FAKE_CLUSTER_TEMPERATURE 0x0402
+#define ZIGBEE_FAKE_CLUSTER_DIAGNOSTICS 0x0B05
+
+#define ZIGBEE_FAKE_VALUE_MAX_SIZE      256     // Octet strings included, length byte first
+#define ZIGBEE_FAKE_REPORT_LOG_SIZE     1024
+
+// A report sent to the coordinator (zigbee_hal_report_*)
+typedef struct {
+    int64_t time_us;
+    uint8_t tsn;                // Sequence number the APS confirm carries
+    uint8_t endpoint;
+    uint16_t cluster;
+    uint16_t attr_id;
+    size_t size;
+    uint8_t value[ZIGBEE_FAKE_VALUE_MAX_SIZE];
+} zigbee_fake_report_t;
+
+// Forget the table, the reports, the reporting configurations and the pending callbacks
+void zigbee_fake_clear(void);
+
+// Current value of an attribute, false if it was never written
+bool zigbee_fake_get_attr(uint16_t cluster, uint8_t endpoint, uint16_t attr_id, void *value, size_t size);
+
+// Times an attribute was written since zigbee_fake_clear()
+uint32_t zigbee_fake_get_attr_writes(uint16_t cluster, uint8_t endpoint, uint16_t attr_id);
+
+// MeasuredValue of the Temperature Measurement cluster on endpoint, false if it was never written
+bool zigbee_fake_get_temperature(uint8_t endpoint, int16_t *value);
+
+// Reports sent since zigbee_fake_clear(), the log keeps the last ZIGBEE_FAKE_REPORT_LOG_SIZE
+uint32_t zigbee_fake_get_report_count(void);
+const zigbee_fake_report_t *zigbee_fake_get_report(uint32_t index);
+
+// Status of the following zigbee_hal_report_* calls, ESP_OK unless set
+void zigbee_fake_set_report_status(esp_err_t status);
+
+// APS confirm of the following reports: status passed to sensor_app_report_sent() delay_ms after the report,
+// UINT32_MAX for none. ESP_OK after 20 ms unless set
+void zigbee_fake_set_confirm(esp_err_t status, uint32_t delay_ms);
+
+// Reporting configuration the coordinator wrote, call sensor_app_reporting_configured() afterwards like the
+// raw command handler of main.c. NULL removes it
+void zigbee_fake_set_temperature_reporting(uint8_t endpoint, const zigbee_hal_reporting_t *reporting);
+void zigbee_fake_set_manufacturer_reporting(uint8_t endpoint, uint16_t attr_id, const zigbee_hal_reporting_t *reporting);
+
+// Due time of the next scheduled callback, INT64_MAX if there is none
+int64_t zigbee_fake_next_due_us(void);
+
+// Run the next scheduled callback if it is due at now_us, returns false if none is
+bool zigbee_fake_run_due(int64_t now_us);
+
+// Make zigbee_hal_try_lock() fail, as if the Zigbee task held the lock
+void zigbee_fake_set_lock_busy(bool busy);
+uint32_t zigbee_fake_get_lock_busy_count(void);
+
+// BDB initialization (zigbee_hal_start_initialization()) fails the next failures times, then succeeds, each
+// after init_ms. factory_new is what a successful one reports
+void zigbee_fake_set_initialization(uint32_t failures, bool factory_new, uint32_t init_ms);
+uint32_t zigbee_fake_get_initialization_count(void);
+int64_t zigbee_fake_get_last_initialization_us(void);
+
+// Network steering finds the network if it is up and its channel is in the channel mask, after steering_ms
+void zigbee_fake_set_network(bool up, uint8_t channel, uint16_t pan_id, uint32_t steering_ms);
+uint32_t zigbee_fake_get_steering_count(void);
+uint32_t zigbee_fake_get_last_channel_mask(void);
+int64_t zigbee_fake_get_last_steering_us(void);
+
+/* Coordinator clock: network_s at local time 0, running skew_ppm faster than the local clock. A Time read is
+ * answered after latency_ms with the coordinator time halfway through. Without a time server the answer is
+ * the invalid time.
+ */
+void zigbee_fake_set_time_server(bool present, uint32_t network_s, int32_t skew_ppm, uint32_t latency_ms);
+uint32_t zigbee_fake_get_time_read_count(void);
+
+// Coordinator time at a local time, in microseconds since 2000
+int64_t zigbee_fake_network_us(int64_t local_us);
+
+uint32_t zigbee_fake_get_poll_count(void);
+
+#endif // ZIGBEE_FAKE_H
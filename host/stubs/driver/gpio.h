@@ -0,0 +1,6 @@
+// gpio.h, host build: the buses are simulated, nothing to configure
+
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+#endif // DRIVER_GPIO_H
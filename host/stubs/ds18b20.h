@@ -0,0 +1,14 @@
+// ds18b20.h, host build: the resolution type of the espressif/ds18b20 component, the firmware drives the
+// sensors with its own commands
+
+#ifndef DS18B20_H
+#define DS18B20_H
+
+typedef enum {
+    DS18B20_RESOLUTION_9B,
+    DS18B20_RESOLUTION_10B,
+    DS18B20_RESOLUTION_11B,
+    DS18B20_RESOLUTION_12B,
+} ds18b20_resolution_t;
+
+#endif // DS18B20_H
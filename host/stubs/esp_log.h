@@ -0,0 +1,30 @@
+// esp_log.h, host build: the log macros print to stderr, filtered by esp_log_level_set("*", level)
+
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdio.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+// Milliseconds of the simulated clock, the prefix looks like the one of the target (tools/trace_decode.py parses it)
+unsigned long esp_log_timestamp(void);
+// No format check: the firmware prints 64-bit values with %lld/%llX, right for the 32-bit target but not for
+// the int64_t of a 64-bit host, where both have the same size anyway
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...);
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, "E (%lu) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, "W (%lu) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, "I (%lu) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, "D (%lu) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_write(ESP_LOG_VERBOSE, tag, "V (%lu) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,10 @@
+// esp_random.h, host build: a seeded generator, runs repeat exactly
+
+#ifndef ESP_RANDOM_H
+#define ESP_RANDOM_H
+
+#include <stdint.h>
+
+uint32_t esp_random(void);
+
+#endif // ESP_RANDOM_H
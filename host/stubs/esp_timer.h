@@ -0,0 +1,11 @@
+// esp_timer.h, host build: the simulated clock of host/sim/sim_clock.h
+
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+// Microseconds since boot on the simulated clock, it only moves when the simulation advances it
+int64_t esp_timer_get_time(void);
+
+#endif // ESP_TIMER_H
@@ -0,0 +1,10 @@
+// esp_zigbee_core.h, host build: only the constants main.h uses for its configuration. The host build has no
+// stack, sensor_app.c reaches it through zigbee_hal.h and host/sim/zigbee_fake.c stands in for it
+
+#ifndef ESP_ZIGBEE_CORE_H
+#define ESP_ZIGBEE_CORE_H
+
+#define ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK    0x07FFF800U
+#define ESP_ZB_ED_AGING_TIMEOUT_64MIN           6
+
+#endif // ESP_ZIGBEE_CORE_H
@@ -0,0 +1,13 @@
+// FreeRTOS.h, host build: the types ram_budget.h needs, the host build has no tasks
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#endif // FREERTOS_H
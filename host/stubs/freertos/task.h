@@ -0,0 +1,13 @@
+// task.h, host build
+
+#ifndef FREERTOS_TASK_H
+#define FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+char *pcTaskGetName(TaskHandle_t task);
+
+#endif // FREERTOS_TASK_H
@@ -0,0 +1,236 @@
+// host_stubs.c, host build: the ESP-IDF calls of the portable modules, the 1-Wire bus dispatch and the NVS store
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "onewire_bus.h"
+#include "onewire_crc.h"
+#include "sim_nvs.h"
+
+static esp_log_level_t log_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    if (level > log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+unsigned long esp_log_timestamp(void) {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+void esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *expression) {
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nexpression: %s\n",
+            rc, esp_err_to_name(rc), file, line, expression);
+    abort();
+}
+
+// xorshift32, seeded the same on every run
+static uint32_t random_state = 0x2545F491;
+
+uint32_t esp_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+char *pcTaskGetName(TaskHandle_t task) {
+    static char name[] = "host";
+    return name;
+}
+
+// 1-Wire bus dispatch, as in the component
+
+esp_err_t onewire_bus_reset(onewire_bus_handle_t bus) {
+    return bus == NULL ? ESP_ERR_INVALID_ARG : bus->reset(bus);
+}
+
+esp_err_t onewire_bus_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size) {
+    return bus == NULL || tx_data == NULL ? ESP_ERR_INVALID_ARG : bus->write_bytes(bus, tx_data, tx_data_size);
+}
+
+esp_err_t onewire_bus_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size) {
+    return bus == NULL || rx_buf == NULL ? ESP_ERR_INVALID_ARG : bus->read_bytes(bus, rx_buf, rx_buf_size);
+}
+
+esp_err_t onewire_bus_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit) {
+    return bus == NULL ? ESP_ERR_INVALID_ARG : bus->write_bit(bus, tx_bit);
+}
+
+esp_err_t onewire_bus_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit) {
+    return bus == NULL || rx_bit == NULL ? ESP_ERR_INVALID_ARG : bus->read_bit(bus, rx_bit);
+}
+
+esp_err_t onewire_bus_del(onewire_bus_handle_t bus) {
+    return bus == NULL ? ESP_ERR_INVALID_ARG : bus->del(bus);
+}
+
+uint8_t onewire_crc8(uint8_t init_crc, uint8_t *input, size_t input_size) {
+    uint8_t crc = init_crc;
+    for (size_t i = 0; i < input_size; i++) {
+        uint8_t byte = input[i];
+        for (int b = 0; b < 8; b++) {
+            uint8_t mix = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
+
+// NVS, one flat table of namespace/key entries
+
+#define SIM_NVS_ENTRIES     32
+#define SIM_NVS_VALUE_SIZE  (64 * 16)    // The ROM cache of 64 sensors
+
+typedef struct {
+    bool used;
+    char namespace_name[16];
+    char key[16];
+    size_t length;
+    uint8_t value[SIM_NVS_VALUE_SIZE];
+} sim_nvs_entry_t;
+
+static sim_nvs_entry_t nvs_entries[SIM_NVS_ENTRIES];
+static char nvs_namespaces[8][16];
+static int nvs_namespace_num = 0;
+
+void sim_nvs_erase(void) {
+    memset(nvs_entries, 0, sizeof(nvs_entries));
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    for (int i = 0; i < nvs_namespace_num; i++) {
+        if (strncmp(nvs_namespaces[i], namespace_name, sizeof(nvs_namespaces[i])) == 0) {
+            *out_handle = i;
+            return ESP_OK;
+        }
+    }
+    if (nvs_namespace_num == (int)(sizeof(nvs_namespaces) / sizeof(nvs_namespaces[0]))) {
+        return ESP_ERR_NO_MEM;
+    }
+    strncpy(nvs_namespaces[nvs_namespace_num], namespace_name, sizeof(nvs_namespaces[0]) - 1);
+    *out_handle = nvs_namespace_num++;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+static sim_nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key, bool create) {
+    sim_nvs_entry_t *free_entry = NULL;
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        sim_nvs_entry_t *entry = &nvs_entries[i];
+        if (entry->used && strcmp(entry->namespace_name, nvs_namespaces[handle]) == 0 && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        if (!entry->used && free_entry == NULL) {
+            free_entry = entry;
+        }
+    }
+    if (!create || free_entry == NULL) {
+        return NULL;
+    }
+    free_entry->used = true;
+    strncpy(free_entry->namespace_name, nvs_namespaces[handle], sizeof(free_entry->namespace_name) - 1);
+    strncpy(free_entry->key, key, sizeof(free_entry->key) - 1);
+    return free_entry;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    sim_nvs_entry_t *entry = nvs_find(handle, key, false);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value == NULL) {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if (*length < entry->length) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, entry->value, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    if (length > SIM_NVS_VALUE_SIZE) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    sim_nvs_entry_t *entry = nvs_find(handle, key, true);
+    if (entry == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value) {
+    size_t length = 1;
+    return nvs_get_blob(handle, key, out_value, &length);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+    return nvs_set_blob(handle, key, &value, 1);
+}
@@ -0,0 +1,29 @@
+// onewire_bus.h, host build: the bus interface of the espressif/onewire_bus component, a backend fills in
+// struct onewire_bus_t and the onewire_bus_* calls dispatch through it
+
+#ifndef ONEWIRE_BUS_H
+#define ONEWIRE_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "onewire_types.h"
+
+struct onewire_bus_t {
+    esp_err_t (*reset)(onewire_bus_handle_t bus);
+    esp_err_t (*write_bytes)(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size);
+    esp_err_t (*read_bytes)(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size);
+    esp_err_t (*write_bit)(onewire_bus_handle_t bus, uint8_t tx_bit);
+    esp_err_t (*read_bit)(onewire_bus_handle_t bus, uint8_t *rx_bit);
+    esp_err_t (*del)(onewire_bus_handle_t bus);
+};
+
+// Reset pulse, ESP_ERR_NOT_FOUND if no device answered with a presence pulse
+esp_err_t onewire_bus_reset(onewire_bus_handle_t bus);
+esp_err_t onewire_bus_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size);
+esp_err_t onewire_bus_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size);
+esp_err_t onewire_bus_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit);
+esp_err_t onewire_bus_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit);
+esp_err_t onewire_bus_del(onewire_bus_handle_t bus);
+
+#endif // ONEWIRE_BUS_H
@@ -0,0 +1,12 @@
+// onewire_cmd.h, host build: ROM commands of the espressif/onewire_bus component
+
+#ifndef ONEWIRE_CMD_H
+#define ONEWIRE_CMD_H
+
+#define ONEWIRE_CMD_SEARCH_NORMAL   0xF0
+#define ONEWIRE_CMD_MATCH_ROM       0x55
+#define ONEWIRE_CMD_SKIP_ROM        0xCC
+#define ONEWIRE_CMD_SEARCH_ALARM    0xEC
+#define ONEWIRE_CMD_READ_POWER_SUPPLY 0xB4
+
+#endif // ONEWIRE_CMD_H
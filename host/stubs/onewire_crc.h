@@ -0,0 +1,12 @@
+// onewire_crc.h, host build
+
+#ifndef ONEWIRE_CRC_H
+#define ONEWIRE_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Dallas/Maxim CRC8 (x^8 + x^5 + x^4 + 1) of the ROM codes and the scratchpad
+uint8_t onewire_crc8(uint8_t init_crc, uint8_t *input, size_t input_size);
+
+#endif // ONEWIRE_CRC_H
@@ -0,0 +1,13 @@
+// onewire_types.h, host build: the types of the espressif/onewire_bus component
+
+#ifndef ONEWIRE_TYPES_H
+#define ONEWIRE_TYPES_H
+
+#include <stdint.h>
+
+typedef struct onewire_bus_t *onewire_bus_handle_t;
+
+// ROM code of a device, the family code in the low byte
+typedef uint64_t onewire_device_address_t;
+
+#endif // ONEWIRE_TYPES_H
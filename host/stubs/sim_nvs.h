@@ -0,0 +1,9 @@
+// sim_nvs.h, host build
+
+#ifndef SIM_NVS_H
+#define SIM_NVS_H
+
+// Wipe the in-memory NVS store, the next boot finds no cached ROM codes or settings
+void sim_nvs_erase(void);
+
+#endif // SIM_NVS_H
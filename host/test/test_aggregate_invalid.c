@@ -0,0 +1,69 @@
+// test_aggregate_invalid.c: with the aggregate report, a sensor that stops answering is sent as invalid in the
+// frame, through its quarantine, until a rescan brings it back
+
+#include "test_util.h"
+#include "sim_node.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "ds18b20_sensor.h"
+#include "aggregate_frame.h"
+#include "main.h"
+
+static const double temperatures[] = {20.0, 21.5, 23.0};
+#define SENSOR_NUM  (int)(sizeof(temperatures) / sizeof(temperatures[0]))
+
+// Value of a sensor in the aggregate attribute of the first endpoint
+static int16_t aggregate_value(int index) {
+    uint8_t attr[1 + AGGREGATE_FRAME_MAX_SIZE];
+    TEST_ASSERT(zigbee_fake_get_attr(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID,
+                                     attr, sizeof(attr)));
+    TEST_ASSERT_EQUAL(AGGREGATE_FRAME_VERSION, attr[1]);
+    TEST_ASSERT_EQUAL(SENSOR_NUM, attr[2]);
+    const uint8_t *value = &attr[1 + AGGREGATE_FRAME_HEADER + index * 2];
+    return (int16_t)(value[0] | (value[1] << 8));
+}
+
+int main(void) {
+    int bus = onewire_sim_add_bus(0);
+    int devices[SENSOR_NUM];
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        devices[i] = onewire_sim_add_device(bus, onewire_sim_rom(0x5000 + i), temperatures[i]);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+    sim_node_stack_started(ESP_OK, true);
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 10};
+    zigbee_fake_set_manufacturer_reporting(HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID, &reporting);
+    sensor_app_reporting_configured();
+    sim_node_run_for_ms(30000);
+
+    // The sensor order follows the ROM search, find the index of the middle device by its reading
+    int index = -1;
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        if (aggregate_value(i) == (int16_t)(temperatures[1] * 100)) {
+            index = i;
+        }
+    }
+    TEST_ASSERT(index >= 0);
+
+    // Unplugged: invalid from the first failed read on, not the last good value
+    onewire_sim_set_present(devices[1], false);
+    sim_node_run_for_ms(10000);
+    TEST_ASSERT_EQUAL(AGGREGATE_FRAME_INVALID, aggregate_value(index));
+
+    // Quarantined, still invalid, the other sensors keep their values
+    sim_node_run_for_ms(30000);
+    TEST_ASSERT(ds18b20_is_sensor_quarantined(index));
+    TEST_ASSERT_EQUAL(AGGREGATE_FRAME_INVALID, aggregate_value(index));
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        TEST_ASSERT(i == index || aggregate_value(i) != AGGREGATE_FRAME_INVALID);
+    }
+
+    // Plugged again at the same temperature: the rescan brings it back and the frame carries it, although the
+    // value did not change since its last report
+    onewire_sim_set_present(devices[1], true);
+    sim_node_run_for_ms(ESP_TEMP_SENSOR_RESCAN_PERIOD_MS + 30000);
+    TEST_ASSERT(!ds18b20_is_sensor_quarantined(index));
+    TEST_ASSERT_EQUAL((int16_t)(temperatures[1] * 100), aggregate_value(index));
+    TEST_PASS();
+}
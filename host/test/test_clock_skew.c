@@ -0,0 +1,99 @@
+// test_clock_skew.c: a node whose crystal runs 80 ppm slow against the coordinator. Once synced, every cycle has
+// to start on the 5 s grid of the coordinator's time, checked against the coordinator clock of the fake and not
+// the node's own model, and the grid must not drift away between the readings of the Time attribute. After two
+// skew windows the skew estimate, the slot jitter and the sample timestamps are checked as well
+
+#include <stdlib.h>
+#include "test_util.h"
+#include "sim_node.h"
+#include "sim_clock.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "latency_stats.h"
+#include "time_sync.h"
+#include "main.h"
+
+#define SKEW_PPM            80
+#define TIME_LATENCY_MS     40
+#define NETWORK_START_S     800000000u
+
+static int bus;
+static int device;
+static uint32_t timestamp_writes;
+static uint32_t timestamps;         // Sample timestamps checked
+
+// Distance of the last Convert-T from the nearest slot of the coordinator's grid, in microseconds
+static int64_t conversion_slot_error_us(void) {
+    onewire_sim_stats_t stats;
+    onewire_sim_get_stats(bus, &stats);
+    int64_t period_us = (int64_t)ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS * 1000;
+    int64_t offset_us = (zigbee_fake_network_us(stats.last_conversion_us) - (int64_t)ESP_TEMP_SAMPLE_PHASE_MS * 1000) % period_us;
+    return offset_us > period_us / 2 ? offset_us - period_us : offset_us;
+}
+
+// Run for hours, one period at a time, and return the largest slot error of the cycles
+static int64_t run_cycles(uint32_t hours) {
+    int64_t max_error_us = 0;
+    for (uint32_t period = 0; period < hours * 3600 * 1000 / ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS; period++) {
+        // A step of half a degree every minute, so the endpoint reports and stamps its samples
+        if (period % 12 == 0) {
+            onewire_sim_set_temperature(device, period % 24 == 0 ? 20.0 : 20.5);
+        }
+        sim_node_run_for_ms(ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS);
+        int64_t error_us = llabs(conversion_slot_error_us());
+        max_error_us = error_us > max_error_us ? error_us : max_error_us;
+
+        // A sample published in this period carries the network time it was taken at
+        uint32_t writes = zigbee_fake_get_attr_writes(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, HA_ESP_SENSOR_ENDPOINT,
+                                                      CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID);
+        if (writes != timestamp_writes) {
+            timestamp_writes = writes;
+            uint32_t timestamp_s;
+            TEST_ASSERT(zigbee_fake_get_attr(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, HA_ESP_SENSOR_ENDPOINT,
+                                             CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID, &timestamp_s, sizeof(timestamp_s)));
+            int64_t network_s = zigbee_fake_network_us(sim_clock_now_us()) / 1000000;
+            TEST_ASSERT(timestamp_s <= network_s && timestamp_s + ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS / 1000 >= network_s);
+            timestamps++;
+        }
+    }
+    return max_error_us;
+}
+
+int main(void) {
+    bus = onewire_sim_add_bus(0);
+    device = onewire_sim_add_device(bus, onewire_sim_rom(0x5000), 20.0);
+    zigbee_fake_set_time_server(true, NETWORK_START_S, SKEW_PPM, TIME_LATENCY_MS);
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+    sim_node_stack_started(ESP_OK, true);
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 0};
+    zigbee_fake_set_temperature_reporting(HA_ESP_SENSOR_ENDPOINT, &reporting);
+    sensor_app_reporting_configured();
+    sim_node_run_for_ms(60000);
+    TEST_ASSERT(zigbee_fake_get_time_read_count() > 0);
+    timestamp_writes = zigbee_fake_get_attr_writes(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, HA_ESP_SENSOR_ENDPOINT,
+                                                   CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID);
+
+    // Until the skew is known the model allows TIME_SYNC_DRIFT_ALLOWANCE_PPM between two readings, the interval
+    // settles near sqrt(2 * 100 ppm * 300 s) = 245 ms, the round trip comes on top
+    run_cycles(1);                      // Converging from the start-up interval, not bounded
+    int64_t skew_unknown_us = run_cycles(11);
+    TEST_ASSERT(skew_unknown_us < 350000);
+
+    // Two skew windows in, the skew is corrected and only TIME_SYNC_RESIDUAL_DRIFT_PPM is allowed: ~80 ms
+    run_cycles(2);
+    int32_t skew_ppb;
+    TEST_ASSERT(zigbee_fake_get_attr(ZIGBEE_FAKE_CLUSTER_DIAGNOSTICS, HA_ESP_SENSOR_ENDPOINT,
+                                     CUSTOM_DIAG_TIME_ATTR_ID(CUSTOM_DIAG_TIME_SKEW_PPB), &skew_ppb, sizeof(skew_ppb)));
+    TEST_ASSERT_WITHIN(5000, SKEW_PPM * 1000, skew_ppb);
+    int64_t skew_known_us = run_cycles(12);
+    TEST_ASSERT(skew_known_us < 80000);
+
+    // The node's own jitter metric saw every slotted cycle
+    latency_histogram_t slot;
+    latency_stats_get(LATENCY_PHASE_SLOT, &slot);
+    TEST_ASSERT(slot.count > 25 * 3600 * 1000 / ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS);
+    TEST_ASSERT(timestamps > 25 * 60);
+
+    TEST_PASS();
+}
@@ -0,0 +1,106 @@
+// test_fault_injection.c: a bus with CRC errors, dropouts, failed resets and brownouts keeps delivering correct
+// readings without a restart, the error counters see every kind of fault, and a probe that dies is quarantined
+// and replaced in place by a hot-plugged one
+
+#include "test_util.h"
+#include "sim_node.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "ds18b20_sensor.h"
+#include "main.h"
+
+// On the 0.25 °C grid, so 10 and 12 bit read the same
+static const double temperatures[] = {20.0, 21.5, -3.5, 30.25};
+#define SENSOR_NUM  (int)(sizeof(temperatures) / sizeof(temperatures[0]))
+#define FAULT_MINUTES   10
+
+// Index of the sensor reading celsius, -1 if none does
+static int sensor_reading(double celsius) {
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        int16_t value;
+        if (zigbee_fake_get_temperature(HA_ESP_SENSOR_ENDPOINT + i, &value) && value == (int16_t)(celsius * 100)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(void) {
+    int bus = onewire_sim_add_bus(0);
+    int devices[SENSOR_NUM];
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        devices[i] = onewire_sim_add_device(bus, onewire_sim_rom(0x9000 + i), temperatures[i]);
+    }
+    onewire_sim_seed(12);
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+    sim_node_stack_started(ESP_OK, true);
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 0};
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        zigbee_fake_set_temperature_reporting(HA_ESP_SENSOR_ENDPOINT + i, &reporting);
+    }
+    sensor_app_reporting_configured();
+    sim_node_run_for_ms(30000);
+
+    int index_of[SENSOR_NUM];
+    for (int d = 0; d < SENSOR_NUM; d++) {
+        index_of[d] = sensor_reading(temperatures[d]);
+        TEST_ASSERT(index_of[d] >= 0);
+    }
+
+    // A noisy bus: none of the faults may reach the attributes, not even the 85 °C of a brownout
+    const onewire_sim_faults_t faults = {
+        .reset_fail_ppm = 10000,
+        .dropout_ppm = 5000,
+        .crc_error_ppm = 10000,     // ~9 % of the scratchpad reads
+        .power_on_ppm = 20000,
+    };
+    onewire_sim_set_faults(bus, &faults);
+    uint32_t writes_before = zigbee_fake_get_attr_writes(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, HA_ESP_SENSOR_ENDPOINT, 0x0000);
+    for (int s = 0; s < FAULT_MINUTES * 60; s++) {
+        sim_node_run_for_ms(1000);
+        for (int d = 0; d < SENSOR_NUM; d++) {
+            int16_t value;
+            TEST_ASSERT(zigbee_fake_get_temperature(HA_ESP_SENSOR_ENDPOINT + index_of[d], &value));
+            TEST_ASSERT_EQUAL((int16_t)(temperatures[d] * 100), value);
+        }
+    }
+
+    // Every kind of fault was injected and counted, the readings kept coming and nobody was quarantined
+    onewire_sim_stats_t bus_stats;
+    onewire_sim_get_stats(bus, &bus_stats);
+    TEST_ASSERT(bus_stats.crc_errors > 0 && bus_stats.dropouts > 0 && bus_stats.reset_failures > 0 && bus_stats.power_ons > 0);
+    ds18b20_sensor_stats_t total = {0};
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        ds18b20_sensor_stats_t stats;
+        TEST_ASSERT_EQUAL(ESP_OK, ds18b20_get_sensor_stats(i, &stats));
+        TEST_ASSERT(stats.reads > FAULT_MINUTES * 60 / 10);
+        TEST_ASSERT_EQUAL(0, stats.quarantines);
+        TEST_ASSERT(!ds18b20_is_sensor_quarantined(i));
+        total.crc_errors += stats.crc_errors;
+        total.bus_errors += stats.bus_errors;
+        total.power_on_values += stats.power_on_values;
+        total.retries += stats.retries;
+    }
+    TEST_ASSERT(zigbee_fake_get_attr_writes(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, HA_ESP_SENSOR_ENDPOINT, 0x0000) > writes_before);
+    TEST_ASSERT(total.crc_errors > 0 && total.bus_errors > 0 && total.power_on_values > 0 && total.retries > 0);
+
+    // A probe that dies is quarantined after DS18B20_QUARANTINE_CYCLES failed cycles, the others go on
+    onewire_sim_faults_t no_faults = {0};
+    onewire_sim_set_faults(bus, &no_faults);
+    int dead = index_of[1];
+    onewire_sim_set_present(devices[1], false);
+    sim_node_run_for_ms(30000);
+    TEST_ASSERT(ds18b20_is_sensor_quarantined(dead));
+    ds18b20_sensor_stats_t stats;
+    ds18b20_get_sensor_stats(dead, &stats);
+    TEST_ASSERT_EQUAL(1, stats.quarantines);
+
+    // Its replacement on the same bus takes over the index and the endpoint at the next re-scan, no reboot
+    onewire_sim_add_device(bus, onewire_sim_rom(0x9100), 42.0);
+    sim_node_run_for_ms(ESP_TEMP_SENSOR_RESCAN_PERIOD_MS + 30000);
+    TEST_ASSERT(!ds18b20_is_sensor_quarantined(dead));
+    TEST_ASSERT_EQUAL(dead, sensor_reading(42.0));
+    TEST_ASSERT_EQUAL(SENSOR_NUM, ds18b20_get_sensor_count());
+    TEST_PASS();
+}
@@ -0,0 +1,67 @@
+// test_history_confirm.c: history samples stay stored until the APS confirm of their frame says they arrived, a
+// frame that failed or was never confirmed is sent again
+
+#include "test_util.h"
+#include "sim_node.h"
+#include "sim_clock.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sample_history.h"
+#include "main.h"
+
+#define OFFLINE_MIN     20
+
+// Samples in the history frames reported from index first on
+static uint32_t history_samples_sent(uint32_t first, uint32_t *frames) {
+    uint32_t samples = 0;
+    *frames = 0;
+    for (uint32_t i = first; i < zigbee_fake_get_report_count(); i++) {
+        const zigbee_fake_report_t *report = zigbee_fake_get_report(i);
+        if (report->attr_id == CUSTOM_TEMP_HISTORY_ATTRIBUTE_ID) {
+            samples += report->value[1 + 2];  // Count byte of the frame after the octet string length
+            (*frames)++;
+        }
+    }
+    return samples;
+}
+
+int main(void) {
+    int bus = onewire_sim_add_bus(0);
+    onewire_sim_add_device(bus, onewire_sim_rom(0x4000), 21.0);
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+
+    // Factory new with the coordinator down, the samples go to the history
+    zigbee_fake_set_network(false, 15, 0x1A62, 2000);
+    sim_node_stack_started(ESP_OK, true);
+    sim_node_run_for_ms(OFFLINE_MIN * 60 * 1000);
+    uint32_t frames;
+    TEST_ASSERT_EQUAL(0, history_samples_sent(0, &frames));
+
+    // Back on the network, but no frame gets through: each one is retried and nothing is dropped
+    zigbee_fake_set_confirm(ESP_FAIL, 20);
+    zigbee_fake_set_network(true, 15, 0x1A62, 2000);
+    sim_node_run_for_ms(6 * 60 * 1000);
+    uint32_t failed_first = history_samples_sent(0, &frames);
+    TEST_ASSERT(frames >= 3);
+    TEST_ASSERT_EQUAL(SAMPLE_HISTORY_FRAME_SAMPLES * frames, failed_first);
+
+    // No confirm at all: the same frame goes out again after the confirm timeout
+    uint32_t first = zigbee_fake_get_report_count();
+    zigbee_fake_set_confirm(ESP_OK, UINT32_MAX);
+    sim_node_run_for_ms(25 * 1000);
+    history_samples_sent(first, &frames);
+    TEST_ASSERT(frames >= 2 && frames <= 3);
+
+    // Confirmed frames release their samples, every sample taken offline arrives exactly once. Steering backs
+    // off while the coordinator is down, so the node may have joined only minutes after it came up
+    first = zigbee_fake_get_report_count();
+    zigbee_fake_set_confirm(ESP_OK, 20);
+    sim_node_run_for_ms(60 * 1000);
+    uint32_t delivered = history_samples_sent(first, &frames);
+    TEST_ASSERT(delivered > SAMPLE_HISTORY_FRAME_SAMPLES);
+    TEST_ASSERT(delivered >= OFFLINE_MIN && delivered <= OFFLINE_MIN + 6);
+    TEST_ASSERT_EQUAL((delivered + SAMPLE_HISTORY_FRAME_SAMPLES - 1) / SAMPLE_HISTORY_FRAME_SAMPLES, frames);
+    sim_node_run_for_ms(60 * 1000);
+    TEST_ASSERT_EQUAL(delivered, history_samples_sent(first, &frames));
+    TEST_PASS();
+}
@@ -0,0 +1,57 @@
+// test_init_backoff.c: a failing BDB initialization is retried with a growing backoff while the node samples into
+// its offline history, and the history reaches the coordinator once the stack is up
+
+#include "test_util.h"
+#include "sim_node.h"
+#include "sim_clock.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "rejoin_policy.h"
+#include "main.h"
+
+#define INIT_FAILURES   5
+
+int main(void) {
+    int bus = onewire_sim_add_bus(0);
+    onewire_sim_add_device(bus, onewire_sim_rom(0x3000), 21.0);
+    onewire_sim_add_device(bus, onewire_sim_rom(0x3001), 22.0);
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+
+    // The first initialization (started by main.c) failed, the fake fails the retries INIT_FAILURES times more
+    zigbee_fake_set_initialization(INIT_FAILURES, false, 500);
+    sim_node_stack_started(ESP_FAIL, false);
+
+    const rejoin_policy_config_t config = REJOIN_POLICY_DEFAULT_CONFIG(ESP_ZB_PRIMARY_CHANNEL_MASK);
+    uint32_t backoff_ms = config.base_delay_ms;
+    int64_t failed_us = sim_clock_now_us();
+    for (int attempt = 0; attempt <= INIT_FAILURES; attempt++) {
+        uint32_t count = zigbee_fake_get_initialization_count();
+        while (zigbee_fake_get_initialization_count() == count) {
+            sim_node_run_for_ms(10);
+        }
+        // Equal jitter in the upper half of a backoff that doubles per failure
+        int64_t delay_ms = (zigbee_fake_get_last_initialization_us() - failed_us) / 1000;
+        TEST_ASSERT(delay_ms >= backoff_ms / 2);
+        TEST_ASSERT(delay_ms <= backoff_ms + 10);
+        backoff_ms = backoff_ms > config.max_delay_ms / 2 ? config.max_delay_ms : backoff_ms * 2;
+        failed_us = zigbee_fake_get_last_initialization_us() + 500 * 1000;
+    }
+    TEST_ASSERT_EQUAL(INIT_FAILURES + 1, zigbee_fake_get_initialization_count());
+
+    // Sampling ran all along, off the network it only feeds the history
+    onewire_sim_stats_t stats;
+    onewire_sim_get_stats(bus, &stats);
+    TEST_ASSERT(stats.conversions > 0);
+    int16_t value;
+    TEST_ASSERT(!zigbee_fake_get_temperature(HA_ESP_SENSOR_ENDPOINT, &value));
+
+    // The last retry succeeds: a reboot onto the known network, the history follows
+    sim_node_run_for_ms(5000);
+    bool history_sent = false;
+    for (uint32_t i = 0; i < zigbee_fake_get_report_count(); i++) {
+        history_sent |= zigbee_fake_get_report(i)->attr_id == CUSTOM_TEMP_HISTORY_ATTRIBUTE_ID;
+    }
+    TEST_ASSERT(history_sent);
+    TEST_ASSERT_EQUAL(0, zigbee_fake_get_steering_count());
+    TEST_PASS();
+}
@@ -0,0 +1,59 @@
+// test_latency_stats.c: a histogram snapshot taken while another thread records into the phase is consistent,
+// its count, buckets and 64 bit total describe the same samples
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "test_util.h"
+#include "latency_stats.h"
+
+#define RECORDS_PER_BUCKET  60000   // Below the bucket saturation
+
+// A duration of bucket i, see LATENCY_HISTOGRAM_BUCKETS
+static uint32_t bucket_duration_us(int bucket) {
+    return bucket == 0 ? 10 : (1u << (bucket + 5)) + 1;
+}
+
+static atomic_bool reader_started;
+static atomic_bool writer_done;
+
+static void *writer_thread(void *arg) {
+    while (!atomic_load(&reader_started)) {
+    }
+    for (int i = 0; i < RECORDS_PER_BUCKET * LATENCY_HISTOGRAM_BUCKETS; i++) {
+        latency_stats_record(LATENCY_PHASE_READ, bucket_duration_us(i % LATENCY_HISTOGRAM_BUCKETS));
+    }
+    atomic_store(&writer_done, true);
+    return NULL;
+}
+
+int main(void) {
+    pthread_t writer;
+    TEST_ASSERT_EQUAL(0, pthread_create(&writer, NULL, writer_thread, NULL));
+
+    uint32_t snapshots = 0;
+    uint32_t last_count = 0;
+    bool done;
+    atomic_store(&reader_started, true);
+    do {
+        done = atomic_load(&writer_done);
+        latency_histogram_t histogram;
+        latency_stats_get(LATENCY_PHASE_READ, &histogram);
+        uint32_t count = 0;
+        uint64_t total_us = 0;
+        for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+            count += histogram.buckets[i];
+            total_us += (uint64_t)histogram.buckets[i] * bucket_duration_us(i);
+        }
+        TEST_ASSERT_EQUAL(histogram.count, count);
+        TEST_ASSERT_EQUAL(histogram.total_us, total_us);
+        TEST_ASSERT(histogram.count >= last_count);  // A fallback snapshot may repeat, never go back
+        last_count = histogram.count;
+        snapshots++;
+    } while (!done);
+    pthread_join(writer, NULL);
+
+    TEST_ASSERT_EQUAL(RECORDS_PER_BUCKET * LATENCY_HISTOGRAM_BUCKETS, last_count);
+    TEST_ASSERT(snapshots > 1);
+    TEST_PASS();
+}
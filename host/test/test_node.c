@@ -0,0 +1,71 @@
+// test_node.c: a node boots on a simulated bus, joins and publishes what its sensors measure
+
+#include "test_util.h"
+#include "sim_node.h"
+#include "sim_clock.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "main.h"
+
+static const double temperatures[] = {20.0, 21.5, -3.5, 30.0};
+#define SENSOR_NUM  (int)(sizeof(temperatures) / sizeof(temperatures[0]))
+
+int main(void) {
+    int bus = onewire_sim_add_bus(0);
+    int devices[SENSOR_NUM];
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        devices[i] = onewire_sim_add_device(bus, onewire_sim_rom(0x1000 + i), temperatures[i]);
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+    TEST_ASSERT_EQUAL(SENSOR_NUM, sensor_app_get_sensor_count());
+    sim_node_stack_started(ESP_OK, true);
+    TEST_ASSERT_EQUAL(1, zigbee_fake_get_steering_count());
+
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 10};
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        zigbee_fake_set_temperature_reporting(HA_ESP_SENSOR_ENDPOINT + i, &reporting);
+    }
+    sensor_app_reporting_configured();
+    sim_node_run_for_ms(30000);
+
+    // The sensor order follows the ROM search, find each device by its reading
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        int16_t value;
+        TEST_ASSERT(zigbee_fake_get_temperature(HA_ESP_SENSOR_ENDPOINT + i, &value));
+        bool known = false;
+        for (int d = 0; d < SENSOR_NUM; d++) {
+            known |= value == (int16_t)(temperatures[d] * 100);
+        }
+        TEST_ASSERT(known);
+    }
+
+    // A change shows up within a reporting interval
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        onewire_sim_set_temperature(devices[i], 25.0);
+    }
+    sim_node_run_for_ms(15000);
+    for (int i = 0; i < SENSOR_NUM; i++) {
+        int16_t value;
+        TEST_ASSERT(zigbee_fake_get_temperature(HA_ESP_SENSOR_ENDPOINT + i, &value));
+        TEST_ASSERT_EQUAL(2500, value);
+    }
+
+    // The node synced to the coordinator clock on the way
+    TEST_ASSERT(zigbee_fake_get_time_read_count() > 0);
+    uint32_t timestamp_s;
+    TEST_ASSERT(zigbee_fake_get_attr(ZIGBEE_FAKE_CLUSTER_TEMPERATURE, HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID,
+                                     &timestamp_s, sizeof(timestamp_s)));
+    TEST_ASSERT(timestamp_s != CUSTOM_TEMP_TIMESTAMP_INVALID);
+    TEST_ASSERT_WITHIN(20, zigbee_fake_network_us(sim_clock_now_us()) / 1000000, timestamp_s);
+
+    // A non-zero write of the trace dump attribute of the first endpoint hands the dump to the platform
+    uint8_t dump = 1, no_dump = 0;
+    sensor_app_attr_written(HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID, &no_dump);
+    sensor_app_attr_written(HA_ESP_SENSOR_ENDPOINT + 1, CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID, &dump);
+    TEST_ASSERT_EQUAL(0, sim_node_get_trace_dumps());
+    sensor_app_attr_written(HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID, &dump);
+    TEST_ASSERT_EQUAL(1, sim_node_get_trace_dumps());
+    TEST_PASS();
+}
@@ -0,0 +1,28 @@
+// test_raw_conversion.c: the integer conversion of ds18b20_sensor.c against the floating point definition,
+// for every one of the 65536 raw codes
+
+#include <math.h>
+#include "test_util.h"
+#include "ds18b20_sensor.h"
+
+int main(void) {
+    int mismatches = 0;
+    for (int32_t code = INT16_MIN; code <= INT16_MAX; code++) {
+        long expected = lround(code / 16.0 * 100);
+        int32_t actual = ds18b20_raw_to_centi_degrees((int16_t)code);
+        if (actual != expected) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "raw %d: %ld expected, %ld converted\n", (int)code, expected, (long)actual);
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(0, mismatches);
+
+    // The ends of the measuring range still fit a ZCL temperature
+    TEST_ASSERT_EQUAL(-5500, ds18b20_raw_to_centi_degrees(-55 * 16));
+    TEST_ASSERT_EQUAL(12500, ds18b20_raw_to_centi_degrees(125 * 16));
+    TEST_ASSERT_EQUAL(13, ds18b20_raw_to_centi_degrees(2));    // 0.125 °C, half away from zero
+    TEST_ASSERT_EQUAL(-13, ds18b20_raw_to_centi_degrees(-2));
+    TEST_ASSERT_EQUAL(-6, ds18b20_raw_to_centi_degrees(-1));   // -0.0625 °C
+    TEST_PASS();
+}
@@ -0,0 +1,121 @@
+// test_report_filter.c: report_filter.c on its own. The deadband, the hysteresis on a reversal and the minimum and
+// maximum intervals each get a hand-made sequence, report_filter_force() has to get through all of them. Then a day
+// of 5 s samples, a slow drift with noise around the deadband, shows how many writes the filter saves
+
+#include <math.h>
+#include "test_util.h"
+#include "report_filter.h"
+
+#define SAMPLE_PERIOD_MS    5000
+#define DAY_SAMPLES         (24 * 3600 * 1000 / SAMPLE_PERIOD_MS)
+
+static const report_filter_config_t config = REPORT_FILTER_DEFAULT_CONFIG();
+
+static uint32_t random_state = 99;
+
+// Standard normal by the sum of 12 uniforms
+static double noise_gaussian(void) {
+    double sum = 0;
+    for (int i = 0; i < 12; i++) {
+        random_state = random_state * 1664525u + 1013904223u;
+        sum += (random_state >> 8) / 16777216.0;
+    }
+    return sum - 6;
+}
+
+static void test_deadband(void) {
+    report_filter_t filter;
+    report_filter_init(&filter);
+    TEST_ASSERT(report_filter_update(&filter, &config, 2000, 0));           // The first sample always
+    TEST_ASSERT(!report_filter_update(&filter, &config, 2049, 60000));      // Below the deadband
+    TEST_ASSERT(!report_filter_update(&filter, &config, 1951, 120000));
+    TEST_ASSERT(report_filter_update(&filter, &config, 2050, 180000));      // At the deadband
+    TEST_ASSERT(report_filter_update(&filter, &config, 2100, 240000));      // Same direction, no hysteresis
+    TEST_ASSERT_EQUAL(5, filter.samples);
+    TEST_ASSERT_EQUAL(3, filter.reports);
+}
+
+static void test_hysteresis(void) {
+    report_filter_t filter;
+    report_filter_init(&filter);
+    report_filter_update(&filter, &config, 2000, 0);
+    TEST_ASSERT(report_filter_update(&filter, &config, 2050, 60000));       // Rising
+    TEST_ASSERT(!report_filter_update(&filter, &config, 2000, 120000));     // Turning around needs 50 + 10
+    TEST_ASSERT(!report_filter_update(&filter, &config, 1991, 180000));
+    TEST_ASSERT(report_filter_update(&filter, &config, 1990, 240000));
+    TEST_ASSERT(report_filter_update(&filter, &config, 1940, 300000));      // Falling on, the deadband again
+    TEST_ASSERT_EQUAL(4, filter.reports);
+}
+
+static void test_intervals(void) {
+    report_filter_t filter;
+    report_filter_init(&filter);
+    report_filter_update(&filter, &config, 2000, 0);
+    TEST_ASSERT(!report_filter_update(&filter, &config, 2500, config.min_interval_ms - 1));
+    TEST_ASSERT(report_filter_update(&filter, &config, 2500, config.min_interval_ms));
+
+    // No change at all still reports once the maximum interval is up
+    uint32_t last_ms = config.min_interval_ms;
+    TEST_ASSERT(!report_filter_update(&filter, &config, 2500, last_ms + config.max_interval_ms - 1));
+    TEST_ASSERT(report_filter_update(&filter, &config, 2500, last_ms + config.max_interval_ms));
+
+    // 0 disables the maximum interval
+    report_filter_config_t no_max = config;
+    no_max.max_interval_ms = 0;
+    TEST_ASSERT(!report_filter_update(&filter, &no_max, 2500, last_ms + 10 * config.max_interval_ms));
+    TEST_ASSERT_EQUAL(3, filter.reports);
+}
+
+static void test_force(void) {
+    report_filter_t filter;
+    report_filter_init(&filter);
+    report_filter_update(&filter, &config, 2000, 0);
+    TEST_ASSERT(report_filter_force(&filter, 2001, 1000));      // Inside the deadband and the minimum interval
+    TEST_ASSERT(!report_filter_force(&filter, 2001, 2000));     // Exactly the value reported last
+    TEST_ASSERT(report_filter_force(&filter, 1990, 3000));      // A reversal without the hysteresis
+
+    // The forced value and its direction are the new reference of the filter, rising again is a reversal
+    TEST_ASSERT(!report_filter_update(&filter, &config, 2040, 60000));
+    TEST_ASSERT(report_filter_update(&filter, &config, 2050, 120000));
+    TEST_ASSERT_EQUAL(6, filter.samples);
+    TEST_ASSERT_EQUAL(4, filter.reports);
+}
+
+// A room drifting by 3 °C over the day with 0.15 °C of noise, quantized to the 1/16 °C of the DS18B20. Between
+// two reports the coordinator's value may be off by the deadband and the hysteresis, plus the noise of the sample
+// that was reported, for at most the minimum interval any more than that
+static void test_trace(void) {
+    report_filter_t filter;
+    report_filter_init(&filter);
+    int16_t reported = 0;
+    uint32_t reported_ms = 0;
+    for (uint32_t i = 0; i < DAY_SAMPLES; i++) {
+        uint32_t now_ms = i * SAMPLE_PERIOD_MS;
+        double truth = 2100 + 150 * sin(2 * M_PI * i / DAY_SAMPLES);
+        int16_t value = (int16_t)(lround((truth + 15 * noise_gaussian()) * 16 / 100) * 100 / 16);
+        if (report_filter_update(&filter, &config, value, now_ms)) {
+            TEST_ASSERT(i == 0 || now_ms - reported_ms >= config.min_interval_ms);
+            reported = value;
+            reported_ms = now_ms;
+        } else {
+            TEST_ASSERT(now_ms - reported_ms < config.max_interval_ms);
+            TEST_ASSERT(now_ms - reported_ms < config.min_interval_ms
+                        || abs(value - reported) < config.deadband + config.hysteresis);
+        }
+    }
+
+    // The maximum interval alone takes 144 reports a day, the drift and the noise add about as many again. Without
+    // the filter every one of the 17280 samples would be written
+    TEST_ASSERT_EQUAL(DAY_SAMPLES, filter.samples);
+    TEST_ASSERT(filter.reports >= 24 * 3600 * 1000 / config.max_interval_ms);
+    TEST_ASSERT(filter.reports * 50 < filter.samples);
+}
+
+int main(void) {
+    test_deadband();
+    test_hysteresis();
+    test_intervals();
+    test_force();
+    test_trace();
+    TEST_PASS();
+}
@@ -0,0 +1,116 @@
+// test_resolution_trace.c: replays a temperature trace (quiet, a fast ramp, quiet again) into one probe and shows
+// what the adaptive resolution trades: conversion time against precision. Quiet stretches run at 10 bit with a
+// quarter of the conversion wait, a change brings 12 bit back within a few cycles
+
+#include <stdlib.h>
+#include <math.h>
+#include "test_util.h"
+#include "sim_node.h"
+#include "sim_clock.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "sensor_app.h"
+#include "latency_stats.h"
+#include "main.h"
+
+// Knots of the trace, linear in between
+typedef struct {
+    uint32_t time_s;
+    double celsius;
+} trace_knot_t;
+
+static const trace_knot_t trace[] = {
+    {0, 21.30}, {60, 21.36}, {120, 21.30},      // Quiet, well below the stable delta per cycle
+    {240, 39.30},                               // 0.15 °C/s, 0.75 °C per cycle
+    {300, 39.34}, {420, 39.30},                 // Quiet again
+};
+#define TRACE_KNOTS     (int)(sizeof(trace) / sizeof(trace[0]))
+
+static double trace_celsius(double time_s) {
+    for (int i = 1; i < TRACE_KNOTS; i++) {
+        if (time_s <= trace[i].time_s) {
+            double f = (time_s - trace[i - 1].time_s) / (trace[i].time_s - trace[i - 1].time_s);
+            return trace[i - 1].celsius + f * (trace[i].celsius - trace[i - 1].celsius);
+        }
+    }
+    return trace[TRACE_KNOTS - 1].celsius;
+}
+
+// Replay statistics of one stretch of the trace
+typedef struct {
+    uint32_t from_s, to_s;      // Evaluated part, after the policy had time to settle
+    uint32_t seconds;
+    uint32_t bits_sum;
+    int min_bits, max_bits;
+    int32_t max_error;          // Centi-degrees between MeasuredValue and the trace
+    uint32_t conversions;
+    uint64_t conversion_us;
+} trace_segment_t;
+
+int main(void) {
+    int bus = onewire_sim_add_bus(0);
+    int device = onewire_sim_add_device(bus, onewire_sim_rom(0x7000), trace[0].celsius);
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+    sim_node_stack_started(ESP_OK, true);
+    zigbee_hal_reporting_t reporting = {.min_interval_s = 5, .max_interval_s = 60, .delta = 0};
+    zigbee_fake_set_temperature_reporting(HA_ESP_SENSOR_ENDPOINT, &reporting);
+    sensor_app_reporting_configured();
+
+    trace_segment_t segments[] = {
+        {.from_s = 80, .to_s = 120},    // Quiet
+        {.from_s = 135, .to_s = 240},   // Ramp
+        {.from_s = 340, .to_s = 420},   // Quiet again
+    };
+    const int segment_num = sizeof(segments) / sizeof(segments[0]);
+    for (int s = 0; s < segment_num; s++) {
+        segments[s].min_bits = 12;
+        segments[s].max_bits = 9;
+    }
+
+    int64_t start_us = sim_clock_now_us();
+    for (uint32_t t = 0; t < trace[TRACE_KNOTS - 1].time_s; t++) {
+        latency_histogram_t before, after;
+        latency_stats_get(LATENCY_PHASE_CONVERSION, &before);
+        // The probe follows the trace within each second of the replay
+        for (int step = 0; step < 10; step++) {
+            onewire_sim_set_temperature(device, trace_celsius(t + step / 10.0));
+            sim_node_run_until(start_us + (int64_t)t * 1000000 + (step + 1) * 100000);
+        }
+        latency_stats_get(LATENCY_PHASE_CONVERSION, &after);
+
+        for (int s = 0; s < segment_num; s++) {
+            trace_segment_t *segment = &segments[s];
+            if (t < segment->from_s || t >= segment->to_s) {
+                continue;
+            }
+            int bits = onewire_sim_get_resolution_bits(device);
+            int16_t value;
+            TEST_ASSERT(zigbee_fake_get_temperature(HA_ESP_SENSOR_ENDPOINT, &value));
+            int32_t error = abs(value - (int32_t)lround(trace_celsius(t + 1) * 100));
+            segment->seconds++;
+            segment->bits_sum += bits;
+            segment->min_bits = bits < segment->min_bits ? bits : segment->min_bits;
+            segment->max_bits = bits > segment->max_bits ? bits : segment->max_bits;
+            segment->max_error = error > segment->max_error ? error : segment->max_error;
+            segment->conversions += after.count - before.count;
+            segment->conversion_us += after.total_us - before.total_us;
+        }
+    }
+
+    for (int s = 0; s < segment_num; s++) {
+        TEST_ASSERT(segments[s].conversions > 0);
+    }
+
+    // Quiet: 10 bit, the conversion wait drops from 750 to 188 ms, a reading stays within one 10 bit step
+    for (int s = 0; s < segment_num; s += 2) {
+        TEST_ASSERT_EQUAL(10, segments[s].max_bits);
+        TEST_ASSERT(segments[s].conversion_us / segments[s].conversions < 250000);
+        TEST_ASSERT(segments[s].max_error <= 25 + 6);
+    }
+    // Ramp: back at 12 bit for the whole stretch. The error is lag, of the sample filter and of up to two sampling
+    // periods, not resolution: 0.15 °C/s for 20 s at most
+    TEST_ASSERT_EQUAL(12, segments[1].min_bits);
+    TEST_ASSERT(segments[1].conversion_us / segments[1].conversions > 700000);
+    TEST_ASSERT(segments[1].max_error <= 15 * 20);
+    TEST_PASS();
+}
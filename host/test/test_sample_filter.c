@@ -0,0 +1,120 @@
+// test_sample_filter.c: the filters of sample_filter.c on a noisy probe trace. 21 °C, a 10 °C ramp over 200 samples
+// (1000 s at the 5 s period), then 31 °C. Gaussian noise of 0.15 °C, quantized to the 1/16 °C step of the DS18B20,
+// with an 85 °C power-on value, a -127 °C dropout and a single 3 °C glitch the CRC missed. The trace comes from
+// a fixed seed, so every run sees the same samples. Each filter has to reduce the noise variance in the quiet
+// stretches, stay within its lag budget on the ramp and never pass the impossible readings
+
+#include <math.h>
+#include "test_util.h"
+#include "sample_filter.h"
+#include "ds18b20_sensor.h"
+#include "main.h"
+
+#define QUIET_SAMPLES   400
+#define RAMP_SAMPLES    200
+#define RAMP_STEP       5       // Centi-degrees per sample
+#define TRACE_SAMPLES   (QUIET_SAMPLES + RAMP_SAMPLES + QUIET_SAMPLES)
+#define NOISE_SIGMA     15.0    // Centi-degrees
+#define SETTLE_SAMPLES  20      // Left out at the start of a stretch
+#define GLITCH_SAMPLE   250     // Left out of the noise variance, with the SETTLE_SAMPLES after it
+
+static int16_t truth[TRACE_SAMPLES];
+static int16_t trace[TRACE_SAMPLES];
+
+static uint32_t noise_state = 20240601;
+
+// Standard normal by the sum of 12 uniforms, good enough for a noise trace
+static double noise_gaussian(void) {
+    double sum = 0;
+    for (int i = 0; i < 12; i++) {
+        noise_state = noise_state * 1664525u + 1013904223u;
+        sum += (noise_state >> 8) / 16777216.0;
+    }
+    return sum - 6;
+}
+
+static void trace_create(void) {
+    for (int i = 0; i < TRACE_SAMPLES; i++) {
+        int ramp = i < QUIET_SAMPLES ? 0 : i < QUIET_SAMPLES + RAMP_SAMPLES ? i - QUIET_SAMPLES : RAMP_SAMPLES;
+        truth[i] = (int16_t)(2100 + ramp * RAMP_STEP);
+        long code = lround((truth[i] + NOISE_SIGMA * noise_gaussian()) * 16 / 100);
+        trace[i] = (int16_t)ds18b20_raw_to_centi_degrees((int16_t)code);
+    }
+    trace[100] = 8500;                  // Browned out after Convert-T
+    trace[150] = -12700;                // No device answered
+    trace[GLITCH_SAMPLE] = (int16_t)(truth[GLITCH_SAMPLE] + 300);
+}
+
+typedef struct {
+    double variance;                    // Of the error in the quiet stretches, the glitch left out
+    double max_error;                   // In the quiet stretches
+    double lag;                         // Behind the samples on the ramp, in samples
+    int rejected;
+} filter_result_t;
+
+static filter_result_t filter_run(sample_filter_type_t type, uint8_t median_window) {
+    sample_filter_config_t config = SAMPLE_FILTER_DEFAULT_CONFIG(ESP_TEMP_SENSOR_MIN_VALUE * 100, ESP_TEMP_SENSOR_MAX_VALUE * 100);
+    config.type = type;
+    config.median_window = median_window;
+    sample_filter_t filter;
+    sample_filter_init(&filter);
+
+    filter_result_t result = {0};
+    double quiet_sum = 0, quiet_squares = 0, ramp_sum = 0;
+    int quiet_count = 0, ramp_count = 0;
+    int16_t filtered = 0;
+    for (int i = 0; i < TRACE_SAMPLES; i++) {
+        if (!sample_filter_update(&filter, &config, trace[i], &filtered)) {
+            result.rejected++;
+            continue;
+        }
+        TEST_ASSERT(filtered >= config.min_value && filtered <= config.max_value);
+        double error = filtered - truth[i];
+        int ramp_pos = i - QUIET_SAMPLES;
+        if (ramp_pos >= SETTLE_SAMPLES && ramp_pos < RAMP_SAMPLES) {
+            ramp_sum += trace[i] - filtered;    // Against the same samples, so the noise cancels out
+            ramp_count++;
+        } else if ((i >= SETTLE_SAMPLES && i < QUIET_SAMPLES) || ramp_pos >= RAMP_SAMPLES + SETTLE_SAMPLES) {
+            if (i < GLITCH_SAMPLE || i >= GLITCH_SAMPLE + SETTLE_SAMPLES) {
+                quiet_sum += error;
+                quiet_squares += error * error;
+                quiet_count++;
+            }
+            result.max_error = fmax(result.max_error, fabs(error));
+        }
+    }
+    double mean = quiet_sum / quiet_count;
+    result.variance = quiet_squares / quiet_count - mean * mean;
+    result.lag = ramp_sum / ramp_count / RAMP_STEP;
+    return result;
+}
+
+int main(void) {
+    trace_create();
+    const filter_result_t raw = filter_run(SAMPLE_FILTER_NONE, 1);
+    const struct {
+        sample_filter_type_t type;
+        uint8_t median_window;
+        double max_variance_ratio;      // Of the filtered to the raw noise variance
+        double max_lag;                 // Samples
+        double max_error;               // Centi-degrees
+    } filters[] = {
+        {SAMPLE_FILTER_MEDIAN, 3, 0.6, 1.2, 60},
+        {SAMPLE_FILTER_MEDIAN, 7, 0.35, 3.3, 40},
+        {SAMPLE_FILTER_EMA, 3, 0.25, 3.3, 100},     // alpha 64/256: lag (1 - alpha) / alpha = 3
+        {SAMPLE_FILTER_KALMAN, 3, 0.25, 3.0, 100},
+    };
+
+    // The trace is what it claims to be: the noise plus the quantization, and the glitch
+    TEST_ASSERT_WITHIN(1.0, sqrt(NOISE_SIGMA * NOISE_SIGMA + 6.25 * 6.25 / 12), sqrt(raw.variance));
+    TEST_ASSERT_EQUAL(300, raw.max_error);
+    for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++) {
+        filter_result_t result = filter_run(filters[f].type, filters[f].median_window);
+        TEST_ASSERT(result.variance < raw.variance * filters[f].max_variance_ratio);
+        TEST_ASSERT(result.lag > 0 && result.lag < filters[f].max_lag);
+        TEST_ASSERT(result.max_error < filters[f].max_error);
+        TEST_ASSERT_EQUAL(2, result.rejected);     // The power-on value and the dropout, nothing else
+    }
+    TEST_ASSERT_EQUAL(2, raw.rejected);
+    TEST_PASS();
+}
@@ -0,0 +1,68 @@
+// test_sample_queue.c: the sampler and the Zigbee task as two threads on one sample queue. Every record arrives
+// once, whole and in order, and a full queue drops and counts instead of overwriting
+
+#include <pthread.h>
+#include <sched.h>
+#include "test_util.h"
+#include "sample_queue.h"
+
+#define RECORDS     2000000
+
+static sample_queue_t queue;
+static unsigned failed_pushes;
+
+// Every field derives from the sequence number, so the consumer would notice a torn or stale record
+static sample_record_t record_for(uint32_t seq) {
+    sample_record_t record = {
+        .timestamp_ms = seq,
+        .value = (int16_t)(seq * 7),
+        .sensor = (uint8_t)(seq % 32),
+        .ok = seq & 1,
+        .alarm = (seq >> 1) & 1,
+    };
+    return record;
+}
+
+// The sampler: a full queue is retried here, so nothing is lost but every failed push is counted as a drop
+static void *producer_thread(void *arg) {
+    for (uint32_t seq = 0; seq < RECORDS; seq++) {
+        sample_record_t record = record_for(seq);
+        while (!sample_queue_push(&queue, &record)) {
+            failed_pushes++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(void) {
+    sample_queue_init(&queue);
+    pthread_t producer;
+    TEST_ASSERT_EQUAL(0, pthread_create(&producer, NULL, producer_thread, NULL));
+
+    // The Zigbee task: drains in batches, like temp_sample_drain_cb()
+    uint32_t expected = 0;
+    while (expected < RECORDS) {
+        sample_record_t record;
+        bool any = false;
+        while (sample_queue_pop(&queue, &record)) {
+            sample_record_t want = record_for(expected);
+            TEST_ASSERT_EQUAL(want.timestamp_ms, record.timestamp_ms);
+            TEST_ASSERT_EQUAL(want.value, record.value);
+            TEST_ASSERT_EQUAL(want.sensor, record.sensor);
+            TEST_ASSERT_EQUAL(want.ok, record.ok);
+            TEST_ASSERT_EQUAL(want.alarm, record.alarm);
+            expected++;
+            any = true;
+        }
+        if (!any) {
+            sched_yield();
+        }
+    }
+    pthread_join(producer, NULL);
+
+    sample_record_t record;
+    TEST_ASSERT(!sample_queue_pop(&queue, &record));
+    TEST_ASSERT_EQUAL(failed_pushes, atomic_load(&queue.dropped));
+    TEST_PASS();
+}
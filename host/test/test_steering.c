@@ -0,0 +1,109 @@
+// test_steering.c: network steering against a coordinator that is gone and then comes back on another channel.
+// The node boots with the network of its last run in NVS: the first attempts scan only that channel, later ones the
+// whole primary channel mask, with a backoff from 1 s up to 300 s and equal jitter in between. After the join the
+// new network is what the next boot finds in NVS, and the Diagnostics cluster has the metrics of the run
+
+#include "test_util.h"
+#include "sim_node.h"
+#include "sim_clock.h"
+#include "onewire_sim.h"
+#include "zigbee_fake.h"
+#include "rejoin_policy.h"
+#include "nvs.h"
+#include "main.h"
+
+#define STEERING_MS         2000
+#define STEERING_FAILURES   12      // Enough to reach the bound of the backoff
+#define OLD_CHANNEL         20
+#define OLD_PAN_ID          0x2222
+#define NEW_CHANNEL         15
+#define NEW_PAN_ID          0x1A62
+
+// Record of the network cache in sensor_app.c
+typedef struct {
+    uint8_t channel;
+    uint16_t pan_id;
+} rejoin_network_t;
+
+static rejoin_network_t network_cache_get(void) {
+    rejoin_network_t network = {0};
+    nvs_handle_t handle;
+    size_t size = sizeof(network);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_open("zb_rejoin", NVS_READONLY, &handle));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_blob(handle, "network", &network, &size));
+    nvs_close(handle);
+    TEST_ASSERT_EQUAL(sizeof(network), size);
+    return network;
+}
+
+static uint32_t rejoin_metric(int field) {
+    uint32_t value = 0;
+    TEST_ASSERT(zigbee_fake_get_attr(ZIGBEE_FAKE_CLUSTER_DIAGNOSTICS, HA_ESP_SENSOR_ENDPOINT,
+                                     CUSTOM_DIAG_REJOIN_ATTR_ID(field), &value, sizeof(value)));
+    return value;
+}
+
+// Run until the node starts its next steering attempt
+static void wait_steering(void) {
+    uint32_t count = zigbee_fake_get_steering_count();
+    while (zigbee_fake_get_steering_count() == count) {
+        sim_node_run_for_ms(10);
+    }
+}
+
+int main(void) {
+    // What the last run of the node stored
+    const rejoin_network_t cached = {.channel = OLD_CHANNEL, .pan_id = OLD_PAN_ID};
+    nvs_handle_t handle;
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_open("zb_rejoin", NVS_READWRITE, &handle));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_blob(handle, "network", &cached, sizeof(cached)));
+    nvs_commit(handle);
+    nvs_close(handle);
+
+    int bus = onewire_sim_add_bus(0);
+    onewire_sim_add_device(bus, onewire_sim_rom(0x6000), 21.0);
+    zigbee_fake_set_network(false, NEW_CHANNEL, NEW_PAN_ID, STEERING_MS);
+    TEST_ASSERT_EQUAL(ESP_OK, sim_node_init());
+    int64_t run_start_us = sim_clock_now_us();
+    sim_node_stack_started(ESP_OK, true);
+
+    const rejoin_policy_config_t config = REJOIN_POLICY_DEFAULT_CONFIG(ESP_ZB_PRIMARY_CHANNEL_MASK);
+    uint32_t backoff_ms = config.base_delay_ms;
+    for (int attempt = 1; attempt <= STEERING_FAILURES + 1; attempt++) {
+        if (attempt > 1) {
+            int64_t failed_us = zigbee_fake_get_last_steering_us() + STEERING_MS * 1000;
+            wait_steering();
+            // Equal jitter: in the upper half of a backoff that doubles per failure up to its bound
+            int64_t delay_ms = (zigbee_fake_get_last_steering_us() - failed_us) / 1000;
+            TEST_ASSERT(delay_ms >= backoff_ms / 2);
+            TEST_ASSERT(delay_ms <= backoff_ms + 10);
+            backoff_ms = backoff_ms > config.max_delay_ms / 2 ? config.max_delay_ms : backoff_ms * 2;
+        }
+        TEST_ASSERT_EQUAL(attempt, zigbee_fake_get_steering_count());
+        uint32_t expected_mask = attempt <= config.cached_attempts ? 1u << OLD_CHANNEL : ESP_ZB_PRIMARY_CHANNEL_MASK;
+        TEST_ASSERT_EQUAL(expected_mask, zigbee_fake_get_last_channel_mask());
+
+        // The coordinator is back before the last attempt, on a channel the cached one is not
+        if (attempt == STEERING_FAILURES) {
+            sim_node_run_for_ms(STEERING_MS);
+            zigbee_fake_set_network(true, NEW_CHANNEL, NEW_PAN_ID, STEERING_MS);
+        }
+    }
+    TEST_ASSERT_EQUAL(config.max_delay_ms, backoff_ms);
+    sim_node_run_for_ms(STEERING_MS);
+    int64_t joined_us = zigbee_fake_get_last_steering_us() + STEERING_MS * 1000;
+    TEST_ASSERT_EQUAL(STEERING_FAILURES + 1, zigbee_fake_get_steering_count());
+
+    // The next boot scans the new channel first
+    rejoin_network_t network = network_cache_get();
+    TEST_ASSERT_EQUAL(NEW_CHANNEL, network.channel);
+    TEST_ASSERT_EQUAL(NEW_PAN_ID, network.pan_id);
+
+    // Metrics of the run, from the first attempt to the join
+    sim_node_run_for_ms(ESP_TEMP_DIAGNOSTICS_PERIOD_MS);
+    TEST_ASSERT_EQUAL(STEERING_FAILURES + 1, rejoin_metric(CUSTOM_DIAG_REJOIN_LAST_ATTEMPTS));
+    TEST_ASSERT_EQUAL(STEERING_FAILURES + 1, rejoin_metric(CUSTOM_DIAG_REJOIN_TOTAL_ATTEMPTS));
+    TEST_ASSERT_EQUAL(1, rejoin_metric(CUSTOM_DIAG_REJOIN_JOINS));
+    TEST_ASSERT_WITHIN(1, (joined_us - run_start_us) / 1000, rejoin_metric(CUSTOM_DIAG_REJOIN_LAST_MS));
+    TEST_PASS();
+}
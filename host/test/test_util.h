@@ -0,0 +1,45 @@
+// test_util.h
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Checks of the host tests. A failed check prints where and what and ends the test, ctest sees the exit code.
+ * The tests boot one node per process (see sim_node.h), so a test is one scenario.
+ */
+
+#define TEST_ASSERT(condition) do {                                                         \
+        if (!(condition)) {                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);   \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL(expected, actual) do {                                            \
+        long long expected_ = (long long)(expected);                                        \
+        long long actual_ = (long long)(actual);                                            \
+        if (expected_ != actual_) {                                                         \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n",                           \
+                    __FILE__, __LINE__, #actual, actual_, expected_);                       \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define TEST_ASSERT_WITHIN(tolerance, expected, actual) do {                                \
+        double expected_ = (double)(expected);                                              \
+        double actual_ = (double)(actual);                                                  \
+        if (actual_ < expected_ - (tolerance) || actual_ > expected_ + (tolerance)) {       \
+            fprintf(stderr, "%s:%d: %s is %g, expected %g +- %g\n",                         \
+                    __FILE__, __LINE__, #actual, actual_, expected_, (double)(tolerance));  \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#define TEST_PASS() do {                                                                    \
+        printf("%s: passed\n", __FILE__);                                                   \
+        return 0;                                                                           \
+    } while (0)
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,113 @@
+// test_window_stats.c: window_stats.c against a reference that keeps every sample of a window and computes min,
+// max, mean and population standard deviation directly in floating point. Three days of 5 s samples with jitter
+// on the 5 min, 1 h and 24 h windows of sensor_app.c: a random walk with noise, a stretch at 120 °C with 0.01 °C
+// of noise (a large mean must not cost the deviation its precision), swings across the whole measuring range
+// and a 2 h gap without samples
+
+#include <math.h>
+#include "test_util.h"
+#include "window_stats.h"
+
+#define SAMPLE_PERIOD_MS    5000
+#define TRACE_MS            (3u * 24 * 3600 * 1000)
+#define GAP_START_MS        (30u * 3600 * 1000 + 1234)
+#define GAP_MS              (2u * 3600 * 1000)
+#define HOT_START_MS        (50u * 3600 * 1000)
+#define HOT_MS              (3u * 3600 * 1000)
+#define SWING_START_MS      (60u * 3600 * 1000)
+#define SWING_MS            (4u * 3600 * 1000)
+#define WINDOW_MAX_SAMPLES  (24 * 3600 / 4 + 1)
+
+static const uint32_t lengths_s[] = {300, 3600, 86400};
+#define WINDOW_NUM  (int)(sizeof(lengths_s) / sizeof(lengths_s[0]))
+
+// Samples of the open window of each length
+static int16_t reference_values[WINDOW_NUM][WINDOW_MAX_SAMPLES];
+static uint32_t reference_counts[WINDOW_NUM];
+static uint32_t reference_windows[WINDOW_NUM];     // Index of the open window, time / length
+
+static uint32_t random_state = 7;
+
+static int32_t random_range(int32_t low, int32_t high) {
+    random_state = random_state * 1103515245u + 12345u;
+    return low + (int32_t)((random_state >> 8) % (uint32_t)(high - low + 1));
+}
+
+// The result of a closed window against the direct computation over its samples
+static void reference_check(int window, const window_stats_result_t *result) {
+    uint32_t n = reference_counts[window];
+    const int16_t *values = reference_values[window];
+    int16_t min = values[0];
+    int16_t max = values[0];
+    double sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+        sum += values[i];
+    }
+    double mean = sum / n;
+    double squares = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        squares += (values[i] - mean) * (values[i] - mean);
+    }
+    double stddev = sqrt(squares / n);
+
+    TEST_ASSERT_EQUAL(n, result->count);
+    TEST_ASSERT_EQUAL(min, result->min);
+    TEST_ASSERT_EQUAL(max, result->max);
+    TEST_ASSERT(fabs(result->mean - mean) <= 0.5 + 1e-9);
+    // The variance is rounded before the root, which can add a little to the rounding of the root
+    TEST_ASSERT(fabs(result->stddev - stddev) <= 0.5 + 0.5 / (2 * stddev + 1) + 1e-9);
+}
+
+static int16_t trace_value(uint32_t now_ms, int16_t *walk) {
+    if (now_ms >= HOT_START_MS && now_ms < HOT_START_MS + HOT_MS) {
+        return (int16_t)(12000 + random_range(-1, 1));
+    }
+    if (now_ms >= SWING_START_MS && now_ms < SWING_START_MS + SWING_MS) {
+        return (int16_t)((now_ms / SAMPLE_PERIOD_MS) % 2 ? 12500 : -5500);
+    }
+    *walk = (int16_t)(*walk + random_range(-10, 10));
+    *walk = *walk < -1000 ? -1000 : *walk > 4000 ? 4000 : *walk;
+    return (int16_t)(*walk + random_range(-20, 20));
+}
+
+int main(void) {
+    window_stats_t stats;
+    window_stats_init(&stats, lengths_s, WINDOW_NUM);
+
+    int16_t walk = 2000;
+    uint32_t closed_num[WINDOW_NUM] = {0};
+    bool started = false;
+    for (uint32_t now_ms = 1000; now_ms < TRACE_MS; now_ms += SAMPLE_PERIOD_MS + random_range(-300, 300)) {
+        if (now_ms >= GAP_START_MS && now_ms < GAP_START_MS + GAP_MS) {
+            continue;
+        }
+        int16_t value = trace_value(now_ms, &walk);
+        window_stats_result_t results[WINDOW_STATS_MAX_WINDOWS];
+        uint32_t closed = window_stats_update(&stats, value, now_ms, results);
+
+        for (int w = 0; w < WINDOW_NUM; w++) {
+            uint32_t index = now_ms / (lengths_s[w] * 1000);
+            bool closes = started && index != reference_windows[w];
+            TEST_ASSERT_EQUAL(closes, (closed >> w) & 1);
+            if (closes) {
+                reference_check(w, &results[w]);
+                closed_num[w]++;
+                reference_counts[w] = 0;
+            }
+            reference_windows[w] = index;
+            TEST_ASSERT(reference_counts[w] < WINDOW_MAX_SAMPLES);
+            reference_values[w][reference_counts[w]++] = value;
+        }
+        started = true;
+    }
+
+    // Every window up to the end of the trace closed, but the ones in the gap
+    for (int w = 0; w < WINDOW_NUM; w++) {
+        uint32_t windows = TRACE_MS / (lengths_s[w] * 1000);
+        uint32_t in_gap = GAP_MS / (lengths_s[w] * 1000);
+        TEST_ASSERT(closed_num[w] + in_gap + 2 >= windows && closed_num[w] < windows);
+    }
+    TEST_PASS();
+}
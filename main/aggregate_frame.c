@@ -0,0 +1,20 @@
+// aggregate_frame.c
+
+#include "aggregate_frame.h"
+
+size_t aggregate_frame_encode(const int16_t *values, int count, uint8_t *frame, size_t frame_size) {
+    if (count < 0 || count > UINT8_MAX || frame_size < AGGREGATE_FRAME_SIZE((size_t)count)) {
+        return 0;
+    }
+
+    frame[0] = AGGREGATE_FRAME_VERSION;
+    frame[1] = (uint8_t)count;
+    uint8_t *p = &frame[AGGREGATE_FRAME_HEADER];
+    for (int i = 0; i < count; i++) {
+        uint16_t value = (uint16_t)values[i];
+        p[0] = value & 0xFF;
+        p[1] = value >> 8;
+        p += 2;
+    }
+    return p - frame;
+}
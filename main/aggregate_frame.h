@@ -0,0 +1,28 @@
+// aggregate_frame.h
+
+#ifndef AGGREGATE_FRAME_H
+#define AGGREGATE_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* One frame carrying the current value of every sensor, reported through a single manufacturer specific
+ * attribute instead of one MeasuredValue report per endpoint.
+ *
+ * Layout, little endian: u8 version, u8 count, then count * s16 centi-degrees in sensor index order.
+ * A sensor without a valid reading is sent as AGGREGATE_FRAME_INVALID (the ZCL invalid MeasuredValue).
+ */
+#define AGGREGATE_FRAME_VERSION     1
+#define AGGREGATE_FRAME_HEADER      2
+#define AGGREGATE_FRAME_INVALID     ((int16_t)0x8000)
+#define AGGREGATE_FRAME_SIZE(count) (AGGREGATE_FRAME_HEADER + (count) * 2)
+
+/* An unfragmented, NWK secured frame leaves 73 bytes for the octet string of a manufacturer specific
+ * attribute report: 127 - MAC (11) - NWK (8 + 18 security) - APS (8) - ZCL (5) - attribute id, type, length (4)
+ */
+#define AGGREGATE_FRAME_MAX_SIZE    73
+
+// Encode count values into frame, returns the frame length or 0 if frame_size is too small
+size_t aggregate_frame_encode(const int16_t *values, int count, uint8_t *frame, size_t frame_size);
+
+#endif // AGGREGATE_FRAME_H
@@ -1,94 +1,1045 @@
 // ds18b20_sensor.c
 
+#include <stdlib.h>
+#include <string.h>
 #include "ds18b20_sensor.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include "nvs.h"
 #include "onewire_bus.h"
+#include "onewire_cmd.h"
+#include "onewire_crc.h"
+#include "onewire_hal.h"
+#include "latency_stats.h"
+#include "trace_log.h"
+#include "ram_budget.h"
 #include "ds18b20.h"
 
-// Define the GPIO pin for the 1-Wire bus
-#define ONEWIRE_BUS_GPIO    0  // Ensure this is the correct GPIO pin for your 1-Wire bus
-#define MAX_DS18B20_SENSORS 2  // Adjust this if you have more sensors
+static const int onewire_bus_gpios[] = {DS18B20_ONEWIRE_BUS_GPIOS};  // See ds18b20_sensor.h
+#define ONEWIRE_BUS_NUM     (int)(sizeof(onewire_bus_gpios) / sizeof(onewire_bus_gpios[0]))
+_Static_assert(sizeof(onewire_bus_gpios) / sizeof(onewire_bus_gpios[0]) <= DS18B20_MAX_BUSES, "Too many 1-Wire buses for the RMT channels");
+
+#define DS18B20_FAMILY_CODE         0x28
+#define DS18B20_CMD_CONVERT_TEMP    0x44
+#define DS18B20_CMD_READ_SCRATCHPAD 0xBE
+#define DS18B20_CMD_WRITE_SCRATCHPAD 0x4E
+#define DS18B20_CMD_COPY_SCRATCHPAD 0x48
+#define DS18B20_SCRATCHPAD_SIZE     9
+#define DS18B20_CONVERSION_TIME_MS  750    // Worst case conversion time at 12-bit resolution
+#define DS18B20_POWER_ON_RAW        0x0550 // 85 °C, the scratchpad value after power-on until the first conversion
+#define DS18B20_RAW_MIN             (-55 * 16)  // Measuring range of the DS18B20, -55 to 125 °C
+#define DS18B20_RAW_MAX             (125 * 16)
+#define DS18B20_EEPROM_WRITE_MS     10     // Copy Scratchpad to EEPROM, the sensor must stay powered meanwhile
+
+// ROM codes of the last boot, kept so the sensor indices (and their endpoints) survive a reboot
+#define DS18B20_NVS_NAMESPACE       "ds18b20"
+#define DS18B20_NVS_KEY_ROMS        "bus_roms"
+#define DS18B20_NVS_KEY_ALARM_MIGRATED "alarm_mig"  // Set once the factory thresholds of the cached probes were disabled
+
+// TH/TL bytes of a DS18B20 from the factory, never written by this firmware
+#define DS18B20_FACTORY_ALARM_HIGH  75
+#define DS18B20_FACTORY_ALARM_LOW   70
 
 static const char *TAG = "DS18B20_SENSOR";
-static ds18b20_device_handle_t ds18b20s[MAX_DS18B20_SENSORS];
+
+// ROM code of a sensor and the bus it was found on, this is also the NVS cache record
+typedef struct {
+    onewire_device_address_t address;
+    uint32_t bus;
+} ds18b20_rom_t;
+
+// One registry entry per discovered sensor, the registry is sized at runtime by ds18b20_init() or taken from a
+// pool for DS18B20_MAX_SENSORS in the static allocation build
+typedef struct {
+    ds18b20_rom_t rom;
+    ds18b20_sensor_location_t location;
+    ds18b20_resolution_t resolution;
+    int8_t alarm_low;           // TL, mirrors the scratchpad and the EEPROM
+    int8_t alarm_high;          // TH
+    ds18b20_sensor_stats_t stats;
+    uint8_t failed_cycles;      // Failed cycles in a row
+    bool quarantined;
+} ds18b20_sensor_t;
+
+static ds18b20_sensor_t *ds18b20s = NULL;
+#if RAM_BUDGET_STATIC_ALLOCATION
+static ds18b20_sensor_t ds18b20_pool[DS18B20_MAX_SENSORS];
+#endif
 static int ds18b20_device_num = 0;
-static onewire_bus_handle_t bus = NULL;
+static onewire_bus_handle_t buses[DS18B20_MAX_BUSES] = {NULL};
+static int bus_device_nums[DS18B20_MAX_BUSES] = {0};
+static int64_t conversion_started_us = 0;  // End of the last broadcast, 0 once the first result was read
+static int64_t eeprom_ready_us[DS18B20_MAX_BUSES] = {0};  // End of the last Copy Scratchpad on each bus
 
-esp_err_t ds18b20_init(void) {
-    // Configure the 1-Wire bus
-    onewire_bus_config_t bus_config = {
-        .bus_gpio_num = ONEWIRE_BUS_GPIO,
-    };
-    onewire_bus_rmt_config_t rmt_config = {
-        .max_rx_bytes = 10, // 1 byte ROM command + 8 bytes ROM number + 1 byte device command
-    };
+// Handle of a bus. The bus lives from ds18b20_init() on and is only created again after ds18b20_release_buses(),
+// NULL if that failed. The sensors are addressed by their ROM codes, no per-device handle depends on the bus
+static onewire_bus_handle_t ds18b20_bus(int bus_index) {
+    if (buses[bus_index] != NULL) {
+        return buses[bus_index];
+    }
+    esp_err_t ret = onewire_hal_new_bus(onewire_bus_gpios[bus_index], &buses[bus_index]);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to restore 1-Wire bus %d, error: %s", bus_index, esp_err_to_name(ret));
+        buses[bus_index] = NULL;
+    }
+    return buses[bus_index];
+}
 
-    // Initialize the 1-Wire bus
-    esp_err_t ret = onewire_new_bus_rmt(&bus_config, &rmt_config, &bus);
+static esp_err_t ds18b20_read_scratchpad(const ds18b20_rom_t *rom, uint8_t *scratchpad);
+
+// Match-ROM + Write Scratchpad of TH, TL and the configuration register. The component only writes the
+// resolution, this keeps the alarm thresholds of the registry
+static esp_err_t ds18b20_write_scratchpad(const ds18b20_sensor_t *sensor) {
+    onewire_bus_handle_t bus = ds18b20_bus(sensor->rom.bus);
+    if (bus == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = onewire_bus_reset(bus);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize 1-Wire bus on GPIO %d, error: %s", ONEWIRE_BUS_GPIO, esp_err_to_name(ret));
         return ret;
     }
-    ESP_LOGI(TAG, "1-Wire bus initialized on GPIO %d", ONEWIRE_BUS_GPIO);
 
-    // Create an iterator to search for devices on the 1-Wire bus
-    onewire_device_iter_handle_t iter = NULL;
-    ret = onewire_new_device_iter(bus, &iter);
+    uint8_t tx_buffer[13] = {ONEWIRE_CMD_MATCH_ROM};
+    memcpy(&tx_buffer[1], &sensor->rom.address, sizeof(sensor->rom.address));
+    tx_buffer[9] = DS18B20_CMD_WRITE_SCRATCHPAD;
+    tx_buffer[10] = (uint8_t)sensor->alarm_high;
+    tx_buffer[11] = (uint8_t)sensor->alarm_low;
+    tx_buffer[12] = ((uint8_t)sensor->resolution << 5) | 0x1F;  // R1 R0 in bits 6-5, the low bits read as ones
+    return onewire_bus_write_bytes(bus, tx_buffer, sizeof(tx_buffer));
+}
+
+// Match-ROM + Copy Scratchpad, TH, TL and the configuration register are reloaded from the EEPROM at power-up.
+// Returns at once, the bus must be left alone until ds18b20_get_bus_wait_ms() is 0
+static esp_err_t ds18b20_copy_scratchpad(const ds18b20_rom_t *rom) {
+    onewire_bus_handle_t bus = ds18b20_bus(rom->bus);
+    if (bus == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = onewire_bus_reset(bus);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create 1-Wire device iterator, error: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    ESP_LOGI(TAG, "Searching for devices on the 1-Wire bus...");
-    ds18b20_device_num = 0;  // Reset the device count
-    onewire_device_t next_onewire_device;
-
-    // Search for devices
-    while (onewire_device_iter_get_next(iter, &next_onewire_device) == ESP_OK) {
-        ESP_LOGI(TAG, "Found device with address: %016llX", next_onewire_device.address);
-        
-        ds18b20_config_t ds_cfg = {};
-        if (ds18b20_new_device(&next_onewire_device, &ds_cfg, &ds18b20s[ds18b20_device_num]) == ESP_OK) {
-            ESP_LOGI(TAG, "DS18B20 sensor initialized at index %d", ds18b20_device_num);
-            ds18b20_device_num++;
-        } else {
-            ESP_LOGW(TAG, "Device found at address %016llX is not a DS18B20", next_onewire_device.address);
+    uint8_t tx_buffer[10] = {ONEWIRE_CMD_MATCH_ROM};
+    memcpy(&tx_buffer[1], &rom->address, sizeof(rom->address));
+    tx_buffer[9] = DS18B20_CMD_COPY_SCRATCHPAD;
+    ret = onewire_bus_write_bytes(bus, tx_buffer, sizeof(tx_buffer));
+    if (ret == ESP_OK) {
+        eeprom_ready_us[rom->bus] = esp_timer_get_time() + DS18B20_EEPROM_WRITE_MS * 1000;
+    }
+    return ret;
+}
+
+uint32_t ds18b20_get_bus_wait_ms(void) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t wait_us = 0;
+    for (int b = 0; b < ONEWIRE_BUS_NUM; b++) {
+        if (eeprom_ready_us[b] - now_us > wait_us) {
+            wait_us = eeprom_ready_us[b] - now_us;
+        }
+    }
+    return (uint32_t)((wait_us + 999) / 1000);
+}
+
+// Blocking wait for the EEPROM writes, only ds18b20_init() may use it, it runs before the sampler
+static void ds18b20_eeprom_wait(void) {
+    uint32_t wait_ms = ds18b20_get_bus_wait_ms();
+    if (wait_ms > 0) {
+        onewire_hal_delay_ms(wait_ms);
+    }
+}
+
+// Add one DS18B20 at the next free index of the registry
+static esp_err_t ds18b20_add_device(const ds18b20_rom_t *rom) {
+    onewire_device_address_t address = rom->address;
+    ds18b20_sensor_t *sensor = &ds18b20s[ds18b20_device_num];
+    if ((address & 0xFF) != DS18B20_FAMILY_CODE) {
+        ESP_LOGW(TAG, "Device at address %016llX is not a DS18B20", address);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    sensor->rom = *rom;
+    sensor->location.bus = rom->bus;
+    sensor->location.device = bus_device_nums[rom->bus]++;
+    sensor->resolution = DS18B20_RESOLUTION_12B;
+
+    // The thresholds were loaded from the EEPROM at power-up
+    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+    if (ds18b20_read_scratchpad(rom, scratchpad) == ESP_OK) {
+        sensor->alarm_high = (int8_t)scratchpad[2];
+        sensor->alarm_low = (int8_t)scratchpad[3];
+    } else {
+        sensor->alarm_high = DS18B20_ALARM_HIGH_DISABLED;
+        sensor->alarm_low = DS18B20_ALARM_LOW_DISABLED;
+    }
+
+    // A soft reset of the chip does not power cycle the sensors, undo any resolution left from the last run
+    if (ds18b20_write_scratchpad(sensor) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to reset resolution of DS18B20 at address %016llX", address);
+    }
+    ESP_LOGI(TAG, "DS18B20 sensor %016llX on bus %d initialized at index %d", address, (int)rom->bus, ds18b20_device_num);
+    ds18b20_device_num++;
+    return ESP_OK;
+}
+
+// Load the ROM codes found on the last boot, the position in the cache is the sensor index
+static int ds18b20_rom_cache_load(ds18b20_rom_t *roms, int max_num) {
+    nvs_handle_t handle;
+    if (nvs_open(DS18B20_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return 0;
+    }
+
+    size_t size = max_num * sizeof(*roms);
+    esp_err_t ret = nvs_get_blob(handle, DS18B20_NVS_KEY_ROMS, roms, &size);
+    nvs_close(handle);
+    if (ret != ESP_OK) {
+        if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Failed to load cached ROM codes, error: %s", esp_err_to_name(ret));
+        }
+        return 0;
+    }
+    // Drop records of buses that are no longer configured
+    int num = 0;
+    for (int i = 0; i < (int)(size / sizeof(*roms)); i++) {
+        if (roms[i].bus < ONEWIRE_BUS_NUM) {
+            roms[num++] = roms[i];
         }
+    }
+    return num;
+}
+
+static void ds18b20_rom_cache_store(const ds18b20_rom_t *roms, int num) {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(DS18B20_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, DS18B20_NVS_KEY_ROMS, roms, num * sizeof(roms[0]));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
 
-        if (ds18b20_device_num >= MAX_DS18B20_SENSORS) {
-            ESP_LOGI(TAG, "Max number of DS18B20 sensors (%d) reached", MAX_DS18B20_SENSORS);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store ROM codes, error: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Stored %d ROM code(s) in NVS", num);
+    }
+}
+
+// Match-ROM + Read Scratchpad of one device, the scratchpad is only returned with a valid CRC
+static esp_err_t ds18b20_read_scratchpad(const ds18b20_rom_t *rom, uint8_t *scratchpad) {
+    onewire_bus_handle_t bus = ds18b20_bus(rom->bus);
+    if (bus == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = onewire_bus_reset(bus);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uint8_t tx_buffer[10] = {ONEWIRE_CMD_MATCH_ROM};
+    memcpy(&tx_buffer[1], &rom->address, sizeof(rom->address));
+    tx_buffer[9] = DS18B20_CMD_READ_SCRATCHPAD;
+    ret = onewire_bus_write_bytes(bus, tx_buffer, sizeof(tx_buffer));
+    if (ret == ESP_OK) {
+        ret = onewire_bus_read_bytes(bus, scratchpad, DS18B20_SCRATCHPAD_SIZE);
+    }
+    if (ret == ESP_OK && onewire_crc8(0, scratchpad, 8) != scratchpad[8]) {
+        ret = ESP_ERR_INVALID_CRC;
+    }
+    return ret;
+}
+
+// Quick presence check of a known device: Match-ROM + Read Scratchpad, only that device can answer
+static bool ds18b20_device_present(const ds18b20_rom_t *rom) {
+    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+    if (ds18b20_read_scratchpad(rom, scratchpad) != ESP_OK) {
+        return false;
+    }
+
+    // Nobody answering reads back as all ones, the config register always has its five low bits set
+    return (scratchpad[4] & 0x9F) == 0x1F;
+}
+
+// Position of a ROM search between its passes, every pass walks the tree once and finds one device
+typedef struct {
+    onewire_device_address_t address;   // ROM code found by the last pass
+    int last_discrepancy;               // Bit (1-64) where the last pass took the 0 branch of a conflict
+    bool done;                          // The last pass found the last device
+} ds18b20_search_t;
+
+/* One pass of a ROM search with the given ROM command, the found ROM code is left in search->address. The device
+ * iterator of the component only sends Search ROM, the Alarm Search walks the same tree but only devices with their
+ * alarm flag set take part. Returns ESP_ERR_NOT_FOUND once no device is left, a single pass takes about 200 slots
+ */
+static esp_err_t ds18b20_search_next(int bus_index, uint8_t command, ds18b20_search_t *search) {
+    if (search->done) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    onewire_bus_handle_t bus = ds18b20_bus(bus_index);
+    if (bus == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = onewire_bus_reset(bus);
+    if (ret != ESP_OK) {
+        // Without a presence pulse the bus is broken or empty, neither ends a search
+        return ret == ESP_ERR_NOT_FOUND ? ESP_ERR_INVALID_RESPONSE : ret;
+    }
+    ret = onewire_bus_write_bytes(bus, &command, 1);
+
+    onewire_device_address_t address = search->address;
+    int last_zero = 0;
+    for (int bit = 1; bit <= 64 && ret == ESP_OK; bit++) {
+        uint8_t id_bit = 0;
+        uint8_t cmp_bit = 0;
+        ret = onewire_bus_read_bit(bus, &id_bit);
+        if (ret == ESP_OK) {
+            ret = onewire_bus_read_bit(bus, &cmp_bit);
+        }
+        if (ret != ESP_OK) {
             break;
         }
+        if (id_bit && cmp_bit) {
+            if (bit > 1) {
+                // The devices that answered the first bit cannot all drop out later, a glitch hid them
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            search->done = true;
+            return ESP_ERR_NOT_FOUND;  // Nobody takes part, for the Alarm Search: no sensor is in alarm
+        }
+
+        uint8_t direction;
+        if (id_bit != cmp_bit) {
+            direction = id_bit;  // All remaining devices agree on this bit
+        } else {
+            // Conflict: repeat the last path up to the last discrepancy, then take the 1 branch there
+            if (bit < search->last_discrepancy) {
+                direction = (address >> (bit - 1)) & 1;
+            } else {
+                direction = bit == search->last_discrepancy;
+            }
+            if (!direction) {
+                last_zero = bit;
+            }
+        }
+        if (direction) {
+            address |= 1ULL << (bit - 1);
+        } else {
+            address &= ~(1ULL << (bit - 1));
+        }
+        ret = onewire_bus_write_bit(bus, direction);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // The ROM code is sent LSB first, its last byte is the CRC of the first seven
+    if (onewire_crc8(0, (uint8_t *)&address, 7) != (uint8_t)(address >> 56)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    search->address = address;
+    search->last_discrepancy = last_zero;
+    search->done = last_zero == 0;
+    return ESP_OK;
+}
+
+// Full ROM search of one bus, collects the addresses of all DS18B20 on it
+static int ds18b20_search_devices(int bus_index, ds18b20_rom_t *roms, int max_num) {
+    ESP_LOGD(TAG, "Searching for devices on 1-Wire bus %d...", bus_index);
+    ds18b20_search_t search = {0};
+    int found_num = 0;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    while (found_num < max_num && (ret = ds18b20_search_next(bus_index, ONEWIRE_CMD_SEARCH_NORMAL, &search)) == ESP_OK) {
+        ESP_LOGD(TAG, "Found device with address: %016llX", search.address);
+
+        if ((search.address & 0xFF) != DS18B20_FAMILY_CODE) {
+            ESP_LOGW(TAG, "Device found at address %016llX is not a DS18B20", search.address);
+            continue;
+        }
+        roms[found_num].address = search.address;
+        roms[found_num].bus = bus_index;
+        found_num++;
+
+        if (found_num >= max_num) {
+            ESP_LOGI(TAG, "Max number of DS18B20 sensors (%d) reached", max_num);
+        }
+    }
+    if (found_num < max_num && ret != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Search on 1-Wire bus %d stopped, error: %s", bus_index, esp_err_to_name(ret));
     }
+    return found_num;
+}
 
-    // Delete the iterator
-    ESP_ERROR_CHECK(onewire_del_device_iter(iter));
-    ESP_LOGI(TAG, "Device search completed, %d DS18B20 sensor(s) found", ds18b20_device_num);
+static bool ds18b20_rom_equal(const ds18b20_rom_t *a, const ds18b20_rom_t *b) {
+    return a->address == b->address && a->bus == b->bus;
+}
+
+static bool ds18b20_rom_in(const ds18b20_rom_t *rom, const ds18b20_rom_t *roms, int num) {
+    for (int i = 0; i < num; i++) {
+        if (ds18b20_rom_equal(&roms[i], rom)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Order the found sensors so every cached sensor keeps its index, a new sensor takes over the index of a missing one
+static int ds18b20_order_by_cache(const ds18b20_rom_t *cached, int cached_num,
+                                  const ds18b20_rom_t *found, int found_num,
+                                  ds18b20_rom_t *ordered) {
+    bool used[DS18B20_MAX_SENSORS] = {false};
+    int num = 0;
+
+    for (int slot = 0; slot < cached_num; slot++) {
+        int match = -1;
+        for (int i = 0; i < found_num && match < 0; i++) {
+            if (!used[i] && ds18b20_rom_equal(&found[i], &cached[slot])) {
+                match = i;
+            }
+        }
+        for (int i = 0; i < found_num && match < 0; i++) {
+            if (!used[i] && !ds18b20_rom_in(&found[i], cached, cached_num)) {
+                match = i;
+            }
+        }
+        if (match >= 0) {
+            used[match] = true;
+            ordered[num++] = found[match];
+        }
+    }
+    for (int i = 0; i < found_num; i++) {
+        if (!used[i]) {
+            ordered[num++] = found[i];
+        }
+    }
+    return num;
+}
+
+/* Firmware without alarm thresholds cached its probes with the factory TH/TL bytes in their EEPROM, which would
+ * put them in alarm and read them every cycle. On the first boot of a firmware with thresholds they are disabled
+ * once, later 75/70 °C thresholds were written on purpose and are kept
+ */
+static void ds18b20_alarm_migrate(void) {
+    nvs_handle_t handle;
+    uint8_t migrated = 0;
+    if (nvs_open(DS18B20_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_u8(handle, DS18B20_NVS_KEY_ALARM_MIGRATED, &migrated) == ESP_OK && migrated) {
+        nvs_close(handle);
+        return;
+    }
+
+    bool done = true;
+    for (int i = 0; i < ds18b20_device_num; i++) {
+        if (ds18b20s[i].alarm_high != DS18B20_FACTORY_ALARM_HIGH || ds18b20s[i].alarm_low != DS18B20_FACTORY_ALARM_LOW) {
+            continue;
+        }
+        ds18b20_eeprom_wait();
+        if (ds18b20_set_sensor_alarm(i, DS18B20_ALARM_LOW_DISABLED, DS18B20_ALARM_HIGH_DISABLED) == ESP_OK) {
+            ESP_LOGI(TAG, "Disabled the factory alarm thresholds of DS18B20[%d]", i);
+        } else {
+            done = false;  // Tried again on the next boot
+        }
+    }
+    if (done && nvs_set_u8(handle, DS18B20_NVS_KEY_ALARM_MIGRATED, 1) == ESP_OK) {
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+}
+
+esp_err_t ds18b20_init(void) {
+    for (int b = 0; b < ONEWIRE_BUS_NUM; b++) {
+        // Initialize the 1-Wire bus
+        esp_err_t ret = onewire_hal_new_bus(onewire_bus_gpios[b], &buses[b]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize 1-Wire bus on GPIO %d, error: %s", onewire_bus_gpios[b], esp_err_to_name(ret));
+            return ret;
+        }
+        ESP_LOGI(TAG, "1-Wire bus %d initialized on GPIO %d", b, onewire_bus_gpios[b]);
+    }
+
+    int64_t discovery_start_us = esp_timer_get_time();
+    ds18b20_rom_t cached[DS18B20_MAX_SENSORS];
+    ds18b20_rom_t found[DS18B20_MAX_SENSORS];
+    ds18b20_rom_t ordered[DS18B20_MAX_SENSORS];
+    memset(found, 0, sizeof(found));  // Padding of the records is written to NVS
+    int cached_num = ds18b20_rom_cache_load(cached, DS18B20_MAX_SENSORS);
+
+    // Fast boot: every cached sensor answers its Match-ROM, no search needed
+    bool cache_hit = cached_num > 0;
+    for (int i = 0; i < cached_num && cache_hit; i++) {
+        if (!ds18b20_device_present(&cached[i])) {
+            ESP_LOGW(TAG, "Cached DS18B20 %016llX on bus %d did not answer, falling back to a full search",
+                     cached[i].address, (int)cached[i].bus);
+            cache_hit = false;
+        }
+    }
+
+    int ordered_num;
+    if (cache_hit) {
+        memcpy(ordered, cached, cached_num * sizeof(cached[0]));
+        ordered_num = cached_num;
+    } else {
+        int found_num = 0;
+        for (int b = 0; b < ONEWIRE_BUS_NUM; b++) {
+            found_num += ds18b20_search_devices(b, &found[found_num], DS18B20_MAX_SENSORS - found_num);
+        }
+        ordered_num = ds18b20_order_by_cache(cached, cached_num, found, found_num, ordered);
+    }
+
+    // Size the registry for the sensors actually found
+#if RAM_BUDGET_STATIC_ALLOCATION
+    memset(ds18b20_pool, 0, sizeof(ds18b20_pool));
+    ds18b20s = ds18b20_pool;
+    ram_budget_add(RAM_SUBSYSTEM_SENSOR_REGISTRY, sizeof(ds18b20_pool), true);
+#else
+    free(ds18b20s);
+    ds18b20s = calloc(ordered_num > 0 ? ordered_num : 1, sizeof(ds18b20_sensor_t));
+    if (ds18b20s == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate registry for %d sensor(s)", ordered_num);
+        return ESP_ERR_NO_MEM;
+    }
+    ram_budget_add(RAM_SUBSYSTEM_SENSOR_REGISTRY, (ordered_num > 0 ? ordered_num : 1) * sizeof(ds18b20_sensor_t), false);
+#endif
+
+    ds18b20_device_num = 0;  // Reset the device count
+    memset(bus_device_nums, 0, sizeof(bus_device_nums));
+    for (int i = 0; i < ordered_num; i++) {
+        ds18b20_eeprom_wait();
+        if (ds18b20_add_device(&ordered[i]) != ESP_OK) {
+            continue;
+        }
+        ordered[ds18b20_device_num - 1] = ordered[i];
+
+        // A probe seen for the first time holds the factory TH/TL bytes, which are not thresholds of ours
+        if (!ds18b20_rom_in(&ordered[i], cached, cached_num)) {
+            ds18b20_set_sensor_alarm(ds18b20_device_num - 1, DS18B20_ALARM_LOW_DISABLED, DS18B20_ALARM_HIGH_DISABLED);
+        }
+    }
+    ds18b20_alarm_migrate();
+    ds18b20_eeprom_wait();
+    ESP_LOGI(TAG, "Sensor registry uses %u bytes (%u per sensor)",
+             (unsigned)(ordered_num * sizeof(ds18b20_sensor_t)), (unsigned)sizeof(ds18b20_sensor_t));
+
+    ESP_LOGI(TAG, "Device discovery completed in %lld ms (%s), %d DS18B20 sensor(s) found",
+             (esp_timer_get_time() - discovery_start_us) / 1000, cache_hit ? "cached ROM codes" : "full search", ds18b20_device_num);
 
     if (ds18b20_device_num == 0) {
-        ESP_LOGW(TAG, "No DS18B20 sensors found on the bus");
+        ESP_LOGW(TAG, "No DS18B20 sensors found on the bus(es)");
         return ESP_FAIL;
     }
 
+    bool cache_changed = ds18b20_device_num != cached_num;
+    for (int i = 0; i < ds18b20_device_num && !cache_changed; i++) {
+        cache_changed = !ds18b20_rom_equal(&ordered[i], &cached[i]);
+    }
+    if (cache_changed) {
+        ds18b20_rom_cache_store(ordered, ds18b20_device_num);
+    }
+
     return ESP_OK;
 }
 
+int ds18b20_get_sensor_count(void) {
+    return ds18b20_device_num;
+}
+
+int ds18b20_get_bus_count(void) {
+    return ONEWIRE_BUS_NUM;
+}
 
-// Read temperature from DS18B20 sensors
-esp_err_t ds18b20_read_temperature(int index, float *temperature) {
+int ds18b20_get_bus_sensor_count(int bus) {
+    if (bus >= ONEWIRE_BUS_NUM || bus < 0) {
+        return 0;
+    }
+    return bus_device_nums[bus];
+}
+
+int ds18b20_get_sensor_index(int bus, int device) {
+    for (int i = 0; i < ds18b20_device_num; i++) {
+        if (ds18b20s[i].location.bus == bus && ds18b20s[i].location.device == device) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t ds18b20_get_sensor_location(int index, ds18b20_sensor_location_t *location) {
+    if (index >= ds18b20_device_num || index < 0 || location == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *location = ds18b20s[index].location;
+    return ESP_OK;
+}
+
+uint32_t ds18b20_resolution_conversion_time_ms(ds18b20_resolution_t resolution) {
+    // Every bit less halves the conversion time: 93.75, 187.5, 375 and 750 ms
+    switch (resolution) {
+    case DS18B20_RESOLUTION_9B:
+        return DS18B20_CONVERSION_TIME_MS / 8 + 1;
+    case DS18B20_RESOLUTION_10B:
+        return DS18B20_CONVERSION_TIME_MS / 4 + 1;
+    case DS18B20_RESOLUTION_11B:
+        return DS18B20_CONVERSION_TIME_MS / 2;
+    case DS18B20_RESOLUTION_12B:
+    default:
+        return DS18B20_CONVERSION_TIME_MS;
+    }
+}
+
+// A broadcast conversion is done once the sensor with the highest resolution is done
+uint32_t ds18b20_get_conversion_time_ms(void) {
+    uint32_t conversion_time_ms = 0;
+    for (int i = 0; i < ds18b20_device_num; i++) {
+        if (ds18b20s[i].quarantined) {
+            continue;
+        }
+        uint32_t time_ms = ds18b20_resolution_conversion_time_ms(ds18b20s[i].resolution);
+        if (time_ms > conversion_time_ms) {
+            conversion_time_ms = time_ms;
+        }
+    }
+    return conversion_time_ms > 0 ? conversion_time_ms : DS18B20_CONVERSION_TIME_MS;
+}
+
+esp_err_t ds18b20_set_sensor_resolution(int index, ds18b20_resolution_t resolution) {
+    if (index >= ds18b20_device_num || index < 0 || resolution > DS18B20_RESOLUTION_12B) {
+        ESP_LOGE(TAG, "Invalid sensor index %d or resolution %d", index, resolution);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ds18b20s[index].resolution == resolution) {
+        return ESP_OK;
+    }
+
+    // Only the scratchpad is written, the EEPROM keeps the resolution of the last threshold change
+    ds18b20_resolution_t previous = ds18b20s[index].resolution;
+    ds18b20s[index].resolution = resolution;
+    esp_err_t ret = ds18b20_write_scratchpad(&ds18b20s[index]);
+    if (ret != ESP_OK) {
+        ds18b20s[index].resolution = previous;
+        ESP_LOGE(TAG, "Failed to set resolution of DS18B20[%d], error: %s", index, esp_err_to_name(ret));
+        return ret;
+    }
+
+    trace_log_write(TRACE_EVENT_RESOLUTION, (uint8_t)index, 9 + (int)resolution);
+    return ESP_OK;
+}
+
+ds18b20_resolution_t ds18b20_get_sensor_resolution(int index) {
+    if (index >= ds18b20_device_num || index < 0) {
+        return DS18B20_RESOLUTION_12B;
+    }
+    return ds18b20s[index].resolution;
+}
+
+// Broadcast Convert-T to every device on one bus
+static esp_err_t ds18b20_trigger_conversion_bus(int bus_index) {
+    onewire_bus_handle_t bus = ds18b20_bus(bus_index);
+    if (bus == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = onewire_bus_reset(bus);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "1-Wire bus %d reset failed, error: %s", bus_index, esp_err_to_name(ret));
+        return ret;
+    }
+
+    const uint8_t tx_buffer[] = {ONEWIRE_CMD_SKIP_ROM, DS18B20_CMD_CONVERT_TEMP};
+    ret = onewire_bus_write_bytes(bus, tx_buffer, sizeof(tx_buffer));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to broadcast Convert-T on bus %d, error: %s", bus_index, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// Broadcast Convert-T on every bus, all sensors of all buses convert in parallel
+esp_err_t ds18b20_trigger_conversion_all(void) {
+    if (ds18b20_device_num == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A failing bus only costs the readings of its own sensors
+    int64_t start_us = latency_stats_now();
+    esp_err_t ret = ESP_FAIL;
+    for (int b = 0; b < ONEWIRE_BUS_NUM; b++) {
+        if (bus_device_nums[b] > 0 && ds18b20_trigger_conversion_bus(b) == ESP_OK) {
+            ret = ESP_OK;
+        }
+    }
+    latency_stats_since(LATENCY_PHASE_TRIGGER, start_us);
+    conversion_started_us = ret == ESP_OK ? latency_stats_now() : 0;
+    return ret;
+}
+
+int32_t ds18b20_raw_to_centi_degrees(int16_t raw) {
+    // 1/16 °C to 1/100 °C is * 25 / 4, division truncates towards zero so the bias is applied symmetrically.
+    // At most 32768 * 25 + 2 in magnitude, no int32_t overflow for any raw code
+    int32_t scaled = (int32_t)raw * 25;
+    return (scaled + (scaled < 0 ? -2 : 2)) / 4;
+}
+
+esp_err_t ds18b20_read_conversion_result(int index, int16_t *temperature) {
+    if (index >= ds18b20_device_num || index < 0) {
+        ESP_LOGE(TAG, "Invalid sensor index: %d", index);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ds18b20_sensor_t *sensor = &ds18b20s[index];
+    if (sensor->quarantined) {
+        return ESP_ERR_INVALID_STATE;  // Left off the bus until ds18b20_rescan_step() finds it again
+    }
+    int64_t start_us = latency_stats_now();
+    if (conversion_started_us != 0) {
+        latency_stats_record(LATENCY_PHASE_CONVERSION, (uint32_t)(start_us - conversion_started_us));
+        conversion_started_us = 0;
+    }
+
+    // Addresses the sensor by its ROM code, so only its scratchpad is read. The conversion result stays
+    // in the scratchpad, so a glitched transfer is simply read again
+    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+    esp_err_t ret = ESP_FAIL;
+    for (int attempt = 0; attempt < DS18B20_READ_ATTEMPTS; attempt++) {
+        if (attempt > 0) {
+            sensor->stats.retries++;
+        }
+        ret = ds18b20_read_scratchpad(&sensor->rom, scratchpad);
+        if (ret == ESP_OK && (scratchpad[4] & 0x9F) != 0x1F) {
+            ret = ESP_ERR_NOT_FOUND;  // All zeros passes the CRC, but no DS18B20 has such a config register
+        }
+        if (ret == ESP_OK) {
+            break;
+        }
+        if (ret == ESP_ERR_INVALID_CRC) {
+            sensor->stats.crc_errors++;
+        } else {
+            sensor->stats.bus_errors++;
+        }
+    }
+    latency_stats_since(LATENCY_PHASE_READ, start_us);
+
+    // Below 12 bit the low bits of the LSB are undefined
+    const uint8_t lsb_mask[] = {0x07, 0x03, 0x01, 0x00};
+    int16_t raw = (int16_t)(((uint16_t)scratchpad[1] << 8) | (scratchpad[0] & ~lsb_mask[sensor->resolution]));
+    if (ret == ESP_OK && raw == DS18B20_POWER_ON_RAW) {
+        // The sensor browned out after Convert-T and is back at its EEPROM resolution. 85 °C is above
+        // ESP_TEMP_SENSOR_MAX_VALUE, so a real reading is not lost
+        sensor->stats.power_on_values++;
+        ds18b20_write_scratchpad(sensor);
+        ret = ESP_ERR_INVALID_RESPONSE;
+    } else if (ret == ESP_OK && (raw < DS18B20_RAW_MIN || raw > DS18B20_RAW_MAX)) {
+        // Outside of what the sensor can measure, the transfer was garbled in a way the CRC missed
+        sensor->stats.bus_errors++;
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Failed to read scratchpad of DS18B20[%d], error: %s", index, esp_err_to_name(ret));
+        if (++sensor->failed_cycles >= DS18B20_QUARANTINE_CYCLES) {
+            sensor->quarantined = true;
+            sensor->stats.quarantines++;
+            ESP_LOGW(TAG, "DS18B20[%d] %016llX quarantined after %d failed cycles (CRC %lu, bus %lu, power-on %lu)",
+                     index, sensor->rom.address, sensor->failed_cycles, (unsigned long)sensor->stats.crc_errors,
+                     (unsigned long)sensor->stats.bus_errors, (unsigned long)sensor->stats.power_on_values);
+        }
+        return ret;
+    }
+    sensor->failed_cycles = 0;
+    sensor->stats.reads++;
+    *temperature = (int16_t)ds18b20_raw_to_centi_degrees(raw);  // -5500 to 12500 within the range checked above
+
+    ESP_LOGD(TAG, "Temperature read from DS18B20[%d]: " CENTI_DEGREES_FMT, index, CENTI_DEGREES_ARG(*temperature));
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_get_sensor_stats(int index, ds18b20_sensor_stats_t *stats) {
+    if (index >= ds18b20_device_num || index < 0 || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = ds18b20s[index].stats;
+    return ESP_OK;
+}
+
+bool ds18b20_is_sensor_quarantined(int index) {
+    if (index >= ds18b20_device_num || index < 0) {
+        return false;
+    }
+    return ds18b20s[index].quarantined;
+}
+
+// Put a quarantined sensor back into the cycle. It may have been power cycled or replaced, so its resolution
+// is set again instead of trusting the EEPROM
+static void ds18b20_release_device(int index) {
+    ds18b20_sensor_t *sensor = &ds18b20s[index];
+    sensor->resolution = DS18B20_RESOLUTION_12B;
+    if (ds18b20_write_scratchpad(sensor) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to reset resolution of DS18B20[%d]", index);
+    }
+    sensor->failed_cycles = 0;
+    sensor->quarantined = false;
+    ESP_LOGI(TAG, "DS18B20[%d] %016llX back in the sampling cycle", index, sensor->rom.address);
+}
+
+// A new probe takes over the index of a quarantined sensor on the same bus, the location stays the same
+static esp_err_t ds18b20_replace_device(int index, const ds18b20_rom_t *rom) {
+    ds18b20_sensor_t *sensor = &ds18b20s[index];
+    if ((rom->address & 0xFF) != DS18B20_FAMILY_CODE) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    ESP_LOGI(TAG, "DS18B20 %016llX replaces %016llX at index %d", rom->address, sensor->rom.address, index);
+    sensor->rom = *rom;
+    ds18b20_release_device(index);
+
+    // The replacement takes over the alarm thresholds of the endpoint
+    if (ds18b20_copy_scratchpad(&sensor->rom) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store the alarm thresholds of DS18B20[%d]", index);
+    }
+    return ESP_OK;
+}
+
+// A probe without an endpoint must stay out of the Alarm Search, its factory TH/TL bytes would put it in alarm
+static void ds18b20_disarm_device(const ds18b20_rom_t *rom) {
+    ds18b20_sensor_t probe = {
+        .rom = *rom,
+        .resolution = DS18B20_RESOLUTION_12B,
+        .alarm_low = DS18B20_ALARM_LOW_DISABLED,
+        .alarm_high = DS18B20_ALARM_HIGH_DISABLED,
+    };
+    if (ds18b20_write_scratchpad(&probe) != ESP_OK || ds18b20_copy_scratchpad(rom) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to disable the alarm thresholds of DS18B20 %016llX", rom->address);
+    }
+}
+
+static int ds18b20_registry_find(const ds18b20_rom_t *rom) {
+    for (int i = 0; i < ds18b20_device_num; i++) {
+        if (ds18b20_rom_equal(&ds18b20s[i].rom, rom)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Re-scan phases, every step does a bounded amount of bus work so the timer task is never held for long
+typedef enum {
+    DS18B20_RESCAN_IDLE,
+    DS18B20_RESCAN_SEARCH,      // One search pass per step, bus after bus
+    DS18B20_RESCAN_APPLY,       // Releases, replacements and new probes, at most one EEPROM write per step
+} ds18b20_rescan_state_t;
+
+// Static, the re-scan runs in the timer task whose stack is small
+static struct {
+    ds18b20_rescan_state_t state;
+    int bus;
+    ds18b20_search_t search;
+    ds18b20_rom_t found[DS18B20_MAX_SENSORS];
+    int found_num;
+    int next;                   // Next entry of found to apply
+    ds18b20_rom_t cache[DS18B20_MAX_SENSORS];
+    int cache_num;
+    bool cache_changed;
+} rescan;
+
+// End of the search: known sensors first, so a quarantined sensor that answers again gets its own index back
+static void ds18b20_rescan_prepare(void) {
+    for (int i = 0; i < rescan.found_num; i++) {
+        int index = ds18b20_registry_find(&rescan.found[i]);
+        if (index >= 0 && ds18b20s[index].quarantined) {
+            ds18b20_release_device(index);
+        }
+    }
+
+    // The registry order comes first in the cache, probes waiting for an endpoint follow
+    rescan.cache_num = ds18b20_rom_cache_load(rescan.cache, DS18B20_MAX_SENSORS);
+    rescan.cache_changed = rescan.cache_num < ds18b20_device_num;
+    for (int i = 0; i < ds18b20_device_num; i++) {
+        rescan.cache[i] = ds18b20s[i].rom;
+    }
+    if (rescan.cache_num < ds18b20_device_num) {
+        rescan.cache_num = ds18b20_device_num;
+    }
+    rescan.next = 0;
+}
+
+// A probe the registry does not know, returns true if its EEPROM was written
+static bool ds18b20_rescan_apply(const ds18b20_rom_t *rom) {
+    int slot = -1;
+    for (int j = 0; j < ds18b20_device_num && slot < 0; j++) {
+        if (ds18b20s[j].quarantined && ds18b20s[j].rom.bus == rom->bus) {
+            slot = j;
+        }
+    }
+    if (slot >= 0 && ds18b20_replace_device(slot, rom) == ESP_OK) {
+        rescan.cache[slot] = *rom;
+        rescan.cache_changed = true;
+        // The replacement may have been waiting in the cache for an endpoint
+        for (int j = ds18b20_device_num; j < rescan.cache_num; j++) {
+            if (ds18b20_rom_equal(&rescan.cache[j], rom)) {
+                rescan.cache[j] = rescan.cache[--rescan.cache_num];
+                break;
+            }
+        }
+        return true;
+    }
+    if (!ds18b20_rom_in(rom, rescan.cache, rescan.cache_num) && rescan.cache_num < DS18B20_MAX_SENSORS) {
+        // No endpoint to take over, endpoints are only created at boot
+        ESP_LOGW(TAG, "New DS18B20 %016llX on bus %d gets an endpoint after the next reboot", rom->address, (int)rom->bus);
+        ds18b20_disarm_device(rom);
+        rescan.cache[rescan.cache_num++] = *rom;
+        rescan.cache_changed = true;
+        return true;
+    }
+    return false;
+}
+
+bool ds18b20_rescan_step(void) {
+    if (rescan.state == DS18B20_RESCAN_IDLE) {
+        memset(rescan.found, 0, sizeof(rescan.found));  // Padding of the records is written to NVS
+        rescan.found_num = 0;
+        rescan.bus = 0;
+        memset(&rescan.search, 0, sizeof(rescan.search));
+        rescan.state = DS18B20_RESCAN_SEARCH;
+    }
+
+    if (rescan.state == DS18B20_RESCAN_SEARCH) {
+        if (rescan.bus < ONEWIRE_BUS_NUM && rescan.found_num < DS18B20_MAX_SENSORS) {
+            esp_err_t ret = ds18b20_search_next(rescan.bus, ONEWIRE_CMD_SEARCH_NORMAL, &rescan.search);
+            if (ret == ESP_OK && (rescan.search.address & 0xFF) == DS18B20_FAMILY_CODE) {
+                rescan.found[rescan.found_num].address = rescan.search.address;
+                rescan.found[rescan.found_num].bus = rescan.bus;
+                rescan.found_num++;
+            }
+            if (ret != ESP_OK || rescan.search.done) {
+                rescan.bus++;
+                memset(&rescan.search, 0, sizeof(rescan.search));
+            }
+            return true;
+        }
+        ds18b20_rescan_prepare();
+        rescan.state = DS18B20_RESCAN_APPLY;
+        return true;
+    }
+
+    while (rescan.next < rescan.found_num) {
+        const ds18b20_rom_t *rom = &rescan.found[rescan.next++];
+        if (ds18b20_registry_find(rom) < 0 && ds18b20_rescan_apply(rom)) {
+            return true;
+        }
+    }
+    if (rescan.cache_changed) {
+        ds18b20_rom_cache_store(rescan.cache, rescan.cache_num);
+    }
+    rescan.state = DS18B20_RESCAN_IDLE;
+    return false;
+}
+
+esp_err_t ds18b20_set_sensor_alarm(int index, int8_t low, int8_t high) {
     if (index >= ds18b20_device_num || index < 0) {
         ESP_LOGE(TAG, "Invalid sensor index: %d", index);
         return ESP_ERR_INVALID_ARG;
     }
+    ds18b20_sensor_t *sensor = &ds18b20s[index];
+    if (sensor->alarm_low == low && sensor->alarm_high == high) {
+        return ESP_OK;  // The EEPROM wears out, only write a change
+    }
 
-    // Trigger a temperature conversion
-    ESP_ERROR_CHECK(ds18b20_trigger_temperature_conversion(ds18b20s[index]));
+    int8_t previous_low = sensor->alarm_low;
+    int8_t previous_high = sensor->alarm_high;
+    sensor->alarm_low = low;
+    sensor->alarm_high = high;
+    esp_err_t ret = ds18b20_write_scratchpad(sensor);
+    if (ret == ESP_OK) {
+        ret = ds18b20_copy_scratchpad(&sensor->rom);
+    }
+    if (ret != ESP_OK) {
+        sensor->alarm_low = previous_low;
+        sensor->alarm_high = previous_high;
+        ESP_LOGE(TAG, "Failed to set alarm thresholds of DS18B20[%d], error: %s", index, esp_err_to_name(ret));
+        return ret;
+    }
 
-    // Read the temperature value
-    ESP_ERROR_CHECK(ds18b20_get_temperature(ds18b20s[index], temperature));
+    ESP_LOGI(TAG, "DS18B20[%d] alarm thresholds TL %d°C, TH %d°C", index, low, high);
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "Temperature read from DS18B20[%d]: %.2f°C", index, *temperature);
+esp_err_t ds18b20_get_sensor_alarm(int index, int8_t *low, int8_t *high) {
+    if (index >= ds18b20_device_num || index < 0 || low == NULL || high == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *low = ds18b20s[index].alarm_low;
+    *high = ds18b20s[index].alarm_high;
     return ESP_OK;
 }
+
+// Complete search of one bus with the given ROM command, err is set if a pass failed before the end
+static int ds18b20_search_bus(int bus_index, uint8_t command, onewire_device_address_t *addresses, int max_num, esp_err_t *err) {
+    ds18b20_search_t search = {0};
+    int num = 0;
+    *err = ESP_OK;
+    while (num < max_num) {
+        esp_err_t ret = ds18b20_search_next(bus_index, command, &search);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            break;
+        }
+        if (ret != ESP_OK) {
+            *err = ret;
+            break;
+        }
+        addresses[num++] = search.address;
+    }
+    return num;
+}
+
+esp_err_t ds18b20_alarm_search(bool *alarming, int count, int *alarm_num) {
+    if (alarming == NULL || count > ds18b20_device_num || count < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(alarming, 0, count * sizeof(*alarming));
+
+    // Static, the search runs in the timer task whose stack is small
+    static onewire_device_address_t found[DS18B20_MAX_SENSORS];
+    esp_err_t ret = ESP_OK;
+    for (int b = 0; b < ONEWIRE_BUS_NUM; b++) {
+        if (bus_device_nums[b] == 0) {
+            continue;
+        }
+
+        esp_err_t err;
+        int found_num = ds18b20_search_bus(b, ONEWIRE_CMD_SEARCH_ALARM, found, DS18B20_MAX_SENSORS, &err);
+        for (int i = 0; i < found_num; i++) {
+            ds18b20_rom_t rom = {.address = found[i], .bus = b};
+            int index = ds18b20_registry_find(&rom);
+            if (index >= 0 && index < count) {
+                alarming[index] = true;
+            }
+        }
+        if (err != ESP_OK) {
+            // A broken search may have missed sensors in alarm, read the whole bus instead
+            ESP_LOGD(TAG, "Alarm Search on bus %d failed, error: %s", b, esp_err_to_name(err));
+            for (int i = 0; i < count; i++) {
+                if (ds18b20s[i].location.bus == b) {
+                    alarming[i] = true;
+                }
+            }
+            ret = err;
+        }
+    }
+
+    if (alarm_num != NULL) {
+        *alarm_num = 0;
+        for (int i = 0; i < count; i++) {
+            *alarm_num += alarming[i];
+        }
+    }
+    return ret;
+}
+
+void ds18b20_release_buses(void) {
+    for (int b = 0; b < ONEWIRE_BUS_NUM; b++) {
+        if (buses[b] != NULL && onewire_bus_del(buses[b]) == ESP_OK) {
+            buses[b] = NULL;
+        }
+    }
+}
@@ -3,12 +3,139 @@
 #ifndef DS18B20_SENSOR_H
 #define DS18B20_SENSOR_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include "esp_err.h"
+#include "ds18b20.h"
+
+// Upper bound of the runtime-sized sensor registry, each sensor also gets its own Zigbee endpoint
+#ifndef DS18B20_MAX_SENSORS
+#define DS18B20_MAX_SENSORS 32
+#endif
+
+// Upper bound of the 1-Wire buses, each bus takes one RMT TX and one RX channel (the ESP32-C6 has two of each)
+#define DS18B20_MAX_BUSES 2
+
+/* GPIO pins of the 1-Wire buses, one bus per entry (e.g. 0,1), each bus gets its own RMT channels.
+ * Only the conversions run on all buses at once. The onewire_bus calls block until their transfer is done, so
+ * the scratchpad reads of the sampler task still take turns across buses and a second bus does not shorten the
+ * cycle. It buys cable length and a smaller load per bus, overlapping the reads would take a task per bus
+ */
+#ifndef DS18B20_ONEWIRE_BUS_GPIOS
+#define DS18B20_ONEWIRE_BUS_GPIOS 0  // Ensure these are the correct GPIO pins for your 1-Wire buses
+#endif
+
+// Scratchpad reads per sensor and cycle, and failed cycles in a row before a sensor is quarantined
+#define DS18B20_READ_ATTEMPTS       3
+#define DS18B20_QUARANTINE_CYCLES   3
+
+// A sensor is addressed by the bus it hangs on and its position on that bus
+typedef struct {
+    uint8_t bus;
+    uint8_t device;
+} ds18b20_sensor_location_t;
+
+// Error counters of one sensor since boot
+typedef struct {
+    uint32_t reads;             // Valid readings
+    uint32_t crc_errors;        // Scratchpad reads with a bad CRC
+    uint32_t bus_errors;        // Failed resets or transfers, or no device answering
+    uint32_t power_on_values;   // 85 °C power-on values rejected, the sensor lost power since Convert-T
+    uint32_t retries;           // Scratchpad reads repeated within a cycle
+    uint32_t quarantines;       // Times the sensor was taken out of the sampling cycle
+} ds18b20_sensor_stats_t;
 
 // Initialize the DS18B20 sensors
 esp_err_t ds18b20_init(void);
 
-// Read temperature from a DS18B20 sensor
-esp_err_t ds18b20_read_temperature(int index, float *temperature);
+// Number of DS18B20 sensors found by ds18b20_init()
+int ds18b20_get_sensor_count(void);
+
+// Number of configured 1-Wire buses
+int ds18b20_get_bus_count(void);
+
+// Number of DS18B20 sensors found on one bus
+int ds18b20_get_bus_sensor_count(int bus);
+
+// Registry index (and endpoint offset) of the sensor at (bus, device), -1 if there is none
+int ds18b20_get_sensor_index(int bus, int device);
+
+// (bus, device) location of the sensor at a registry index
+esp_err_t ds18b20_get_sensor_location(int index, ds18b20_sensor_location_t *location);
+
+// Start a conversion on every sensor of every bus at once (Skip-ROM + Convert-T), returns immediately
+esp_err_t ds18b20_trigger_conversion_all(void);
+
+// Time to wait after ds18b20_trigger_conversion_all() before the results can be read, set by the highest resolution in use
+uint32_t ds18b20_get_conversion_time_ms(void);
+
+// Read back the result of the last conversion of one sensor (Match-ROM + Read Scratchpad), in centi-degrees Celsius.
+// Blocks for the transfer, reads on different buses do not overlap
+// The scratchpad is CRC checked and read up to DS18B20_READ_ATTEMPTS times, the 85 °C power-on value is rejected
+esp_err_t ds18b20_read_conversion_result(int index, int16_t *temperature);
+
+// Error counters of one sensor. The counters are written by the sampling side, each is read whole but the set
+// may be one read apart
+esp_err_t ds18b20_get_sensor_stats(int index, ds18b20_sensor_stats_t *stats);
+
+// A sensor that failed several cycles in a row is quarantined: it is not read until ds18b20_rescan_step() finds it again
+bool ds18b20_is_sensor_quarantined(int index);
+
+/* Search all buses for quarantined sensors that answer again and for hot-plugged probes, without a restart.
+ * A new probe on the bus of a quarantined sensor takes over its index (and endpoint). Any further probe is added
+ * to the NVS cache and gets an endpoint after the next reboot.
+ * Runs in steps of one search pass or one EEPROM write (a few ms of bus time each), returns true while steps are
+ * left. Call it again until it returns false, a call after that starts the next re-scan. Sampling cycles may run
+ * between the steps, a step must not run while a cycle uses the bus.
+ */
+bool ds18b20_rescan_step(void);
+
+/* TH/TL alarm thresholds in whole degrees. After a conversion a sensor flags an alarm if the integer part of its
+ * reading is >= TH or <= TL, the disabled values are outside of the DS18B20 range (-55 to 125 °C) and never match.
+ */
+#define DS18B20_ALARM_LOW_DISABLED  (-128)
+#define DS18B20_ALARM_HIGH_DISABLED 127
+
+// Program the TL/TH thresholds of one sensor into its scratchpad and EEPROM, they survive a power cycle.
+// Returns once the EEPROM write started, see ds18b20_get_bus_wait_ms()
+esp_err_t ds18b20_set_sensor_alarm(int index, int8_t low, int8_t high);
+
+// Milliseconds until the last EEPROM write is done, no bus may be used before (e.g. by the next sampling cycle)
+uint32_t ds18b20_get_bus_wait_ms(void);
+
+// Current TL/TH thresholds of one sensor
+esp_err_t ds18b20_get_sensor_alarm(int index, int8_t *low, int8_t *high);
+
+/* Run after a conversion: an Alarm Search (0xEC) on every bus finds the sensors outside of their thresholds and
+ * sets alarming[index] for them. The sensors of a bus that fails the search are all marked, so they are read
+ * instead of missed. alarm_num receives the number of marked sensors.
+ */
+esp_err_t ds18b20_alarm_search(bool *alarming, int count, int *alarm_num);
+
+/* Free the RMT channels of all buses, the next bus access creates them again. An enabled RMT channel holds a
+ * power management lock that keeps the chip out of light sleep, so a sleepy node releases the buses before a long
+ * idle time between cycles. Creating a bus allocates, short waits such as the conversion keep it.
+ */
+void ds18b20_release_buses(void);
+
+// Set the conversion resolution (9-12 bit) of one sensor, lower resolutions convert faster
+esp_err_t ds18b20_set_sensor_resolution(int index, ds18b20_resolution_t resolution);
+
+// Current conversion resolution of one sensor
+ds18b20_resolution_t ds18b20_get_sensor_resolution(int index);
+
+// Conversion time of a given resolution (94, 188, 375 or 750 ms)
+uint32_t ds18b20_resolution_conversion_time_ms(ds18b20_resolution_t resolution);
+
+/* Convert a raw scratchpad temperature (1/16 °C, two's complement) to centi-degrees, rounded half away from zero.
+ * Exact for every raw code. Only the measuring range of the DS18B20 (-55 to 125 °C, -5500 to 12500) fits the
+ * int16_t of a ZCL temperature, ds18b20_read_conversion_result() rejects readings outside of it
+ */
+int32_t ds18b20_raw_to_centi_degrees(int16_t raw);
+
+// Integer formatting of centi-degrees for the log, e.g. ESP_LOGI(TAG, "T=" CENTI_DEGREES_FMT, CENTI_DEGREES_ARG(t))
+#define CENTI_DEGREES_FMT       "%s%d.%02d°C"
+#define CENTI_DEGREES_ARG(v)    ((v) < 0 ? "-" : ""), abs(v) / 100, abs(v) % 100
 
 #endif // DS18B20_SENSOR_H
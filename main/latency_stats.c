@@ -0,0 +1,72 @@
+// latency_stats.c
+
+#include <string.h>
+#include <stdatomic.h>
+#include "latency_stats.h"
+
+#define LATENCY_BUCKET_0_SHIFT  6   // Bucket 0 ends at 2^6 us
+#define LATENCY_SNAPSHOT_TRIES  4
+
+// Each phase is recorded by a single task, so the histograms need no lock. The sequence of a phase is odd while
+// its histogram is being updated, latency_stats_get() retries a copy that overlapped an update
+static latency_histogram_t histograms[LATENCY_PHASE_NUM];
+static atomic_uint histogram_seq[LATENCY_PHASE_NUM];
+static latency_histogram_t snapshots[LATENCY_PHASE_NUM];   // Last consistent copy, owned by the reader
+static uint32_t counters[LATENCY_COUNTER_NUM];
+
+static int latency_bucket(uint32_t duration_us) {
+    if (duration_us < (1u << LATENCY_BUCKET_0_SHIFT)) {
+        return 0;
+    }
+    int msb = 31 - __builtin_clz(duration_us);
+    int bucket = msb - LATENCY_BUCKET_0_SHIFT + 1;
+    return bucket < LATENCY_HISTOGRAM_BUCKETS ? bucket : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+void latency_stats_record(latency_phase_t phase, uint32_t duration_us) {
+    if (phase >= LATENCY_PHASE_NUM) {
+        return;
+    }
+    latency_histogram_t *histogram = &histograms[phase];
+    unsigned seq = atomic_load_explicit(&histogram_seq[phase], memory_order_relaxed);
+    atomic_store_explicit(&histogram_seq[phase], seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    histogram->count++;
+    histogram->total_us += duration_us;
+    if (duration_us > histogram->max_us) {
+        histogram->max_us = duration_us;
+    }
+    uint16_t *bucket = &histogram->buckets[latency_bucket(duration_us)];
+    if (*bucket < UINT16_MAX) {
+        (*bucket)++;
+    }
+    atomic_store_explicit(&histogram_seq[phase], seq + 2, memory_order_release);
+}
+
+void latency_stats_count(latency_counter_t counter) {
+    if (counter < LATENCY_COUNTER_NUM) {
+        counters[counter]++;
+    }
+}
+
+void latency_stats_get(latency_phase_t phase, latency_histogram_t *histogram) {
+    if (phase >= LATENCY_PHASE_NUM) {
+        memset(histogram, 0, sizeof(*histogram));
+        return;
+    }
+    for (int tries = 0; tries < LATENCY_SNAPSHOT_TRIES; tries++) {
+        unsigned seq = atomic_load_explicit(&histogram_seq[phase], memory_order_acquire);
+        memcpy(histogram, (const void *)&histograms[phase], sizeof(*histogram));
+        atomic_thread_fence(memory_order_acquire);
+        if (!(seq & 1) && atomic_load_explicit(&histogram_seq[phase], memory_order_relaxed) == seq) {
+            snapshots[phase] = *histogram;
+            return;
+        }
+    }
+    // The record in progress cannot finish while this task spins, see latency_stats.h
+    *histogram = snapshots[phase];
+}
+
+uint32_t latency_stats_get_counter(latency_counter_t counter) {
+    return counter < LATENCY_COUNTER_NUM ? counters[counter] : 0;
+}
@@ -0,0 +1,63 @@
+// latency_stats.h
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include "esp_timer.h"
+
+// Phases of a sampling cycle, from the broadcast on the bus to the attribute in the ZCL table
+typedef enum {
+    LATENCY_PHASE_TRIGGER,      // Skip-ROM Convert-T broadcast on all buses
+    LATENCY_PHASE_CONVERSION,   // End of the broadcast to the first scratchpad read (conversion wait + timer jitter)
+    LATENCY_PHASE_READ,         // Scratchpad read of one sensor, retries included
+    LATENCY_PHASE_CYCLE,        // Start of the broadcast to the last sensor published
+    LATENCY_PHASE_QUEUE,        // Sample queued by the sampler to popped by the Zigbee task
+    LATENCY_PHASE_ATTR_SET,     // Attribute write into the ZCL table
+    LATENCY_PHASE_SLOT,         // Distance of a cycle start from its slot on the network time grid (jitter)
+    LATENCY_PHASE_NUM,
+} latency_phase_t;
+
+// Events that cost time without a duration of their own
+typedef enum {
+    LATENCY_COUNTER_LOCK_BUSY,  // Drain request that found the Zigbee lock taken, the sampler asks again on its next step
+    LATENCY_COUNTER_NUM,
+} latency_counter_t;
+
+/* Fixed log2 buckets: bucket 0 holds durations below 64 us, bucket i holds [2^(i+5), 2^(i+6)) us,
+ * the last bucket everything from ~1 s up. Counts saturate at UINT16_MAX.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS   16
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint16_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+} latency_histogram_t;
+
+// Timestamp for latency_stats_since(), microseconds of esp_timer
+static inline int64_t latency_stats_now(void) {
+    return esp_timer_get_time();
+}
+
+// Add one duration to the histogram of a phase
+void latency_stats_record(latency_phase_t phase, uint32_t duration_us);
+
+// Add the time elapsed since start_us (from latency_stats_now()) to the histogram of a phase
+static inline void latency_stats_since(latency_phase_t phase, int64_t start_us) {
+    latency_stats_record(phase, (uint32_t)(latency_stats_now() - start_us));
+}
+
+void latency_stats_count(latency_counter_t counter);
+
+/* Snapshot of one histogram. Each phase is recorded by a single task without a lock, the snapshot is taken under
+ * a sequence counter, so the 64 bit total and the buckets always match count. A reader that preempted a record
+ * (the Zigbee task runs above the timer task of the sampler) gets the last consistent snapshot instead of
+ * waiting, it is one sample behind. Call it from one task only.
+ */
+void latency_stats_get(latency_phase_t phase, latency_histogram_t *histogram);
+
+uint32_t latency_stats_get_counter(latency_counter_t counter);
+
+#endif // LATENCY_STATS_H
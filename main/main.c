@@ -1,59 +1,50 @@
+#include <stdlib.h>
 #include "main.h"
 #include "nvs_flash.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/timers.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_system.h"
 #include "esp_zigbee_core.h" // Zigbee core includes
+#include "zboss_api.h"
 #include "ha/esp_zigbee_ha_standard.h"
-#include "ds18b20.h"
 #include "ds18b20_sensor.h"
+#include "sensor_app.h"
+#include "zigbee_hal.h"
+#include "sample_history.h"
+#include "latency_stats.h"
+#include "trace_log.h"
+#include "aggregate_frame.h"
+#include "ram_budget.h"
+#include "window_stats.h"
 #include "esp_wifi.h"
+#if ESP_TEMP_SLEEPY_END_DEVICE
+#include "esp_pm.h"
+#endif
 //#include "temp_sensor_driver.h"
 
 #if !defined ZB_ED_ROLE
 #error Define ZB_ED_ROLE in idf.py menuconfig to compile sensor (End Device) source code.
 #endif
 
-#define TEMPERATURE_READ_INTERVAL_MS 10000  // Read temperature every 10 seconds
 #define CUSTOM_SERVER_ENDPOINT_1 0x01
 #define CUSTOM_SERVER_ENDPOINT_2 0x02
 
 static const char *TAG = "ESP_ZB_TEMP_SENSOR";
 
+_Static_assert(HA_ESP_SENSOR_ENDPOINT + DS18B20_MAX_SENSORS - 1 <= 240, "Sensor endpoints exceed the Zigbee endpoint range");
+_Static_assert(AGGREGATE_FRAME_SIZE(DS18B20_MAX_SENSORS) <= AGGREGATE_FRAME_MAX_SIZE, "Aggregate frame does not fit one report");
+
 
 
-// Convert float temperature to Zigbee-compatible int16
+// Convert float temperature to Zigbee-compatible int16, rounded to the nearest centi-degree (configuration only, samples stay integer)
 static int16_t zb_temperature_to_s16(float temp) {
-    return (int16_t)(temp * 100);
+    return (int16_t)(temp * 100 + (temp < 0 ? -0.5f : 0.5f));
 }
 
 
-// Callback for commissioning retries
-static void bdb_start_top_level_commissioning_cb(uint8_t mode_mask) {
-    ESP_RETURN_ON_FALSE(esp_zb_bdb_start_top_level_commissioning(mode_mask) == ESP_OK, ,
-                        TAG, "Failed to start Zigbee commissioning");
-}
-
-// Update the temperature sensor value for a specific endpoint and report it
-static void esp_app_temp_sensor_handler(float temperature1, float temperature2) {
-  int16_t measured_value1 = zb_temperature_to_s16(temperature1);
-  int16_t measured_value2 = zb_temperature_to_s16(temperature2);
-
-  //Serial.println("Updating temperature sensor value...");
-  //Serial.println(measured_value);
-  /* Update temperature sensor measured value */
-    esp_zb_lock_acquire(portMAX_DELAY);
-    esp_zb_zcl_set_attribute_val(
-        HA_ESP_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID, &measured_value1,
-        false
-    );
-    esp_zb_zcl_set_attribute_val(
-        HA_ESP_SENSOR_ENDPOINT+1, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID, &measured_value2,
-        false
-    );
-    esp_zb_lock_release();
-}
 /*
 static void temp_sensor_value_update(void *arg) {
     float tsens_value1 = 0.0;
@@ -126,67 +117,109 @@ static void temp_sensor_value_update(void *arg) {
     }
 }
 */
-static void temp_sensor_value_update(void *arg) {
-    float tsens_value1 = 0.0;
-    float tsens_value2 = 0.0;
-    float prev_tsens_value1 = 0.0;
-    float prev_tsens_value2 = 0.0;
-    float delta_temp1 = 0.0;
-    float delta_temp2 = 0.0;
 
-    for (;;) {
-        // Read the current temperatures
-        esp_err_t err1 = ds18b20_read_temperature(0, &tsens_value1);
-        esp_err_t err2 = ds18b20_read_temperature(1, &tsens_value2);
+static TimerHandle_t temp_sensor_timer = NULL;
 
-        // Check if the temperature read was successful
-        if (err1 == ESP_OK) {
-            // Calculate the delta for sensor 1
-            delta_temp1 = tsens_value1 - prev_tsens_value1;
-            ESP_LOGI("MAIN", "Temperature 1: %.2f°C, Delta 1: %.2f°C", tsens_value1, delta_temp1);
+// Steps the sampler from a one-shot FreeRTOS timer, no task blocks while the sensors convert
+// and the 1-Wire transactions never run inside the Zigbee task
+static void temp_sensor_sampler_cb(TimerHandle_t timer) {
+    uint32_t delay_ms = sensor_app_sampler_step();
+    // Rounded up, a step that comes early would find an EEPROM write still running
+    TickType_t delay_ticks = pdMS_TO_TICKS(delay_ms + portTICK_PERIOD_MS - 1);
+    xTimerChangePeriod(timer, delay_ticks > 0 ? delay_ticks : 1, 0);
+}
 
-            // Write the temperature to Zigbee attribute (Endpoint 10)
-            int16_t zigbee_temp1 = zb_temperature_to_s16(tsens_value1);
-            esp_zb_zcl_set_attribute_val(
-                HA_ESP_SENSOR_ENDPOINT,
-                ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
-                ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
-                ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
-                &zigbee_temp1,
-                false
-            );
+static bool temp_sensor_sampler_start(void) {
+#if RAM_BUDGET_STATIC_ALLOCATION
+    static StaticTimer_t temp_sensor_timer_buffer;
+    temp_sensor_timer = xTimerCreateStatic("temp_sampler", 1, pdFALSE, NULL, temp_sensor_sampler_cb, &temp_sensor_timer_buffer);
+#else
+    temp_sensor_timer = xTimerCreate("temp_sampler", 1, pdFALSE, NULL, temp_sensor_sampler_cb);
+#endif
+    return temp_sensor_timer != NULL && xTimerStart(temp_sensor_timer, 0) == pdPASS;
+}
 
-            // Update the previous temperature for the next calculation
-            prev_tsens_value1 = tsens_value1;
-        } else {
-            ESP_LOGE("MAIN", "Failed to read temperature 1");
-        }
+// Step the sampler right away so a new period or an on-demand request takes effect, safe from the Zigbee task
+static void temp_sensor_sampler_wake(void) {
+    xTimerChangePeriod(temp_sensor_timer, 1, 0);
+}
 
-        if (err2 == ESP_OK) {
-            // Calculate the delta for sensor 2
-            delta_temp2 = tsens_value2 - prev_tsens_value2;
-            ESP_LOGI("MAIN", "Temperature 2: %.2f°C, Delta 2: %.2f°C", tsens_value2, delta_temp2);
+static TaskHandle_t temp_trace_task = NULL;
 
-            // Write the temperature to Zigbee attribute (Endpoint 11)
-            int16_t zigbee_temp2 = zb_temperature_to_s16(tsens_value2);
-            esp_zb_zcl_set_attribute_val(
-                HA_ESP_SENSOR_ENDPOINT + 1,
-                ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
-                ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
-                ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
-                &zigbee_temp2,
-                false
-            );
+// Prints the trace log when notified, at the lowest priority: the dump holds the UART for hundreds of
+// milliseconds, the Zigbee task and the sampler keep running meanwhile
+static void temp_trace_dump_task(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        trace_log_dump();
+    }
+}
 
-            // Update the previous temperature for the next calculation
-            prev_tsens_value2 = tsens_value2;
-        } else { 
-            ESP_LOGE("MAIN", "Failed to read temperature 2");
+// A write of the trace dump attribute, requests during a dump are merged into one more dump
+static void temp_trace_dump(void) {
+    xTaskNotifyGive(temp_trace_task);
+}
+
+static const sensor_app_platform_t temp_platform = {
+    .sampler_start = temp_sensor_sampler_start,
+    .sampler_wake = temp_sensor_sampler_wake,
+    .trace_dump = temp_trace_dump,
+};
+
+// Sees every ZCL command before the stack handles it: Configure Reporting changes the schedule once the stack
+// has stored it, Read Attributes of the temperature starts an on-demand cycle
+static bool temp_zb_raw_command_handler(uint8_t bufid) {
+    zb_zcl_parsed_hdr_t *cmd_info = ZB_BUF_GET_PARAM(bufid, zb_zcl_parsed_hdr_t);
+    if (!cmd_info->is_common_command || cmd_info->cluster_id != ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT) {
+        return false;
+    }
+
+    if (cmd_info->cmd_id == ZB_ZCL_CMD_CONFIG_REPORT) {
+        sensor_app_reporting_configured();
+    } else if (cmd_info->cmd_id == ZB_ZCL_CMD_READ_ATTRIB) {
+        sensor_app_read_requested();
+    }
+    return false;  // Let the stack answer as usual
+}
+
+// Answer to the Time attribute read of zigbee_hal_read_network_time()
+static void temp_time_read_response(const esp_zb_zcl_cmd_read_attr_resp_message_t *response) {
+    if (response->info.cluster != ESP_ZB_ZCL_CLUSTER_ID_TIME) {
+        return;
+    }
+    for (esp_zb_zcl_read_attr_resp_variable_t *variable = response->variables; variable != NULL; variable = variable->next) {
+        if (variable->status == ESP_ZB_ZCL_STATUS_SUCCESS && variable->attribute.id == ESP_ZB_ZCL_ATTR_TIME_TIME_ID &&
+            variable->attribute.data.value != NULL) {
+            sensor_app_time_response(*(const uint32_t *)variable->attribute.data.value);
+            return;
         }
+    }
+    sensor_app_time_response(CUSTOM_TEMP_TIMESTAMP_INVALID);  // Ends the pending request
+}
 
-        // Delay before the next temperature read (adjust as needed)
-        vTaskDelay(pdMS_TO_TICKS(5000));  // 5 seconds delay
+// Attribute writes from the coordinator: the sampling period override and the alarm thresholds of each endpoint,
+// and the answers to the Time attribute reads
+static esp_err_t temp_zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message) {
+    if (callback_id == ESP_ZB_CORE_CMD_READ_ATTR_RESP_CB_ID) {
+        temp_time_read_response(message);
+        return ESP_OK;
     }
+    if (callback_id != ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID) {
+        ESP_LOGD(TAG, "Zigbee action callback 0x%x", callback_id);
+        return ESP_OK;
+    }
+
+    const esp_zb_zcl_set_attr_value_message_t *set_attr = message;
+    ESP_RETURN_ON_FALSE(set_attr->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Attribute write failed");
+    if (set_attr->info.cluster == ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT) {
+        sensor_app_attr_written(set_attr->info.dst_endpoint, set_attr->attribute.id, set_attr->attribute.data.value);
+    }
+    return ESP_OK;
+}
+
+// APS confirm of the commands the node sent, the history flush waits for it before it drops the samples sent
+static void temp_zb_send_status_handler(esp_zb_zcl_command_send_status_message_t message) {
+    sensor_app_report_sent(message.tsn, message.status);
 }
 
 
@@ -214,26 +247,15 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct) {
     switch (sig_type) {
     case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
         ESP_LOGI(TAG, "Initialize Zigbee stack");
-        // esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION) is used to start the commissioning process in a Zigbee network using the Base Device Behavior (BDB) specification.
-        esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
+        // BDB initialization starts the commissioning process (Base Device Behavior), a failed one is retried by sensor_app.c
+        zigbee_hal_start_initialization();
         break;
 
     case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
     case ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT:
-        if (err_status == ESP_OK) {
-            // defferred_driver_init during boot to init functions
-            //ESP_LOGI(TAG, "Deferred driver initialization %s", deferred_driver_init() == ESP_OK ? "successful" : "failed");
-            ESP_LOGI(TAG, "Device started up in %s factory-reset mode", esp_zb_bdb_is_factory_new() ? "" : "non");
-            
-            if (esp_zb_bdb_is_factory_new()) {
-                ESP_LOGI(TAG, "Start network steering");
-                esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
-            } else {
-                ESP_LOGI(TAG, "Device rebooted, no factory reset");
-            }
-        } else {
-            ESP_LOGW(TAG, "Failed to initialize Zigbee stack (status: %s)", esp_err_to_name(err_status));
-        }
+        // defferred_driver_init during boot to init functions
+        //ESP_LOGI(TAG, "Deferred driver initialization %s", deferred_driver_init() == ESP_OK ? "successful" : "failed");
+        sensor_app_stack_started(err_status, err_status == ESP_OK && esp_zb_bdb_is_factory_new());
         break;
 
     case ESP_ZB_BDB_SIGNAL_STEERING:
@@ -244,19 +266,68 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct) {
                      extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4],
                      extended_pan_id[3], extended_pan_id[2], extended_pan_id[1], extended_pan_id[0],
                      esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
-        } else {
-            ESP_LOGI(TAG, "Network steering failed (status: %s), retrying...", esp_err_to_name(err_status));
-            esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb, ESP_ZB_BDB_MODE_NETWORK_STEERING, 1000);
         }
+        sensor_app_steering_done(err_status);
+        break;
+
+    case ESP_ZB_ZDO_SIGNAL_LEAVE:
+        sensor_app_left();
         break;
+
+#if ESP_TEMP_SLEEPY_END_DEVICE
+    case ESP_ZB_COMMON_SIGNAL_CAN_SLEEP:
+        // Nothing due in the stack for a while, the sampler timer wakes the chip for the next phase
+        esp_zb_sleep_now();
+        break;
+#endif
+
     default:
         ESP_LOGI(TAG, "ZDO signal: %s (0x%x), status: %s", esp_zb_zdo_signal_to_string(sig_type), sig_type, esp_err_to_name(err_status));
         break;
     }
 }
 
-static esp_zb_cluster_list_t *custom_temperature_sensor_clusters_create(esp_zb_temperature_sensor_cfg_t *temperature_sensor) {
+// Diagnostics cluster with the sampling latency histograms, one per node
+static esp_zb_attribute_list_t *custom_diagnostics_cluster_create(void) {
+    esp_zb_attribute_list_t *diagnostics_cluster = esp_zb_diagnostics_cluster_create(NULL);
+    uint32_t zero = 0;
+    uint8_t buckets_attr[1 + LATENCY_HISTOGRAM_BUCKETS * 2] = {LATENCY_HISTOGRAM_BUCKETS * 2};
+    const uint8_t access = ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING;
+
+    for (int phase = 0; phase < LATENCY_PHASE_NUM; phase++) {
+        uint16_t attr_id = CUSTOM_DIAG_LATENCY_ATTR_ID(phase, 0);
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(diagnostics_cluster, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+            attr_id + CUSTOM_DIAG_LATENCY_COUNT, CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U32, access, &zero));
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(diagnostics_cluster, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+            attr_id + CUSTOM_DIAG_LATENCY_MEAN, CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U32, access, &zero));
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(diagnostics_cluster, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+            attr_id + CUSTOM_DIAG_LATENCY_MAX, CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U32, access, &zero));
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(diagnostics_cluster, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+            attr_id + CUSTOM_DIAG_LATENCY_BUCKETS, CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, access, buckets_attr));
+    }
+    for (int counter = 0; counter < LATENCY_COUNTER_NUM; counter++) {
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(diagnostics_cluster, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+            CUSTOM_DIAG_COUNTER_ATTR_ID(counter), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U32, access, &zero));
+    }
+    for (int field = 0; field < CUSTOM_DIAG_REJOIN_NUM; field++) {
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(diagnostics_cluster, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+            CUSTOM_DIAG_REJOIN_ATTR_ID(field), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U32, access, &zero));
+    }
+    for (int field = 0; field < CUSTOM_DIAG_TIME_NUM; field++) {
+        bool is_signed = field == CUSTOM_DIAG_TIME_SKEW_PPB || field == CUSTOM_DIAG_TIME_CORRECTION_US;
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(diagnostics_cluster, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+            CUSTOM_DIAG_TIME_ATTR_ID(field), CUSTOM_MANUFACTURER_CODE, is_signed ? ESP_ZB_ZCL_ATTR_TYPE_S32 : ESP_ZB_ZCL_ATTR_TYPE_U32,
+            access, &zero));
+    }
+    return diagnostics_cluster;
+}
+
+static esp_zb_cluster_list_t *custom_temperature_sensor_clusters_create(esp_zb_temperature_sensor_cfg_t *temperature_sensor,
+                                                                        int index) {
     esp_zb_cluster_list_t *cluster_list = esp_zb_zcl_cluster_list_create();
+    int16_t alarm_low;
+    int16_t alarm_high;
+    sensor_app_get_alarm(index, &alarm_low, &alarm_high);
 
     // Basic Cluster
     esp_zb_attribute_list_t *basic_cluster = esp_zb_basic_cluster_create(&(temperature_sensor->basic_cfg));
@@ -271,38 +342,109 @@ static esp_zb_cluster_list_t *custom_temperature_sensor_clusters_create(esp_zb_t
         ESP_ZB_ZCL_CLUSTER_SERVER_ROLE
     ));
 
-    // Temperature Measurement Cluster
+    // Temperature Measurement Cluster, with the manufacturer specific attribute carrying the offline history
+    esp_zb_attribute_list_t *temp_meas_cluster = esp_zb_temperature_meas_cluster_create(&(temperature_sensor->temp_meas_cfg));
+    uint8_t history_attr[1 + SAMPLE_HISTORY_FRAME_MAX_SIZE] = {SAMPLE_HISTORY_FRAME_MAX_SIZE};  // Length reserves the full frame, version 0 means empty
+    ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(
+        temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, CUSTOM_TEMP_HISTORY_ATTRIBUTE_ID, CUSTOM_MANUFACTURER_CODE,
+        ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING, history_attr
+    ));
+    uint16_t sample_period_s = 0;
+    ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(
+        temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, CUSTOM_TEMP_SAMPLE_PERIOD_ATTRIBUTE_ID, CUSTOM_MANUFACTURER_CODE,
+        ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &sample_period_s
+    ));
+    ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(
+        temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, CUSTOM_TEMP_ALARM_LOW_ATTRIBUTE_ID, CUSTOM_MANUFACTURER_CODE,
+        ESP_ZB_ZCL_ATTR_TYPE_S16, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &alarm_low
+    ));
+    ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(
+        temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, CUSTOM_TEMP_ALARM_HIGH_ATTRIBUTE_ID, CUSTOM_MANUFACTURER_CODE,
+        ESP_ZB_ZCL_ATTR_TYPE_S16, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &alarm_high
+    ));
+    uint32_t timestamp_s = CUSTOM_TEMP_TIMESTAMP_INVALID;
+    ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(
+        temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID, CUSTOM_MANUFACTURER_CODE,
+        ESP_ZB_ZCL_ATTR_TYPE_UTC_TIME, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING, &timestamp_s
+    ));
     ESP_ERROR_CHECK(esp_zb_cluster_list_add_temperature_meas_cluster(
         cluster_list,
-        esp_zb_temperature_meas_cluster_create(&(temperature_sensor->temp_meas_cfg)),
+        temp_meas_cluster,
         ESP_ZB_ZCL_CLUSTER_SERVER_ROLE
     ));
 
+    // Window statistics, invalid until the first window closes
+    const uint8_t stats_access = ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING;
+    int16_t stats_invalid = WINDOW_STATS_INVALID;
+    uint16_t stats_zero = 0;
+    for (int window = 0; window < ESP_TEMP_STATS_WINDOW_NUM; window++) {
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+            CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_MIN), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_S16, stats_access, &stats_invalid));
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+            CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_MAX), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_S16, stats_access, &stats_invalid));
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+            CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_MEAN), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_S16, stats_access, &stats_invalid));
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+            CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_STDDEV), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U16, stats_access, &stats_zero));
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+            CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_COUNT), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U16, stats_access, &stats_zero));
+    }
+
+    // 1-Wire error counters of the sensor
+    uint32_t bus_stats_zero = 0;
+    for (int field = 0; field < CUSTOM_TEMP_BUS_STATS_NUM; field++) {
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+            CUSTOM_TEMP_BUS_STATS_ATTR_ID(field), CUSTOM_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_U32, stats_access, &bus_stats_zero));
+    }
+
+    if (index == 0) {
+        uint8_t trace_dump = 0;
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(
+            temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID, CUSTOM_MANUFACTURER_CODE,
+            ESP_ZB_ZCL_ATTR_TYPE_U8, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &trace_dump
+        ));
+    }
+#if ESP_TEMP_AGGREGATE_REPORT
+    if (index == 0) {
+        uint8_t aggregate_attr[1 + AGGREGATE_FRAME_MAX_SIZE] = {AGGREGATE_FRAME_SIZE(sensor_app_get_sensor_count())};  // Version 0 means empty
+        ESP_ERROR_CHECK(esp_zb_cluster_add_manufacturer_attr(
+            temp_meas_cluster, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID, CUSTOM_MANUFACTURER_CODE,
+            ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING, aggregate_attr
+        ));
+    }
+#endif
+    // Diagnostics Cluster, the node-wide diagnostics live on the first endpoint only, next to the Time cluster
+    // client that reads the network time from the coordinator
+    if (index == 0) {
+        ESP_ERROR_CHECK(esp_zb_cluster_list_add_time_cluster(
+            cluster_list,
+            esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_TIME),
+            ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE
+        ));
+        ESP_ERROR_CHECK(esp_zb_cluster_list_add_diagnostics_cluster(
+            cluster_list,
+            custom_diagnostics_cluster_create(),
+            ESP_ZB_ZCL_CLUSTER_SERVER_ROLE
+        ));
+    }
+
     return cluster_list;
 }
 
-static esp_zb_ep_list_t *custom_temperature_sensor_ep_create(uint8_t endpoint_id, 
-                                                              esp_zb_temperature_sensor_cfg_t *temperature_sensor_1, 
-                                                              esp_zb_temperature_sensor_cfg_t *temperature_sensor_2) {
+// One Temperature Measurement endpoint per sensor: endpoint_id, endpoint_id + 1, ...
+static esp_zb_ep_list_t *custom_temperature_sensor_ep_create(uint8_t endpoint_id, int sensor_count,
+                                                              esp_zb_temperature_sensor_cfg_t *temperature_sensor) {
     esp_zb_ep_list_t *ep_list = esp_zb_ep_list_create();
 
-    // Configure the first endpoint (for sensor 1)
-    esp_zb_endpoint_config_t endpoint_config_1 = {
-        .endpoint = endpoint_id,
-        .app_profile_id = ESP_ZB_AF_HA_PROFILE_ID,
-        .app_device_id = ESP_ZB_HA_TEMPERATURE_SENSOR_DEVICE_ID,
-        .app_device_version = 0
-    };
-    esp_zb_ep_list_add_ep(ep_list, custom_temperature_sensor_clusters_create(temperature_sensor_1), endpoint_config_1);
-
-    // Configure the second endpoint (for sensor 2)
-    esp_zb_endpoint_config_t endpoint_config_2 = {
-        .endpoint = endpoint_id + 1,  // Use a different endpoint ID for the second sensor
-        .app_profile_id = ESP_ZB_AF_HA_PROFILE_ID,
-        .app_device_id = ESP_ZB_HA_TEMPERATURE_SENSOR_DEVICE_ID,
-        .app_device_version = 0
-    };
-    esp_zb_ep_list_add_ep(ep_list, custom_temperature_sensor_clusters_create(temperature_sensor_2), endpoint_config_2);
+    for (int i = 0; i < sensor_count; i++) {
+        esp_zb_endpoint_config_t endpoint_config = {
+            .endpoint = endpoint_id + i,
+            .app_profile_id = ESP_ZB_AF_HA_PROFILE_ID,
+            .app_device_id = ESP_ZB_HA_TEMPERATURE_SENSOR_DEVICE_ID,
+            .app_device_version = 0
+        };
+        esp_zb_ep_list_add_ep(ep_list, custom_temperature_sensor_clusters_create(temperature_sensor, i), endpoint_config);
+    }
 
     return ep_list;
 }
@@ -314,23 +456,36 @@ static void esp_zb_task(void *pvParameters) {
     
     // Initialize Zigbee stack
     vTaskDelay(pdMS_TO_TICKS(1000));
+#if ESP_TEMP_SLEEPY_END_DEVICE
+    esp_zb_sleep_enable(true);  // Must come before esp_zb_init()
+#endif
     esp_zb_init(&zb_nwk_cfg);
+#if ESP_TEMP_SLEEPY_END_DEVICE
+    esp_zb_sleep_set_threshold(ESP_ZB_SLEEP_THRESHOLD_MS);
+    esp_zb_set_rx_on_when_idle(false);
+    zb_zdo_pim_set_long_poll_interval(ED_KEEP_ALIVE);
+#endif
 
-    // Create customized temperature sensor configurations for sensor 1 and sensor 2
-    esp_zb_temperature_sensor_cfg_t sensor_cfg_1 = ESP_ZB_DEFAULT_TEMPERATURE_SENSOR_CONFIG();
-    esp_zb_temperature_sensor_cfg_t sensor_cfg_2 = ESP_ZB_DEFAULT_TEMPERATURE_SENSOR_CONFIG();
-
-    // Set (Min|Max)MeasuredValue for sensor 1
-    sensor_cfg_1.temp_meas_cfg.min_value = zb_temperature_to_s16(ESP_TEMP_SENSOR_MIN_VALUE);
-    sensor_cfg_1.temp_meas_cfg.max_value = zb_temperature_to_s16(ESP_TEMP_SENSOR_MAX_VALUE);
-
-    // Set (Min|Max)MeasuredValue for sensor 2
-    sensor_cfg_2.temp_meas_cfg.min_value = zb_temperature_to_s16(ESP_TEMP_SENSOR_MIN_VALUE);
-    sensor_cfg_2.temp_meas_cfg.max_value = zb_temperature_to_s16(ESP_TEMP_SENSOR_MAX_VALUE);
-
-    // Create and register both endpoints with different configurations
-    esp_zb_ep_list_t *esp_zb_sensor_ep = custom_temperature_sensor_ep_create(HA_ESP_SENSOR_ENDPOINT, &sensor_cfg_1, &sensor_cfg_2);
-    esp_zb_device_register(esp_zb_sensor_ep);  // This registers both endpoints
+    // Create the temperature sensor configuration shared by all sensor endpoints
+    esp_zb_temperature_sensor_cfg_t sensor_cfg = ESP_ZB_DEFAULT_TEMPERATURE_SENSOR_CONFIG();
+
+    // Set (Min|Max)MeasuredValue
+    sensor_cfg.temp_meas_cfg.min_value = zb_temperature_to_s16(ESP_TEMP_SENSOR_MIN_VALUE);
+    sensor_cfg.temp_meas_cfg.max_value = zb_temperature_to_s16(ESP_TEMP_SENSOR_MAX_VALUE);
+
+    // Create and register one endpoint per discovered sensor
+    size_t free_heap_before = esp_get_free_heap_size();
+    int sensor_num = sensor_app_get_sensor_count();
+    esp_zb_ep_list_t *esp_zb_sensor_ep = custom_temperature_sensor_ep_create(HA_ESP_SENSOR_ENDPOINT, sensor_num, &sensor_cfg);
+    esp_zb_device_register(esp_zb_sensor_ep);  // This registers all endpoints
+    esp_zb_core_action_handler_register(temp_zb_action_handler);
+    esp_zb_raw_command_handler_register(temp_zb_raw_command_handler);
+    esp_zb_zcl_command_send_status_handler_register(temp_zb_send_status_handler);
+    size_t endpoint_heap = free_heap_before - esp_get_free_heap_size();
+    ESP_LOGI(TAG, "%d endpoint(s) registered, %u bytes of heap (%u per sensor)",
+             sensor_num, (unsigned)endpoint_heap, (unsigned)(sensor_num > 0 ? endpoint_heap / sensor_num : 0));
+    ram_budget_add(RAM_SUBSYSTEM_ZIGBEE_ENDPOINTS, endpoint_heap, false);
+    ram_budget_report();
 
     // Set reporting information for both endpoints (using endpoint 1 here as an example)
     /*esp_zb_zcl_reporting_info_t reporting_info1 = {
@@ -375,6 +530,23 @@ static void esp_zb_task(void *pvParameters) {
     esp_zb_stack_main_loop();
 }
 
+#if ESP_TEMP_SLEEPY_END_DEVICE
+// Automatic light sleep whenever every task is blocked, at a fixed CPU frequency as the Zigbee stack expects
+static esp_err_t esp_zb_power_save_init(void) {
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .light_sleep_enable = true,
+    };
+    return esp_pm_configure(&pm_config);
+#else
+    ESP_LOGW(TAG, "Enable CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE for light sleep");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+#endif
+
 // Application entry point
 void app_main(void) {
     // Zigbee platform configuration
@@ -387,6 +559,10 @@ void app_main(void) {
         .host_config = ESP_ZB_DEFAULT_HOST_CONFIG(),
     };
 
+#if ESP_TEMP_SLEEPY_END_DEVICE
+    esp_zb_power_save_init();
+#endif
+
     // Configure Zigbee platform
     ESP_ERROR_CHECK(esp_zb_platform_config(&config));
 
@@ -404,12 +580,32 @@ void app_main(void) {
         // Optionally handle this failure (e.g., retry, exit, etc.)
         return;  // Prevent further execution if the sensor initialization failed
     }
+    ESP_ERROR_CHECK(sensor_app_init(&temp_platform));
 
 
-    // Start Zigbee task
-    xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
-
-    xTaskCreate(temp_sensor_value_update, "temp_sensor_update", 4096, NULL, 10, NULL);
+    // Trace dump task, before the Zigbee task that notifies it
+#if RAM_BUDGET_STATIC_ALLOCATION
+    static StackType_t trace_task_stack[ESP_TEMP_TRACE_TASK_STACK_SIZE];
+    static StaticTask_t trace_task_buffer;
+    temp_trace_task = xTaskCreateStatic(temp_trace_dump_task, "trace_dump", ESP_TEMP_TRACE_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1,
+                                        trace_task_stack, &trace_task_buffer);
+#else
+    xTaskCreate(temp_trace_dump_task, "trace_dump", ESP_TEMP_TRACE_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, &temp_trace_task);
+#endif
+    ram_budget_track_task(temp_trace_task, ESP_TEMP_TRACE_TASK_STACK_SIZE);
+
+    // Start Zigbee task, the sensors are sampled from a FreeRTOS timer and the samples drained in this task
+    TaskHandle_t zb_task = NULL;
+#if RAM_BUDGET_STATIC_ALLOCATION
+    static StackType_t zb_task_stack[ESP_TEMP_ZB_TASK_STACK_SIZE];
+    static StaticTask_t zb_task_buffer;
+    zb_task = xTaskCreateStatic(esp_zb_task, "Zigbee_main", ESP_TEMP_ZB_TASK_STACK_SIZE, NULL, 5, zb_task_stack, &zb_task_buffer);
+#else
+    xTaskCreate(esp_zb_task, "Zigbee_main", ESP_TEMP_ZB_TASK_STACK_SIZE, NULL, 5, &zb_task);
+#endif
+    ram_budget_track_task(zb_task, ESP_TEMP_ZB_TASK_STACK_SIZE);
+    // The sampler runs in the timer service task
+    ram_budget_track_task(xTimerGetTimerDaemonTaskHandle(), configTIMER_TASK_STACK_DEPTH);
 
     // Simulate some activity in the main task
 }
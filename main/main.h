@@ -6,16 +6,110 @@
 /* Zigbee configuration */
 #define INSTALLCODE_POLICY_ENABLE       false   /* Enable the install code policy for security */
 #define ED_AGING_TIMEOUT                ESP_ZB_ED_AGING_TIMEOUT_64MIN
+
+/* Sleepy end device: rx-on-when-idle off, the radio only listens when the node polls its parent, and automatic
+ * light sleep between the sampling phases. Needs CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE in menuconfig.
+ */
+#ifndef ESP_TEMP_SLEEPY_END_DEVICE
+#define ESP_TEMP_SLEEPY_END_DEVICE      0
+#endif
+
+#if ESP_TEMP_SLEEPY_END_DEVICE
+#define ED_KEEP_ALIVE                   7000    /* Poll interval, under the 7.68 s a parent buffers frames for a sleepy child */
+#define ESP_TEMP_BUS_RELEASE_IDLE_MS    2000    /* Shortest idle time between cycles the 1-Wire buses are released for (milliseconds) */
+#else
 #define ED_KEEP_ALIVE                   3000    /* 3000 milliseconds */
+#endif
+#define ESP_ZB_SLEEP_THRESHOLD_MS       20      /* Shortest idle time the stack goes to sleep for */
+
+/* Aggregate reporting: the values of all sensors go out in one frame through the manufacturer specific attribute
+ * CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID of the first endpoint, instead of one MeasuredValue report per endpoint.
+ * Pair it with the ds18b20_aggregate.js converter.
+ */
+#ifndef ESP_TEMP_AGGREGATE_REPORT
+#define ESP_TEMP_AGGREGATE_REPORT       0
+#endif
 #define HA_ESP_SENSOR_ENDPOINT          10      /* ESP temperature sensor device endpoint, used for temperature measurement */
 #define ESP_ZB_PRIMARY_CHANNEL_MASK     ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK    /* Zigbee primary channel mask used in the example */
 
-#define ESP_TEMP_SENSOR_UPDATE_INTERVAL (1)     /* Local sensor update interval (seconds) */
+#define ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS (5000) /* Shortest sampling period, also the spacing of on-demand cycles (milliseconds) */
+#define ESP_TEMP_SENSOR_IDLE_SAMPLE_PERIOD_MS (600000) /* Longest sampling period, used while no reporting is configured (milliseconds) */
+#define ESP_TEMP_SENSOR_RESCAN_PERIOD_MS (60000) /* Period of the bus re-scan for recovered and hot-plugged sensors (milliseconds) */
+#define ESP_TEMP_SENSOR_ALARM_SLOW_CYCLES (12) /* A sensor with alarm thresholds is read every this many cycles while in range */
+#define ESP_TEMP_DIAGNOSTICS_PERIOD_MS (60000) /* Period of the latency histogram update on the Diagnostics cluster (milliseconds) */
+#define ESP_TEMP_SAMPLE_PHASE_MS        (0)     /* Offset of the sampling slots from multiples of the period in network time (milliseconds) */
+#define ESP_TEMP_TIME_SYNC_PERIOD_MS    (300000) /* Period of the coordinator Time attribute reads once synced (milliseconds) */
+#define ESP_TEMP_TIME_SYNC_RETRY_MS     (30000) /* Period of the Time attribute reads until the first answer (milliseconds) */
+#define ESP_TEMP_TIME_SYNC_DITHER_MS    (1000) /* Random delay added to each period, spreads the readings over the second of the Time attribute (milliseconds) */
+#define ESP_TEMP_TIME_SERVER_ENDPOINT   1       /* Coordinator endpoint with the Time cluster server */
+#define ESP_TEMP_STATS_SAMPLE_PERIOD_MS (60000) /* Sampling period while only the window statistics are reported (milliseconds) */
+#define ESP_TEMP_RAM_REPORT_PERIOD_MS (600000) /* Period of the stack and heap report in the log, see ram_budget.h (milliseconds) */
+#define ESP_TEMP_ZB_TASK_STACK_SIZE     4096    /* Zigbee task stack (bytes), size it from the high-water mark in the RAM report */
+#define ESP_TEMP_TRACE_TASK_STACK_SIZE  2560    /* Trace dump task stack (bytes) */
 #define ESP_TEMP_SENSOR_MIN_VALUE       (-10)   /* Local sensor min measured value (degrees Celsius) */
 #define ESP_TEMP_SENSOR_MAX_VALUE       (80)    /* Local sensor max measured value (degrees Celsius) */
 
 #define CUSTOM_ATTR_TEMP_SENSOR_2 0x4000  // Custom attribute for second temperature sensor
 #define CUSTOM_TEMP_ATTRIBUTE_ID 0x8000  // Manufacturer-specific attribute ID
+#define CUSTOM_TEMP_HISTORY_ATTRIBUTE_ID CUSTOM_TEMP_ATTRIBUTE_ID  // Offline history frames, octet string on the Temperature Measurement cluster
+#define CUSTOM_TEMP_SAMPLE_PERIOD_ATTRIBUTE_ID 0x8001  // Writable sampling period override in seconds, 0 follows the reporting configuration
+#define CUSTOM_TEMP_ALARM_LOW_ATTRIBUTE_ID 0x8002  // Writable TL alarm threshold (s16 centi-degrees, whole degrees are used)
+#define CUSTOM_TEMP_ALARM_HIGH_ATTRIBUTE_ID 0x8003  // Writable TH alarm threshold (s16 centi-degrees, whole degrees are used)
+#define CUSTOM_TEMP_ALARM_DISABLED ((int16_t)0x8000)  // Threshold value that disables it, the ZCL invalid s16
+#define CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID 0x8004  // All sensor values in one octet string (aggregate_frame.h), first endpoint only
+#define CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID 0x8006  // Writable u8, first endpoint only: a non-zero write prints the trace log (trace_log.h)
+#define CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID 0x8005  // Network time of the sample in MeasuredValue (UTC, s since 2000), 0xFFFFFFFF before the first sync
+#define CUSTOM_TEMP_TIMESTAMP_INVALID 0xFFFFFFFF  // ZCL invalid UTCTime
+#define CUSTOM_MANUFACTURER_CODE 0x131B  // Espressif manufacturer code for the manufacturer specific attributes
+
+/* Manufacturer specific attributes of the Temperature Measurement cluster on every endpoint: statistics of the
+ * last closed window per entry of ESP_TEMP_STATS_WINDOWS_S (see window_stats.h), refreshed when a window closes */
+#define ESP_TEMP_STATS_WINDOWS_S        {300, 3600, 86400}  /* 5 min, 1 h, 24 h, up to WINDOW_STATS_MAX_WINDOWS */
+#define ESP_TEMP_STATS_WINDOW_NUM       (int)(sizeof((uint32_t[])ESP_TEMP_STATS_WINDOWS_S) / sizeof(uint32_t))
+#define CUSTOM_TEMP_STATS_ATTR_ID(window, field)    (0x8100 + (window) * 0x10 + (field))
+#define CUSTOM_TEMP_STATS_MIN           0   // s16 centi-degrees
+#define CUSTOM_TEMP_STATS_MAX           1   // s16 centi-degrees
+#define CUSTOM_TEMP_STATS_MEAN          2   // s16 centi-degrees
+#define CUSTOM_TEMP_STATS_STDDEV        3   // u16 centi-degrees
+#define CUSTOM_TEMP_STATS_COUNT         4   // u16 samples
+
+/* Manufacturer specific attributes of the Temperature Measurement cluster on every endpoint: the 1-Wire error
+ * counters of the sensor since boot (u32, see ds18b20_sensor_stats_t), refreshed with the diagnostics */
+#define CUSTOM_TEMP_BUS_STATS_ATTR_ID(field)        (0x8200 + (field))
+#define CUSTOM_TEMP_BUS_STATS_READS     0
+#define CUSTOM_TEMP_BUS_STATS_CRC_ERRORS 1
+#define CUSTOM_TEMP_BUS_STATS_BUS_ERRORS 2
+#define CUSTOM_TEMP_BUS_STATS_POWER_ON  3
+#define CUSTOM_TEMP_BUS_STATS_RETRIES   4
+#define CUSTOM_TEMP_BUS_STATS_QUARANTINES 5
+#define CUSTOM_TEMP_BUS_STATS_NUM       6
+
+/* Manufacturer specific attributes of the Diagnostics cluster (0x0B05) on the first endpoint:
+ * per latency phase (see latency_stats.h) count, mean and max (u32, us) and the log2 histogram (octet string, u16 per bucket),
+ * followed by the event counters (u32) */
+#define CUSTOM_DIAG_LATENCY_ATTR_ID(phase, field)   (0x4000 + (phase) * 0x10 + (field))
+#define CUSTOM_DIAG_LATENCY_COUNT       0
+#define CUSTOM_DIAG_LATENCY_MEAN        1
+#define CUSTOM_DIAG_LATENCY_MAX         2
+#define CUSTOM_DIAG_LATENCY_BUCKETS     3
+#define CUSTOM_DIAG_COUNTER_ATTR_ID(counter)        (0x4100 + (counter))
+
+/* Manufacturer specific attributes of the Diagnostics cluster with the commissioning metrics (u32) */
+#define CUSTOM_DIAG_REJOIN_ATTR_ID(field)           (0x4200 + (field))
+#define CUSTOM_DIAG_REJOIN_LAST_MS      0   // Duration of the last successful commissioning run
+#define CUSTOM_DIAG_REJOIN_LAST_ATTEMPTS 1  // Steering attempts of that run
+#define CUSTOM_DIAG_REJOIN_TOTAL_ATTEMPTS 2 // Steering attempts since boot
+#define CUSTOM_DIAG_REJOIN_JOINS        3   // Successful commissioning runs since boot
+#define CUSTOM_DIAG_REJOIN_NUM          4
+
+/* Manufacturer specific attributes of the Diagnostics cluster with the network time metrics (see time_sync.h) */
+#define CUSTOM_DIAG_TIME_ATTR_ID(field)             (0x4300 + (field))
+#define CUSTOM_DIAG_TIME_SYNCS          0   // u32, Time attribute readings used
+#define CUSTOM_DIAG_TIME_STEPS          1   // u32, coordinator clock changes seen
+#define CUSTOM_DIAG_TIME_UNCERTAINTY_US 2   // u32, half width of the network time interval at the last reading
+#define CUSTOM_DIAG_TIME_SKEW_PPB       3   // s32, estimated drift of the local clock against the coordinator
+#define CUSTOM_DIAG_TIME_CORRECTION_US  4   // s32, correction made by the last reading
+#define CUSTOM_DIAG_TIME_NUM            5
 
 /* Attribute values in ZCL string format
  * The string should be started with the length of its own.
@@ -0,0 +1,19 @@
+// onewire_hal.c
+
+#include "onewire_hal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+esp_err_t onewire_hal_new_bus(int gpio_num, onewire_bus_handle_t *ret_bus) {
+    onewire_bus_config_t bus_config = {
+        .bus_gpio_num = gpio_num,
+    };
+    onewire_bus_rmt_config_t rmt_config = {
+        .max_rx_bytes = 10, // 1 byte ROM command + 8 bytes ROM number + 1 byte device command
+    };
+    return onewire_new_bus_rmt(&bus_config, &rmt_config, ret_bus);
+}
+
+void onewire_hal_delay_ms(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms) + 1);  // The first tick may be partial
+}
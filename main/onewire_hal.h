@@ -0,0 +1,18 @@
+// onewire_hal.h
+
+#ifndef ONEWIRE_HAL_H
+#define ONEWIRE_HAL_H
+
+#include "esp_err.h"
+#include "onewire_bus.h"
+
+/* Creates the 1-Wire bus on gpio_num. This is the only place that knows the bus backend (RMT on the ESP32-C6).
+ * Everything above it talks to the generic onewire_bus_* API, which dispatches through the onewire_bus_t
+ * interface, so another backend (e.g. a simulated bus on a host build) only has to implement that interface.
+ */
+esp_err_t onewire_hal_new_bus(int gpio_num, onewire_bus_handle_t *ret_bus);
+
+// Blocking delay for the bus setup at boot, e.g. an EEPROM write. The sampling path never blocks
+void onewire_hal_delay_ms(uint32_t ms);
+
+#endif // ONEWIRE_HAL_H
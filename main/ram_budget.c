@@ -0,0 +1,65 @@
+// ram_budget.c
+
+#include <stdbool.h>
+#include "ram_budget.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "RAM_BUDGET";
+
+static const char *const subsystem_names[RAM_SUBSYSTEM_NUM] = {
+    [RAM_SUBSYSTEM_SENSOR_REGISTRY] = "sensor registry",
+    [RAM_SUBSYSTEM_SENSOR_STATE] = "sensor state",
+    [RAM_SUBSYSTEM_HISTORY] = "offline history",
+    [RAM_SUBSYSTEM_ZIGBEE_ENDPOINTS] = "zigbee endpoints",
+};
+
+typedef struct {
+    size_t bytes;
+    bool is_static;
+} ram_subsystem_usage_t;
+
+typedef struct {
+    TaskHandle_t handle;
+    uint32_t stack_size;
+} ram_task_t;
+
+static ram_subsystem_usage_t subsystems[RAM_SUBSYSTEM_NUM];
+static ram_task_t tasks[RAM_BUDGET_MAX_TASKS];
+static int task_num = 0;
+
+void ram_budget_add(ram_subsystem_t subsystem, size_t bytes, bool is_static) {
+    if (subsystem < RAM_SUBSYSTEM_NUM) {
+        subsystems[subsystem].bytes += bytes;
+        subsystems[subsystem].is_static = is_static;
+    }
+}
+
+void ram_budget_track_task(TaskHandle_t task, uint32_t stack_size) {
+    if (task == NULL || task_num >= RAM_BUDGET_MAX_TASKS) {
+        return;
+    }
+    for (int i = 0; i < task_num; i++) {
+        if (tasks[i].handle == task) {
+            return;
+        }
+    }
+    tasks[task_num++] = (ram_task_t){.handle = task, .stack_size = stack_size};
+}
+
+void ram_budget_report(void) {
+    for (int i = 0; i < task_num; i++) {
+        // The high-water mark is the least free stack ever seen, in bytes on ESP-IDF
+        uint32_t free_min = uxTaskGetStackHighWaterMark(tasks[i].handle);
+        ESP_LOGI(TAG, "Task %s: stack %lu of %lu bytes used at most", pcTaskGetName(tasks[i].handle),
+                 (unsigned long)(tasks[i].stack_size - free_min), (unsigned long)tasks[i].stack_size);
+    }
+    for (int i = 0; i < RAM_SUBSYSTEM_NUM; i++) {
+        ESP_LOGI(TAG, "%s: %u bytes (%s)", subsystem_names[i], (unsigned)subsystems[i].bytes,
+                 subsystems[i].is_static ? "static" : "heap");
+    }
+    // A largest block far below the free heap means fragmentation
+    ESP_LOGI(TAG, "Heap: %u bytes free, %u minimum ever, %u largest block",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
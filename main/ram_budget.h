@@ -0,0 +1,39 @@
+// ram_budget.h
+
+#ifndef RAM_BUDGET_H
+#define RAM_BUDGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Static allocation build: the Zigbee task, the sampler timer, the sensor registry, the per-sensor application
+ * state and the offline history come from fixed pools sized for DS18B20_MAX_SENSORS instead of the heap.
+ * Only the cluster and endpoint lists stay on the heap, the Zigbee API allocates them itself.
+ */
+#ifndef RAM_BUDGET_STATIC_ALLOCATION
+#define RAM_BUDGET_STATIC_ALLOCATION    0
+#endif
+
+// Subsystems whose memory is accounted for in the report
+typedef enum {
+    RAM_SUBSYSTEM_SENSOR_REGISTRY,  // ds18b20_sensor.c registry
+    RAM_SUBSYSTEM_SENSOR_STATE,     // Per-sensor application state in sensor_app.c
+    RAM_SUBSYSTEM_HISTORY,          // Offline history rings
+    RAM_SUBSYSTEM_ZIGBEE_ENDPOINTS, // Cluster and endpoint lists, always heap
+    RAM_SUBSYSTEM_NUM,
+} ram_subsystem_t;
+
+#define RAM_BUDGET_MAX_TASKS    4
+
+// Account bytes to a subsystem, from a pool (is_static) or the heap
+void ram_budget_add(ram_subsystem_t subsystem, size_t bytes, bool is_static);
+
+// Include a task in the stack report, stack_size in bytes as passed to xTaskCreate
+void ram_budget_track_task(TaskHandle_t task, uint32_t stack_size);
+
+// Log the stack high-water mark of every tracked task, the memory per subsystem and the heap state
+void ram_budget_report(void);
+
+#endif // RAM_BUDGET_H
@@ -0,0 +1,58 @@
+// rejoin_policy.c
+
+#include "rejoin_policy.h"
+
+void rejoin_policy_init(rejoin_policy_t *policy, uint8_t cached_channel, uint16_t cached_pan_id) {
+    policy->cached_channel = cached_channel;
+    policy->cached_pan_id = cached_pan_id;
+    policy->active = false;
+    policy->started_ms = 0;
+    policy->attempts = 0;
+    policy->backoff_ms = 0;
+    policy->last_rejoin_ms = 0;
+    policy->last_attempts = 0;
+    policy->total_attempts = 0;
+    policy->joins = 0;
+}
+
+uint32_t rejoin_policy_attempt(rejoin_policy_t *policy, const rejoin_policy_config_t *config, uint32_t now_ms) {
+    if (!policy->active) {
+        policy->active = true;
+        policy->started_ms = now_ms;
+        policy->attempts = 0;
+        policy->backoff_ms = config->base_delay_ms;
+    }
+    policy->attempts++;
+    policy->total_attempts++;
+
+    // A cached channel outside the configured mask (the mask changed since) is not used
+    uint32_t cached_mask = policy->cached_channel != REJOIN_POLICY_NO_CHANNEL && policy->cached_channel < 32
+        ? (1u << policy->cached_channel) & config->all_channels_mask : 0;
+    if (cached_mask != 0 && policy->attempts <= config->cached_attempts) {
+        return cached_mask;
+    }
+    return config->all_channels_mask;
+}
+
+uint32_t rejoin_policy_failed(rejoin_policy_t *policy, const rejoin_policy_config_t *config, uint32_t random) {
+    // Equal jitter: somewhere in the upper half of the current backoff
+    uint32_t half = policy->backoff_ms / 2;
+    uint32_t delay_ms = half + random % (policy->backoff_ms - half + 1);
+
+    policy->backoff_ms = policy->backoff_ms > config->max_delay_ms / 2 ? config->max_delay_ms : policy->backoff_ms * 2;
+    return delay_ms;
+}
+
+bool rejoin_policy_joined(rejoin_policy_t *policy, uint8_t channel, uint16_t pan_id, uint32_t now_ms) {
+    if (policy->active) {
+        policy->active = false;
+        policy->last_rejoin_ms = now_ms - policy->started_ms;
+        policy->last_attempts = policy->attempts;
+        policy->joins++;
+    }
+
+    bool changed = channel != policy->cached_channel || pan_id != policy->cached_pan_id;
+    policy->cached_channel = channel;
+    policy->cached_pan_id = pan_id;
+    return changed;
+}
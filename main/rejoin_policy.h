@@ -0,0 +1,56 @@
+// rejoin_policy.h
+
+#ifndef REJOIN_POLICY_H
+#define REJOIN_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Commissioning retries: the first attempts of a run scan only the channel of the last network the node was on,
+ * later ones every channel of the configured mask. The delay between attempts doubles up to a bound, with jitter
+ * so that nodes that lost the same coordinator do not retry in lockstep.
+ */
+typedef struct {
+    uint32_t all_channels_mask; // Channels scanned once the cached channel did not work
+    uint32_t base_delay_ms;     // Backoff after the first failed attempt
+    uint32_t max_delay_ms;      // Upper bound of the backoff
+    uint8_t cached_attempts;    // Attempts on the cached channel before scanning all channels
+} rejoin_policy_config_t;
+
+#define REJOIN_POLICY_DEFAULT_CONFIG(channel_mask)  \
+    {                                               \
+        .all_channels_mask = (channel_mask),        \
+        .base_delay_ms = 1000,                      \
+        .max_delay_ms = 300 * 1000,                 \
+        .cached_attempts = 2,                       \
+    }
+
+#define REJOIN_POLICY_NO_CHANNEL    0   // Nothing cached, IEEE 802.15.4 channels are 11..26
+
+typedef struct {
+    uint8_t cached_channel;     // Channel of the last network, REJOIN_POLICY_NO_CHANNEL if none
+    uint16_t cached_pan_id;
+    bool active;                // A run is in progress, from its first attempt to the join
+    uint32_t started_ms;
+    uint32_t attempts;          // Attempts of the current run
+    uint32_t backoff_ms;        // Upper bound of the next delay
+    // Metrics
+    uint32_t last_rejoin_ms;    // Duration of the last successful run
+    uint32_t last_attempts;     // Attempts of the last successful run
+    uint32_t total_attempts;
+    uint32_t joins;
+} rejoin_policy_t;
+
+void rejoin_policy_init(rejoin_policy_t *policy, uint8_t cached_channel, uint16_t cached_pan_id);
+
+// Start the next attempt at now_ms, returns the channel mask to scan
+uint32_t rejoin_policy_attempt(rejoin_policy_t *policy, const rejoin_policy_config_t *config, uint32_t now_ms);
+
+// The attempt failed, returns the delay before the next one. random is any uniformly distributed value
+uint32_t rejoin_policy_failed(rejoin_policy_t *policy, const rejoin_policy_config_t *config, uint32_t random);
+
+// The node is on the network (channel, pan_id) at now_ms, ends the run.
+// Returns true if the cached network changed and should be stored
+bool rejoin_policy_joined(rejoin_policy_t *policy, uint8_t channel, uint16_t pan_id, uint32_t now_ms);
+
+#endif // REJOIN_POLICY_H
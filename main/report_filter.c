@@ -0,0 +1,63 @@
+// report_filter.c
+
+#include "report_filter.h"
+
+void report_filter_init(report_filter_t *filter) {
+    filter->has_reported = false;
+    filter->last_value = 0;
+    filter->last_direction = 0;
+    filter->last_report_ms = 0;
+    filter->samples = 0;
+    filter->reports = 0;
+}
+
+static bool report_filter_accept(report_filter_t *filter, int16_t value, int8_t direction, uint32_t now_ms) {
+    filter->has_reported = true;
+    filter->last_value = value;
+    if (direction != 0) {
+        filter->last_direction = direction;
+    }
+    filter->last_report_ms = now_ms;
+    filter->reports++;
+    return true;
+}
+
+bool report_filter_update(report_filter_t *filter, const report_filter_config_t *config, int16_t value, uint32_t now_ms) {
+    filter->samples++;
+
+    int32_t change = (int32_t)value - filter->last_value;
+    int8_t direction = change > 0 ? 1 : (change < 0 ? -1 : 0);
+
+    if (!filter->has_reported) {
+        return report_filter_accept(filter, value, direction, now_ms);
+    }
+
+    uint32_t elapsed_ms = now_ms - filter->last_report_ms;
+    if (elapsed_ms < config->min_interval_ms) {
+        return false;
+    }
+    if (config->max_interval_ms > 0 && elapsed_ms >= config->max_interval_ms) {
+        return report_filter_accept(filter, value, direction, now_ms);
+    }
+
+    // Turning around needs the extra hysteresis, so noise around a threshold does not flap
+    int32_t threshold = config->deadband;
+    if (direction != 0 && filter->last_direction != 0 && direction != filter->last_direction) {
+        threshold += config->hysteresis;
+    }
+    int32_t magnitude = change < 0 ? -change : change;
+    if (magnitude >= threshold && direction != 0) {
+        return report_filter_accept(filter, value, direction, now_ms);
+    }
+    return false;
+}
+
+bool report_filter_force(report_filter_t *filter, int16_t value, uint32_t now_ms) {
+    filter->samples++;
+
+    int32_t change = (int32_t)value - filter->last_value;
+    if (filter->has_reported && change == 0) {
+        return false;
+    }
+    return report_filter_accept(filter, value, change > 0 ? 1 : (change < 0 ? -1 : 0), now_ms);
+}
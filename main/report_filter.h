@@ -0,0 +1,44 @@
+// report_filter.h
+
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Decides per endpoint whether a new sample is worth writing to the ZCL attribute (and thus a report)
+typedef struct {
+    int16_t deadband;           // Minimum change from the last reported value (centi-degrees)
+    int16_t hysteresis;         // Extra change needed when the direction reverses (centi-degrees)
+    uint32_t min_interval_ms;   // No report sooner than this after the last one
+    uint32_t max_interval_ms;   // Report at least this often even without a change, 0 disables
+} report_filter_config_t;
+
+// Defaults follow the coordinator's reporting configuration in ds18b20.js (30 s to 10 min, 0.5°C)
+#define REPORT_FILTER_DEFAULT_CONFIG()      \
+    {                                       \
+        .deadband = 50,                     \
+        .hysteresis = 10,                   \
+        .min_interval_ms = 30 * 1000,       \
+        .max_interval_ms = 600 * 1000,      \
+    }
+
+typedef struct {
+    bool has_reported;
+    int16_t last_value;         // Last value that passed the filter
+    int8_t last_direction;      // Sign of the change that produced the last report
+    uint32_t last_report_ms;
+    uint32_t samples;           // Samples seen
+    uint32_t reports;           // Samples that passed the filter
+} report_filter_t;
+
+void report_filter_init(report_filter_t *filter);
+
+// Feed one sample taken at now_ms, returns true if it should be written to the attribute
+bool report_filter_update(report_filter_t *filter, const report_filter_config_t *config, int16_t value, uint32_t now_ms);
+
+// Feed a sample that must reach the coordinator now (e.g. an alarm) regardless of the configuration,
+// returns false only if exactly this value was reported last
+bool report_filter_force(report_filter_t *filter, int16_t value, uint32_t now_ms);
+
+#endif // REPORT_FILTER_H
@@ -0,0 +1,30 @@
+// resolution_policy.c
+
+#include "resolution_policy.h"
+
+void resolution_policy_init(resolution_policy_t *policy) {
+    policy->resolution = DS18B20_RESOLUTION_12B;
+    policy->stable_count = 0;
+}
+
+ds18b20_resolution_t resolution_policy_update(resolution_policy_t *policy, const resolution_policy_config_t *config, int32_t delta) {
+    int32_t magnitude = delta < 0 ? -delta : delta;
+
+    if (magnitude >= config->active_delta) {
+        // Temperature is moving, go straight back to full precision
+        policy->resolution = DS18B20_RESOLUTION_12B;
+        policy->stable_count = 0;
+    } else if (magnitude < config->stable_delta) {
+        if (++policy->stable_count >= config->stable_cycles) {
+            // Step down one bit at a time so a slow drift is still seen before precision is lost
+            if (policy->resolution > config->min_resolution) {
+                policy->resolution--;
+            }
+            policy->stable_count = 0;
+        }
+    } else {
+        policy->stable_count = 0;
+    }
+
+    return policy->resolution;
+}
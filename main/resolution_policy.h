@@ -0,0 +1,37 @@
+// resolution_policy.h
+
+#ifndef RESOLUTION_POLICY_H
+#define RESOLUTION_POLICY_H
+
+#include <stdint.h>
+#include "ds18b20.h"
+
+// Adaptive resolution: quiet sensors step down towards min_resolution, a fast change jumps back to 12 bit
+typedef struct {
+    int16_t stable_delta;                   // |delta| below this (centi-degrees per cycle) counts as a stable cycle
+    int16_t active_delta;                   // |delta| at or above this (centi-degrees per cycle) restores 12-bit resolution
+    uint8_t stable_cycles;                  // Consecutive stable cycles before stepping down one bit
+    ds18b20_resolution_t min_resolution;    // Lowest resolution the policy may select
+} resolution_policy_config_t;
+
+#define RESOLUTION_POLICY_DEFAULT_CONFIG()              \
+    {                                                   \
+        .stable_delta = 25,                             \
+        .active_delta = 50,                             \
+        .stable_cycles = 6,                             \
+        .min_resolution = DS18B20_RESOLUTION_10B,       \
+    }
+
+// Per-sensor policy state
+typedef struct {
+    ds18b20_resolution_t resolution;
+    uint8_t stable_count;
+} resolution_policy_t;
+
+// Start at full 12-bit resolution
+void resolution_policy_init(resolution_policy_t *policy);
+
+// Feed the delta of the last reading and return the resolution to use for the next conversion
+ds18b20_resolution_t resolution_policy_update(resolution_policy_t *policy, const resolution_policy_config_t *config, int32_t delta);
+
+#endif // RESOLUTION_POLICY_H
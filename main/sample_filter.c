@@ -0,0 +1,137 @@
+// sample_filter.c
+
+#include <string.h>
+#include "sample_filter.h"
+
+#define Q8_ONE      256
+#define Q15_ONE     32768
+
+typedef enum {
+    SAMPLE_REJECTED,
+    SAMPLE_ACCEPTED,
+    SAMPLE_RESTARTED,           // Accepted and the filter started over from it
+} sample_verdict_t;
+
+// Round a centi-degrees * 256 value to centi-degrees, half away from zero
+static int16_t q8_round(int32_t value) {
+    return (int16_t)(value >= 0 ? (value + Q8_ONE / 2) / Q8_ONE : (value - Q8_ONE / 2) / Q8_ONE);
+}
+
+void sample_filter_init(sample_filter_t *filter) {
+    memset(filter, 0, sizeof(*filter));
+}
+
+// Start over from a sample, used for the first sample and for a confirmed step
+static void sample_filter_reset(sample_filter_t *filter, const sample_filter_config_t *config, int16_t raw) {
+    filter->primed = true;
+    filter->last_input = raw;
+    filter->pending_count = 0;
+    filter->window[0] = raw;
+    filter->window_len = 1;
+    filter->window_pos = 1;
+    filter->estimate = (int32_t)raw * Q8_ONE;
+    filter->variance = (int32_t)config->kalman_r * Q8_ONE;
+}
+
+// Outlier rejection: outside the physical range, or a jump no real temperature makes within one period
+static sample_verdict_t sample_filter_accept(sample_filter_t *filter, const sample_filter_config_t *config, int16_t raw) {
+    if (raw < config->min_value || raw > config->max_value) {
+        filter->rejected++;
+        return SAMPLE_REJECTED;
+    }
+    if (!filter->primed) {
+        sample_filter_reset(filter, config, raw);
+        return SAMPLE_RESTARTED;
+    }
+
+    int32_t step = (int32_t)raw - filter->last_input;
+    if (step <= config->max_step && step >= -config->max_step) {
+        filter->pending_count = 0;
+        filter->last_input = raw;
+        return SAMPLE_ACCEPTED;
+    }
+
+    // A probe moved to another medium really steps, accept once several samples agree on the new level
+    int32_t pending_step = (int32_t)raw - filter->pending_value;
+    if (filter->pending_count > 0 && pending_step <= config->max_step && pending_step >= -config->max_step) {
+        filter->pending_count++;
+    } else {
+        filter->pending_count = 1;
+    }
+    filter->pending_value = raw;
+    if (filter->pending_count >= config->step_confirm) {
+        sample_filter_reset(filter, config, raw);
+        return SAMPLE_RESTARTED;
+    }
+    filter->rejected++;
+    return SAMPLE_REJECTED;
+}
+
+// Median of the window by insertion into a sorted copy, at most SAMPLE_FILTER_MEDIAN_MAX elements
+static int16_t sample_filter_median(sample_filter_t *filter, const sample_filter_config_t *config, int16_t raw) {
+    uint8_t size = config->median_window;
+    if (size < 1) {
+        size = 1;
+    } else if (size > SAMPLE_FILTER_MEDIAN_MAX) {
+        size = SAMPLE_FILTER_MEDIAN_MAX;
+    }
+
+    if (filter->window_pos >= size) {
+        filter->window_pos = 0;
+    }
+    filter->window[filter->window_pos++] = raw;
+    if (filter->window_len < size) {
+        filter->window_len++;
+    }
+
+    int16_t sorted[SAMPLE_FILTER_MEDIAN_MAX];
+    for (int i = 0; i < filter->window_len; i++) {
+        int j = i;
+        while (j > 0 && sorted[j - 1] > filter->window[i]) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = filter->window[i];
+    }
+    return sorted[filter->window_len / 2];
+}
+
+bool sample_filter_update(sample_filter_t *filter, const sample_filter_config_t *config, int16_t raw, int16_t *filtered) {
+    switch (sample_filter_accept(filter, config, raw)) {
+    case SAMPLE_REJECTED:
+        return false;
+    case SAMPLE_RESTARTED:
+        *filtered = raw;
+        return true;
+    case SAMPLE_ACCEPTED:
+    default:
+        break;
+    }
+
+    switch (config->type) {
+    case SAMPLE_FILTER_MEDIAN:
+        *filtered = sample_filter_median(filter, config, raw);
+        break;
+
+    case SAMPLE_FILTER_EMA:
+        filter->estimate += ((int32_t)raw * Q8_ONE - filter->estimate) * config->ema_alpha / Q8_ONE;
+        *filtered = q8_round(filter->estimate);
+        break;
+
+    case SAMPLE_FILTER_KALMAN: {
+        // Predict: the temperature may have drifted by the process noise. Update: weigh the sample by the gain
+        filter->variance += (int32_t)config->kalman_q * Q8_ONE;
+        int32_t gain = (int32_t)(((int64_t)filter->variance * Q15_ONE) / (filter->variance + (int32_t)config->kalman_r * Q8_ONE));
+        filter->estimate += (int32_t)(((int64_t)gain * ((int32_t)raw * Q8_ONE - filter->estimate)) / Q15_ONE);
+        filter->variance -= (int32_t)(((int64_t)gain * filter->variance) / Q15_ONE);
+        *filtered = q8_round(filter->estimate);
+        break;
+    }
+
+    case SAMPLE_FILTER_NONE:
+    default:
+        *filtered = raw;
+        break;
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+// sample_filter.h
+
+#ifndef SAMPLE_FILTER_H
+#define SAMPLE_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    SAMPLE_FILTER_NONE,         // Pass accepted samples through
+    SAMPLE_FILTER_MEDIAN,       // Median of the last median_window samples, removes single spikes
+    SAMPLE_FILTER_EMA,          // Exponential moving average, smooths noise
+    SAMPLE_FILTER_KALMAN,       // 1-D Kalman filter for a slowly drifting temperature
+} sample_filter_type_t;
+
+#define SAMPLE_FILTER_MEDIAN_MAX    7   // Largest median window, the window is odd
+
+// All values in centi-degrees Celsius, every update is integer only and takes constant time
+typedef struct {
+    sample_filter_type_t type;
+    int16_t min_value;          // Samples outside [min_value, max_value] are rejected (85 °C power-on, -127 °C disconnected)
+    int16_t max_value;
+    int16_t max_step;           // Largest believable change between two samples
+    uint8_t step_confirm;       // Out-of-step samples in a row (agreeing with each other) accepted as a real step
+    uint8_t median_window;      // Odd, up to SAMPLE_FILTER_MEDIAN_MAX
+    uint16_t ema_alpha;         // Weight of the new sample in 1/256 (1..256)
+    uint16_t kalman_q;          // Process noise per sample (centi-degrees²)
+    uint16_t kalman_r;          // Measurement noise (centi-degrees²), about 6.25² for the 1/16 °C step of the DS18B20
+} sample_filter_config_t;
+
+// Median of 3 removes a single bad sample at the cost of one sample of lag. A sampled temperature cannot change
+// by 5 °C within one period in a normal installation
+#define SAMPLE_FILTER_DEFAULT_CONFIG(min_centi, max_centi)  \
+    {                                                       \
+        .type = SAMPLE_FILTER_MEDIAN,                       \
+        .min_value = (min_centi),                           \
+        .max_value = (max_centi),                           \
+        .max_step = 500,                                    \
+        .step_confirm = 3,                                  \
+        .median_window = 3,                                 \
+        .ema_alpha = 64,                                    \
+        .kalman_q = 4,                                      \
+        .kalman_r = 40,                                     \
+    }
+
+// Per-sensor filter state, fixed size whatever the filter type
+typedef struct {
+    bool primed;                // Holds at least one accepted sample
+    int16_t last_input;         // Last accepted raw sample, the reference for the step check
+    int16_t pending_value;      // Last out-of-step sample
+    uint8_t pending_count;      // Out-of-step samples in a row
+    uint8_t window_len;
+    uint8_t window_pos;
+    int16_t window[SAMPLE_FILTER_MEDIAN_MAX];
+    int32_t estimate;           // EMA or Kalman estimate, centi-degrees * 256
+    int32_t variance;           // Kalman error variance, centi-degrees² * 256
+    uint32_t rejected;          // Samples rejected as outliers
+} sample_filter_t;
+
+void sample_filter_init(sample_filter_t *filter);
+
+// Feed one raw sample. Returns false if it was rejected as an outlier, otherwise stores the filtered value
+bool sample_filter_update(sample_filter_t *filter, const sample_filter_config_t *config, int16_t raw, int16_t *filtered);
+
+#endif // SAMPLE_FILTER_H
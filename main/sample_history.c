@@ -0,0 +1,104 @@
+// sample_history.c
+
+#include <stdlib.h>
+#include "sample_history.h"
+#include "ram_budget.h"
+
+#if RAM_BUDGET_STATIC_ALLOCATION
+// All rings are carved from one pool of the shared budget, they live as long as the application
+static history_sample_t history_pool[SAMPLE_HISTORY_BUDGET_BYTES / sizeof(history_sample_t)];
+static size_t history_pool_used = 0;
+#endif
+
+esp_err_t sample_history_init(sample_history_t *history, uint16_t capacity) {
+    size_t slots = capacity > 0 ? capacity : 1;
+#if RAM_BUDGET_STATIC_ALLOCATION
+    if (history_pool_used + slots > sizeof(history_pool) / sizeof(history_pool[0])) {
+        return ESP_ERR_NO_MEM;
+    }
+    history->samples = &history_pool[history_pool_used];
+    history_pool_used += slots;
+    ram_budget_add(RAM_SUBSYSTEM_HISTORY, slots * sizeof(history_sample_t), true);
+#else
+    history->samples = calloc(slots, sizeof(history_sample_t));
+    if (history->samples == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ram_budget_add(RAM_SUBSYSTEM_HISTORY, slots * sizeof(history_sample_t), false);
+#endif
+    history->capacity = capacity;
+    history->head = 0;
+    history->count = 0;
+    history->last_stored_s = 0;
+    history->overwritten = 0;
+    return ESP_OK;
+}
+
+uint16_t sample_history_capacity_for(int sensor_count) {
+    if (sensor_count <= 0) {
+        return 0;
+    }
+    size_t capacity = SAMPLE_HISTORY_BUDGET_BYTES / (sensor_count * sizeof(history_sample_t));
+    return capacity > UINT16_MAX ? UINT16_MAX : (uint16_t)capacity;
+}
+
+void sample_history_record(sample_history_t *history, uint32_t now_s, int16_t value) {
+    if (history->capacity == 0) {
+        return;
+    }
+    if (history->count > 0 && now_s - history->last_stored_s < SAMPLE_HISTORY_INTERVAL_S) {
+        return;
+    }
+
+    uint16_t slot = (history->head + history->count) % history->capacity;
+    if (history->count == history->capacity) {
+        // Full: the oldest sample makes room
+        history->head = (history->head + 1) % history->capacity;
+        history->overwritten++;
+    } else {
+        history->count++;
+    }
+    history->samples[slot].timestamp_s = now_s;
+    history->samples[slot].value = value;
+    history->last_stored_s = now_s;
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+size_t sample_history_encode_frame(const sample_history_t *history, uint8_t sensor, uint32_t now_s, uint8_t *frame, size_t frame_size) {
+    uint16_t count = history->count < SAMPLE_HISTORY_FRAME_SAMPLES ? history->count : SAMPLE_HISTORY_FRAME_SAMPLES;
+    if (count == 0 || frame_size < SAMPLE_HISTORY_FRAME_HEADER + count * 4u) {
+        return 0;
+    }
+
+    const history_sample_t *first = &history->samples[history->head];
+    uint32_t age_s = now_s - first->timestamp_s;
+    frame[0] = SAMPLE_HISTORY_FRAME_VERSION;
+    frame[1] = sensor;
+    frame[2] = (uint8_t)count;
+    put_u16(&frame[3], age_s & 0xFFFF);
+    put_u16(&frame[5], age_s >> 16);
+
+    uint8_t *p = &frame[SAMPLE_HISTORY_FRAME_HEADER];
+    uint32_t prev_s = first->timestamp_s;
+    for (uint16_t i = 0; i < count; i++) {
+        const history_sample_t *sample = &history->samples[(history->head + i) % history->capacity];
+        uint32_t gap_s = sample->timestamp_s - prev_s;
+        put_u16(&p[0], gap_s > UINT16_MAX ? UINT16_MAX : (uint16_t)gap_s);
+        put_u16(&p[2], (uint16_t)sample->value);
+        prev_s = sample->timestamp_s;
+        p += 4;
+    }
+    return p - frame;
+}
+
+void sample_history_consume(sample_history_t *history, uint16_t count) {
+    if (count > history->count) {
+        count = history->count;
+    }
+    history->head = (history->head + count) % history->capacity;
+    history->count -= count;
+}
@@ -0,0 +1,63 @@
+// sample_history.h
+
+#ifndef SAMPLE_HISTORY_H
+#define SAMPLE_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/* Store-and-forward history kept per sensor while the node is not on the network.
+ *
+ * Memory: one sample is sizeof(history_sample_t) = 6 bytes and one sample per sensor is stored
+ * every SAMPLE_HISTORY_INTERVAL_S, i.e. 3600 / SAMPLE_HISTORY_INTERVAL_S * 6 bytes per sensor and hour
+ * (360 bytes at the default 60 s). SAMPLE_HISTORY_BUDGET_BYTES is shared by all sensors, so the
+ * covered outage is BUDGET / (sensors * 360) hours: ~11 h for 2 sensors, ~1.4 h for 16 sensors.
+ * When a ring is full the oldest sample is overwritten.
+ */
+#define SAMPLE_HISTORY_INTERVAL_S       60
+#define SAMPLE_HISTORY_BUDGET_BYTES     8192
+#define SAMPLE_HISTORY_FRAME_SAMPLES    16      // Samples per bulk frame
+
+#define SAMPLE_HISTORY_FRAME_VERSION    1
+#define SAMPLE_HISTORY_FRAME_HEADER     7       // version, sensor, count, age of the first sample (u32)
+#define SAMPLE_HISTORY_FRAME_MAX_SIZE   (SAMPLE_HISTORY_FRAME_HEADER + SAMPLE_HISTORY_FRAME_SAMPLES * 4)
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_s;       // Uptime in seconds when the sample was taken
+    int16_t value;              // Centi-degrees Celsius
+} history_sample_t;
+
+typedef struct {
+    history_sample_t *samples;
+    uint16_t capacity;
+    uint16_t head;              // Oldest sample
+    uint16_t count;
+    uint32_t last_stored_s;
+    uint32_t overwritten;       // Samples lost because the ring was full
+} sample_history_t;
+
+// Allocate a ring of capacity samples
+esp_err_t sample_history_init(sample_history_t *history, uint16_t capacity);
+
+// Ring capacity per sensor so that all sensors together stay within SAMPLE_HISTORY_BUDGET_BYTES
+uint16_t sample_history_capacity_for(int sensor_count);
+
+// Store a sample taken at now_s, at most one per SAMPLE_HISTORY_INTERVAL_S
+void sample_history_record(sample_history_t *history, uint32_t now_s, int16_t value);
+
+static inline uint16_t sample_history_count(const sample_history_t *history) {
+    return history->count;
+}
+
+/* Encode up to SAMPLE_HISTORY_FRAME_SAMPLES of the oldest samples into a bulk frame (little endian):
+ *   u8 version, u8 sensor, u8 count, u32 age of the first sample in seconds at now_s,
+ *   count * { u16 seconds since the previous sample (0 for the first), s16 centi-degrees }
+ * Returns the frame size, the samples stay stored until sample_history_consume().
+ */
+size_t sample_history_encode_frame(const sample_history_t *history, uint8_t sensor, uint32_t now_s, uint8_t *frame, size_t frame_size);
+
+// Drop the count oldest samples, once their frame was sent
+void sample_history_consume(sample_history_t *history, uint16_t count);
+
+#endif // SAMPLE_HISTORY_H
@@ -0,0 +1,38 @@
+// sample_queue.c
+
+#include "sample_queue.h"
+
+_Static_assert((SAMPLE_QUEUE_CAPACITY & (SAMPLE_QUEUE_CAPACITY - 1)) == 0, "SAMPLE_QUEUE_CAPACITY must be a power of two");
+
+void sample_queue_init(sample_queue_t *queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->dropped, 0);
+}
+
+bool sample_queue_push(sample_queue_t *queue, const sample_record_t *record) {
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail >= SAMPLE_QUEUE_CAPACITY) {
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    queue->records[head & (SAMPLE_QUEUE_CAPACITY - 1)] = *record;
+    // Publish the record before the consumer can see the new head
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool sample_queue_pop(sample_queue_t *queue, sample_record_t *record) {
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *record = queue->records[tail & (SAMPLE_QUEUE_CAPACITY - 1)];
+    // Hand the slot back to the producer only after it was copied out
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
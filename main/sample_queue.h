@@ -0,0 +1,40 @@
+// sample_queue.h
+
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Capacity in records, a power of two, enough for two full cycles of DS18B20_MAX_SENSORS
+#ifndef SAMPLE_QUEUE_CAPACITY
+#define SAMPLE_QUEUE_CAPACITY   64
+#endif
+
+// Compact sample record handed from the sensor side to the Zigbee task
+typedef struct {
+    uint32_t timestamp_ms;      // esp_timer time of the scratchpad read
+    int16_t value;              // Centi-degrees Celsius, only valid when ok is set
+    uint8_t sensor;             // Registry index
+    uint8_t ok : 1;             // 1 if the read succeeded
+    uint8_t alarm : 1;          // 1 if the sensor was outside of its TH/TL thresholds, reported right away
+} sample_record_t;
+
+// Lock-free single-producer/single-consumer ring, push and pop never block
+typedef struct {
+    sample_record_t records[SAMPLE_QUEUE_CAPACITY];
+    atomic_uint head;           // Next slot to write, only advanced by the producer
+    atomic_uint tail;           // Next slot to read, only advanced by the consumer
+    atomic_uint dropped;        // Records lost because the queue was full
+} sample_queue_t;
+
+void sample_queue_init(sample_queue_t *queue);
+
+// Producer side, returns false (and counts a drop) when the queue is full
+bool sample_queue_push(sample_queue_t *queue, const sample_record_t *record);
+
+// Consumer side, returns false when the queue is empty
+bool sample_queue_pop(sample_queue_t *queue, sample_record_t *record);
+
+#endif // SAMPLE_QUEUE_H
@@ -0,0 +1,1023 @@
+// sensor_app.c
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "sensor_app.h"
+#include "main.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "nvs.h"
+#include "ds18b20_sensor.h"
+#include "sensor_sampler.h"
+#include "resolution_policy.h"
+#include "report_filter.h"
+#include "sample_filter.h"
+#include "sample_queue.h"
+#include "sample_history.h"
+#include "zigbee_hal.h"
+#include "latency_stats.h"
+#include "trace_log.h"
+#include "aggregate_frame.h"
+#include "rejoin_policy.h"
+#include "ram_budget.h"
+#include "window_stats.h"
+#include "time_sync.h"
+
+static const char *TAG = "ESP_ZB_TEMP_SENSOR";
+
+static const sensor_app_platform_t *temp_platform = NULL;
+
+// Channel and PAN of the last network, steering scans that channel first
+#define TEMP_REJOIN_NVS_NAMESPACE   "zb_rejoin"
+#define TEMP_REJOIN_NVS_KEY_NETWORK "network"
+
+typedef struct {
+    uint8_t channel;
+    uint16_t pan_id;
+} temp_rejoin_network_t;
+
+static const rejoin_policy_config_t rejoin_policy_config = REJOIN_POLICY_DEFAULT_CONFIG(ESP_ZB_PRIMARY_CHANNEL_MASK);
+static rejoin_policy_t rejoin_policy;
+
+static void temp_rejoin_cache_load(void) {
+    temp_rejoin_network_t network = {.channel = REJOIN_POLICY_NO_CHANNEL};
+    nvs_handle_t handle;
+    if (nvs_open(TEMP_REJOIN_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        size_t size = sizeof(network);
+        esp_err_t ret = nvs_get_blob(handle, TEMP_REJOIN_NVS_KEY_NETWORK, &network, &size);
+        nvs_close(handle);
+        if (ret != ESP_OK || size != sizeof(network)) {
+            network.channel = REJOIN_POLICY_NO_CHANNEL;
+        }
+    }
+    rejoin_policy_init(&rejoin_policy, network.channel, network.pan_id);
+    if (network.channel != REJOIN_POLICY_NO_CHANNEL) {
+        ESP_LOGI(TAG, "Cached network: channel %d, PAN ID 0x%04hx", network.channel, network.pan_id);
+    }
+}
+
+static void temp_rejoin_cache_store(void) {
+    temp_rejoin_network_t network = {.channel = rejoin_policy.cached_channel, .pan_id = rejoin_policy.cached_pan_id};
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(TEMP_REJOIN_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, TEMP_REJOIN_NVS_KEY_NETWORK, &network, sizeof(network));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store the network parameters, error: %s", esp_err_to_name(ret));
+    }
+}
+
+// Starts the next network steering attempt, on the cached channel first and then on all channels
+static void temp_commissioning_attempt_cb(uint8_t param) {
+    uint32_t channel_mask = rejoin_policy_attempt(&rejoin_policy, &rejoin_policy_config,
+                                                  (uint32_t)(esp_timer_get_time() / 1000));
+    ESP_LOGI(TAG, "Network steering attempt %lu, channel mask 0x%08lx",
+             (unsigned long)rejoin_policy.attempts, (unsigned long)channel_mask);
+    ESP_RETURN_ON_FALSE(zigbee_hal_start_steering(channel_mask) == ESP_OK, , TAG, "Failed to start Zigbee commissioning");
+}
+
+// Repeats a failed BDB initialization, the result arrives in sensor_app_stack_started() again
+static void temp_initialization_attempt_cb(uint8_t param) {
+    rejoin_policy_attempt(&rejoin_policy, &rejoin_policy_config, (uint32_t)(esp_timer_get_time() / 1000));
+    ESP_LOGI(TAG, "Zigbee stack initialization attempt %lu", (unsigned long)rejoin_policy.attempts);
+    ESP_RETURN_ON_FALSE(zigbee_hal_start_initialization() == ESP_OK, , TAG, "Failed to start Zigbee initialization");
+}
+
+// Called from the Zigbee task once the node is on a network, keeps the cache and the metrics up to date
+static void temp_commissioning_done(void) {
+    bool was_active = rejoin_policy.active;
+    uint16_t cached_pan_id = rejoin_policy.cached_pan_id;
+    uint8_t channel;
+    uint16_t pan_id;
+    zigbee_hal_get_network(&channel, &pan_id);
+    if (rejoin_policy_joined(&rejoin_policy, channel, pan_id, (uint32_t)(esp_timer_get_time() / 1000))) {
+        if (cached_pan_id != rejoin_policy.cached_pan_id) {
+            ESP_LOGI(TAG, "Network changed, caching PAN ID 0x%04hx", rejoin_policy.cached_pan_id);
+        }
+        temp_rejoin_cache_store();
+    }
+    if (was_active) {
+        ESP_LOGI(TAG, "Joined after %lu attempt(s) in %lu ms",
+                 (unsigned long)rejoin_policy.last_attempts, (unsigned long)rejoin_policy.last_rejoin_ms);
+    }
+}
+
+// Application state of one sensor, allocated for the sensors found at boot
+typedef struct {
+    // Sensor side, only touched by the sampler in the timer task
+    int16_t prev_value;         // Centi-degrees Celsius
+    resolution_policy_t resolution_policy;
+    sample_filter_t filter;
+    bool alarm_enabled;         // TH/TL programmed, the sensor is read when in alarm or on the slow schedule
+    uint8_t unread_cycles;      // Cycles since the last read while alarm_enabled
+    // Written by the Zigbee task, programmed into the sensor by the sampler between cycles
+    int16_t alarm_low;          // Centi-degrees Celsius, CUSTOM_TEMP_ALARM_DISABLED if not used
+    int16_t alarm_high;
+    // Zigbee side, only touched by the Zigbee task
+    report_filter_t report_filter;
+    report_filter_config_t report_config;   // Follows the reporting configuration of the endpoint
+    uint16_t sample_period_s;               // Written by the coordinator, 0 follows the reporting configuration
+    sample_history_t history;   // Samples taken while the node was off the network
+    window_stats_t stats;       // Min, max, mean and standard deviation per window
+} temp_sensor_state_t;
+
+static temp_sensor_state_t *temp_sensors = NULL;
+#if RAM_BUDGET_STATIC_ALLOCATION
+static temp_sensor_state_t temp_sensor_pool[DS18B20_MAX_SENSORS];
+#endif
+static int temp_sensor_num = 0;
+static const resolution_policy_config_t resolution_policy_config = RESOLUTION_POLICY_DEFAULT_CONFIG();
+static const sample_filter_config_t sample_filter_config =
+    SAMPLE_FILTER_DEFAULT_CONFIG(ESP_TEMP_SENSOR_MIN_VALUE * 100, ESP_TEMP_SENSOR_MAX_VALUE * 100);
+static const uint32_t temp_stats_windows_s[] = ESP_TEMP_STATS_WINDOWS_S;
+#define TEMP_STATS_WINDOW_NUM   ESP_TEMP_STATS_WINDOW_NUM
+_Static_assert(ESP_TEMP_STATS_WINDOW_NUM <= WINDOW_STATS_MAX_WINDOWS, "Too many statistics windows");
+
+// Samples travel from the sampler (timer task) to the Zigbee task without either side taking a lock
+static sample_queue_t temp_sample_queue;
+static atomic_bool temp_sample_drain_pending = false;
+
+// Result of the Alarm Search of the running cycle, and thresholds waiting to be programmed
+static bool temp_alarming[DS18B20_MAX_SENSORS];
+static atomic_bool temp_alarm_config_pending = false;
+
+// A drain request that found the stack busy is repeated by the sampler, no periodic poll keeps the node awake
+static atomic_bool temp_sample_drain_retry = false;
+
+#define TEMP_SAMPLE_DRAIN_RETRY_MS  20
+
+#if ESP_TEMP_AGGREGATE_REPORT
+// Zigbee side: last reported value of every sensor, sent together in one aggregate frame
+static int16_t temp_aggregate_values[DS18B20_MAX_SENSORS];
+#endif
+
+// Network state as seen by the Zigbee task, samples taken while off the network go to the history
+static bool temp_network_joined = false;
+static bool temp_history_flush_pending = false;
+
+#define TEMP_HISTORY_FLUSH_GAP_MS   500     // Spacing of the bulk frames so live reports keep flowing
+#define TEMP_HISTORY_CONFIRM_TIMEOUT_MS 10000 // A frame without an APS confirm by then is sent again
+#define TEMP_SAMPLING_SCHEDULE_DELAY_MS 100 // Configure Reporting is stored by the stack after the raw handler saw it
+
+static void temp_history_flush_cb(uint8_t param);
+static void temp_history_confirm_timeout_cb(uint8_t tsn);
+
+// The history frame waiting for its APS confirm, its samples stay stored until the coordinator has them
+static struct {
+    bool active;
+    uint8_t tsn;
+    int sensor;
+    uint8_t count;              // Samples of the frame
+    uint32_t overwritten;       // Overwritten count of the ring when the frame was sent
+} temp_history_inflight;
+
+// Network time, synced from the coordinator's Time cluster by the Zigbee task (see time_sync.h). The sampler in the
+// timer task gets a copy of the model through a sequence lock: odd while a write is in progress, a reader that saw
+// it change copies again
+static time_sync_t temp_time_sync;
+static int64_t temp_time_request_us = 0;
+static bool temp_time_request_pending = false;
+static bool temp_time_sync_started = false;
+static time_sync_model_t temp_time_model;
+static atomic_uint temp_time_model_seq = 0;
+
+static void temp_time_model_publish(const time_sync_model_t *model) {
+    atomic_fetch_add(&temp_time_model_seq, 1);
+    temp_time_model = *model;
+    atomic_fetch_add(&temp_time_model_seq, 1);
+}
+
+// Returns true once the network time is known
+static bool temp_time_model_load(time_sync_model_t *model) {
+    unsigned int seq;
+    do {
+        seq = atomic_load(&temp_time_model_seq);
+        *model = temp_time_model;
+    } while ((seq & 1) || atomic_load(&temp_time_model_seq) != seq);
+    return model->valid;
+}
+
+// Zigbee side: the statistics attributes change only when a window closes, the stack reports them
+// according to their reporting configuration
+static void temp_sensor_stats_update(int index, const sample_record_t *record) {
+    window_stats_result_t results[WINDOW_STATS_MAX_WINDOWS];
+    uint32_t closed = window_stats_update(&temp_sensors[index].stats, record->value, record->timestamp_ms, results);
+    for (int window = 0; closed != 0; window++, closed >>= 1) {
+        if (!(closed & 1)) {
+            continue;
+        }
+        uint8_t endpoint = HA_ESP_SENSOR_ENDPOINT + index;
+        zigbee_hal_set_manufacturer_attr(endpoint, CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_MIN), &results[window].min);
+        zigbee_hal_set_manufacturer_attr(endpoint, CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_MAX), &results[window].max);
+        zigbee_hal_set_manufacturer_attr(endpoint, CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_MEAN), &results[window].mean);
+        zigbee_hal_set_manufacturer_attr(endpoint, CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_STDDEV), &results[window].stddev);
+        zigbee_hal_set_manufacturer_attr(endpoint, CUSTOM_TEMP_STATS_ATTR_ID(window, CUSTOM_TEMP_STATS_COUNT), &results[window].count);
+    }
+}
+
+// Zigbee side: filter one sample and write it to the attribute table, runs in the Zigbee task context.
+// Returns true if the sample was reported (or, with the aggregate report, changed the frame)
+static bool temp_sensor_value_update(const sample_record_t *record) {
+    int index = record->sensor;
+    if (index >= temp_sensor_num) {
+        return false;
+    }
+    temp_sensor_state_t *sensor = &temp_sensors[index];
+
+    if (!record->ok) {
+#if ESP_TEMP_AGGREGATE_REPORT
+        // The frame must not repeat the last good value of a sensor that stopped answering. A sensor is only
+        // quarantined after failed reads, so this covers the quarantined ones too until a rescan brings them back
+        if (temp_aggregate_values[index] != AGGREGATE_FRAME_INVALID) {
+            temp_aggregate_values[index] = AGGREGATE_FRAME_INVALID;
+            return true;
+        }
+#endif
+        return false;  // Traced by the sampler
+    }
+    temp_sensor_stats_update(index, record);  // On or off the network, the windows keep running
+
+    if (!temp_network_joined) {
+        sample_history_record(&sensor->history, (uint32_t)(esp_timer_get_time() / 1000000), record->value);
+        return false;
+    }
+
+    // Only meaningful changes (deadband, hysteresis, min/max interval) reach the attribute table and the radio,
+    // a sensor in alarm is reported on every change without waiting for the reporting configuration
+    int16_t zigbee_temp = record->value;  // The sensor already delivers ZCL units (0.01°C)
+    bool report = record->alarm
+        ? report_filter_force(&sensor->report_filter, zigbee_temp, record->timestamp_ms)
+        : report_filter_update(&sensor->report_filter, &sensor->report_config, zigbee_temp, record->timestamp_ms);
+#if ESP_TEMP_AGGREGATE_REPORT
+    // A sensor back from failed reads has no value in the frame, however small the change since its last report
+    report |= temp_aggregate_values[index] == AGGREGATE_FRAME_INVALID;
+#endif
+    if (!report) {
+        return false;
+    }
+    trace_log_write(TRACE_EVENT_REPORT, (uint8_t)index, zigbee_temp);
+
+    // Network time of the sample, so samples of different nodes line up at the coordinator. The record keeps
+    // uptime milliseconds, which wrap, the age of the sample does not
+    uint32_t timestamp_s = CUSTOM_TEMP_TIMESTAMP_INVALID;
+    if (temp_time_sync.model.valid) {
+        uint32_t age_ms = (uint32_t)(esp_timer_get_time() / 1000) - record->timestamp_ms;
+        int64_t sampled_us = esp_timer_get_time() - (int64_t)age_ms * 1000;
+        timestamp_s = (uint32_t)(time_sync_to_network_us(&temp_time_sync.model, sampled_us) / 1000000);
+    }
+    zigbee_hal_set_manufacturer_attr(HA_ESP_SENSOR_ENDPOINT + index, CUSTOM_TEMP_TIMESTAMP_ATTRIBUTE_ID, &timestamp_s);
+
+    // Write the temperature to the Zigbee attribute (Endpoint 10 + index)
+    int64_t attr_set_start_us = latency_stats_now();
+    zigbee_hal_set_temperature(HA_ESP_SENSOR_ENDPOINT + index, zigbee_temp);
+    latency_stats_since(LATENCY_PHASE_ATTR_SET, attr_set_start_us);
+#if ESP_TEMP_AGGREGATE_REPORT
+    temp_aggregate_values[index] = zigbee_temp;  // Sent with the others once the batch is drained
+#else
+    if (record->alarm) {
+        zigbee_hal_report_temperature(HA_ESP_SENSOR_ENDPOINT + index);
+    }
+#endif
+    return true;
+}
+
+#if ESP_TEMP_AGGREGATE_REPORT
+// Zigbee side: one frame for all sensors instead of one report per endpoint. The stack reports the attribute
+// according to its reporting configuration, a sensor in alarm gets it sent right away
+static void temp_aggregate_publish(bool alarm) {
+    uint8_t attr[1 + AGGREGATE_FRAME_MAX_SIZE];  // ZCL octet string, length byte first
+    attr[0] = (uint8_t)aggregate_frame_encode(temp_aggregate_values, temp_sensor_num, &attr[1], AGGREGATE_FRAME_MAX_SIZE);
+    if (alarm) {
+        zigbee_hal_report_manufacturer_attr(HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID, attr, NULL);
+    } else {
+        zigbee_hal_set_manufacturer_attr(HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID, attr);
+    }
+}
+#endif
+
+// Drains every queued sample in one batch inside the Zigbee task
+static void temp_sample_drain_cb(uint8_t param) {
+    atomic_store(&temp_sample_drain_pending, false);
+
+    sample_record_t record;
+    int reports = 0;
+    bool alarm = false;
+    while (sample_queue_pop(&temp_sample_queue, &record)) {
+        uint32_t queued_ms = (uint32_t)(esp_timer_get_time() / 1000) - record.timestamp_ms;
+        latency_stats_record(LATENCY_PHASE_QUEUE, queued_ms * 1000);
+        if (temp_sensor_value_update(&record)) {
+            reports++;
+            alarm |= record.alarm;
+        }
+    }
+
+#if ESP_TEMP_AGGREGATE_REPORT
+    if (reports > 0) {
+        temp_aggregate_publish(alarm);
+    }
+#else
+    (void)alarm;
+#endif
+
+#if ESP_TEMP_SLEEPY_END_DEVICE
+    // Poll the parent while the radio is up for the reports anyway, a command the coordinator queued
+    // (often in reply to a report) is picked up now instead of at the next long poll
+    if (reports > 0) {
+        zigbee_hal_poll_parent();
+    }
+#endif
+}
+
+// Ask the Zigbee task for a drain without ever waiting for the stack lock
+static void temp_sample_drain_request(void) {
+    if (atomic_exchange(&temp_sample_drain_pending, true)) {
+        return;
+    }
+    if (zigbee_hal_try_lock()) {
+        zigbee_hal_schedule(temp_sample_drain_cb, 0, 0);
+        zigbee_hal_unlock();
+    } else {
+        // Stack busy, the sampler asks again shortly
+        atomic_store(&temp_sample_drain_pending, false);
+        atomic_store(&temp_sample_drain_retry, true);
+        latency_stats_count(LATENCY_COUNTER_LOCK_BUSY);
+    }
+}
+
+static int64_t temp_cycle_started_us = 0;
+static bool temp_cycle_slotted = false;         // The waiting cycle was put on a slot of the network time grid
+static uint32_t temp_cycle_slot_period_ms = 0;  // Period of that grid
+
+// Sensor side: starts a cycle, the cycle latency runs from here to the last sensor published
+static esp_err_t temp_sensor_trigger(void) {
+    temp_cycle_started_us = latency_stats_now();
+    // How far off its slot the cycle starts: timer resolution and the model correction since it was planned
+    time_sync_model_t time_model;
+    if (temp_cycle_slotted && temp_time_model_load(&time_model)) {
+        int32_t slot_error_us = time_sync_slot_error_us(&time_model, temp_cycle_started_us, temp_cycle_slot_period_ms,
+                                                        ESP_TEMP_SAMPLE_PHASE_MS);
+        latency_stats_record(LATENCY_PHASE_SLOT, (uint32_t)abs(slot_error_us));
+    }
+    temp_cycle_slotted = false;
+    return ds18b20_trigger_conversion_all();
+}
+
+// Sensor side: called by the sampler for every sensor once its scratchpad was read
+static void temp_sensor_sample_publish(int index, esp_err_t err, int16_t tsens_value) {
+    if (index < 0 || index >= temp_sensor_num) {
+        return;
+    }
+    temp_sensor_state_t *sensor = &temp_sensors[index];
+    sample_record_t record = {
+        .timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .value = tsens_value,
+        .sensor = (uint8_t)index,
+        .ok = err == ESP_OK,
+        .alarm = sensor->alarm_enabled && temp_alarming[index],
+    };
+
+    // Outliers never reach the queue, a rejected sample counts like a failed read downstream
+    if (err == ESP_OK && !sample_filter_update(&sensor->filter, &sample_filter_config, tsens_value, &record.value)) {
+        trace_log_write(TRACE_EVENT_OUTLIER, (uint8_t)index, tsens_value);
+        record.ok = 0;
+    } else if (err == ESP_OK) {
+        // Calculate the delta for this sensor from the raw samples, the decoder derives it from consecutive samples
+        int32_t delta_temp = (int32_t)tsens_value - sensor->prev_value;
+        trace_log_write(TRACE_EVENT_SAMPLE, (uint8_t)index, tsens_value);
+
+        // Update the previous temperature for the next calculation
+        sensor->prev_value = tsens_value;
+
+        // Quiet sensors convert at a lower resolution, a fast change restores 12 bit for the next cycle
+        ds18b20_resolution_t resolution = resolution_policy_update(&sensor->resolution_policy, &resolution_policy_config, delta_temp);
+        if (resolution != ds18b20_get_sensor_resolution(index)) {
+            ds18b20_set_sensor_resolution(index, resolution);
+        }
+    } else {
+        trace_log_write(TRACE_EVENT_READ_ERROR, (uint8_t)index, (int16_t)err);
+    }
+
+    if (!sample_queue_push(&temp_sample_queue, &record)) {
+        unsigned dropped = atomic_load(&temp_sample_queue.dropped);
+        trace_log_write(TRACE_EVENT_QUEUE_DROP, (uint8_t)index, (int16_t)(dropped < INT16_MAX ? dropped : INT16_MAX));
+    }
+    temp_sample_drain_request();
+}
+
+static int temp_sensor_count(void) {
+    return temp_sensor_num;
+}
+
+// Sensor side: runs once the conversion is done. The Alarm Search costs a few bus slots instead of a scratchpad
+// read per sensor, only the sensors it finds are read every cycle
+static void temp_sensor_alarm_search(void) {
+    bool any_enabled = false;
+    for (int i = 0; i < temp_sensor_num; i++) {
+        any_enabled |= temp_sensors[i].alarm_enabled;
+    }
+    if (!any_enabled) {
+        return;  // temp_alarming stays cleared, every sensor is read
+    }
+
+    int alarm_num = 0;
+    ds18b20_alarm_search(temp_alarming, temp_sensor_num, &alarm_num);
+    ESP_LOGD(TAG, "%d sensor(s) in alarm", alarm_num);
+}
+
+// Sensor side: sensors with thresholds are read when in alarm, and every ESP_TEMP_SENSOR_ALARM_SLOW_CYCLES cycles
+static bool temp_sensor_skip(int index) {
+    temp_sensor_state_t *sensor = &temp_sensors[index];
+    if (!sensor->alarm_enabled || temp_alarming[index] || ++sensor->unread_cycles >= ESP_TEMP_SENSOR_ALARM_SLOW_CYCLES) {
+        sensor->unread_cycles = 0;
+        return false;
+    }
+    return true;
+}
+
+// Whole degrees for TH/TL, rounded down. The sensor compares the integer part of its reading, so an alarm
+// is flagged up to one degree early but never missed
+static int8_t temp_alarm_degrees(int16_t centi_degrees, int8_t disabled) {
+    if (centi_degrees == CUSTOM_TEMP_ALARM_DISABLED) {
+        return disabled;
+    }
+    int32_t degrees = centi_degrees >= 0 ? centi_degrees / 100 : -((-centi_degrees + 99) / 100);
+    return (int8_t)(degrees < -55 ? -55 : (degrees > 125 ? 125 : degrees));
+}
+
+static int16_t temp_alarm_centi_degrees(int8_t degrees, int8_t disabled) {
+    return degrees == disabled ? CUSTOM_TEMP_ALARM_DISABLED : (int16_t)(degrees * 100);
+}
+
+// Sensor side: program the thresholds written by the coordinator, the bus is free between cycles. Starts an
+// EEPROM write for at most one sensor per call, returns true while sensors are left
+static int temp_alarm_apply_next = 0;
+
+static bool temp_sensor_alarm_apply(void) {
+    for (; temp_alarm_apply_next < temp_sensor_num; temp_alarm_apply_next++) {
+        temp_sensor_state_t *sensor = &temp_sensors[temp_alarm_apply_next];
+        int8_t low = temp_alarm_degrees(sensor->alarm_low, DS18B20_ALARM_LOW_DISABLED);
+        int8_t high = temp_alarm_degrees(sensor->alarm_high, DS18B20_ALARM_HIGH_DISABLED);
+        int8_t current_low;
+        int8_t current_high;
+        ds18b20_get_sensor_alarm(temp_alarm_apply_next, &current_low, &current_high);
+        bool changed = low != current_low || high != current_high;
+        if (ds18b20_set_sensor_alarm(temp_alarm_apply_next, low, high) == ESP_OK) {
+            sensor->alarm_enabled = low != DS18B20_ALARM_LOW_DISABLED || high != DS18B20_ALARM_HIGH_DISABLED;
+            sensor->unread_cycles = 0;
+        }
+        if (changed) {
+            temp_alarm_apply_next++;
+            return temp_alarm_apply_next < temp_sensor_num;
+        }
+    }
+    return false;
+}
+
+// Allocate the per-sensor application state for the sensors found by ds18b20_init()
+static esp_err_t temp_sensors_create(void) {
+    temp_sensor_num = ds18b20_get_sensor_count();
+#if RAM_BUDGET_STATIC_ALLOCATION
+    temp_sensors = temp_sensor_pool;
+    ram_budget_add(RAM_SUBSYSTEM_SENSOR_STATE, sizeof(temp_sensor_pool), true);
+#else
+    temp_sensors = calloc(temp_sensor_num, sizeof(temp_sensor_state_t));
+    ESP_RETURN_ON_FALSE(temp_sensors != NULL, ESP_ERR_NO_MEM, TAG, "Failed to allocate state for %d sensor(s)", temp_sensor_num);
+    ram_budget_add(RAM_SUBSYSTEM_SENSOR_STATE, temp_sensor_num * sizeof(temp_sensor_state_t), false);
+#endif
+    uint16_t history_capacity = sample_history_capacity_for(temp_sensor_num);
+
+    for (int i = 0; i < temp_sensor_num; i++) {
+        // The thresholds live in the EEPROM of the sensor, the attributes start from there
+        int8_t alarm_low = DS18B20_ALARM_LOW_DISABLED;
+        int8_t alarm_high = DS18B20_ALARM_HIGH_DISABLED;
+        ds18b20_get_sensor_alarm(i, &alarm_low, &alarm_high);
+        temp_sensors[i].alarm_low = temp_alarm_centi_degrees(alarm_low, DS18B20_ALARM_LOW_DISABLED);
+        temp_sensors[i].alarm_high = temp_alarm_centi_degrees(alarm_high, DS18B20_ALARM_HIGH_DISABLED);
+        temp_sensors[i].alarm_enabled = alarm_low != DS18B20_ALARM_LOW_DISABLED || alarm_high != DS18B20_ALARM_HIGH_DISABLED;
+
+        resolution_policy_init(&temp_sensors[i].resolution_policy);
+        sample_filter_init(&temp_sensors[i].filter);
+        report_filter_init(&temp_sensors[i].report_filter);
+        window_stats_init(&temp_sensors[i].stats, temp_stats_windows_s, TEMP_STATS_WINDOW_NUM);
+        temp_sensors[i].report_config = (report_filter_config_t)REPORT_FILTER_DEFAULT_CONFIG();
+        ESP_RETURN_ON_ERROR(sample_history_init(&temp_sensors[i].history, history_capacity), TAG,
+                            "Failed to allocate the history of sensor %d", i + 1);
+    }
+    sample_queue_init(&temp_sample_queue);
+#if ESP_TEMP_AGGREGATE_REPORT
+    for (int i = 0; i < DS18B20_MAX_SENSORS; i++) {
+        temp_aggregate_values[i] = AGGREGATE_FRAME_INVALID;
+    }
+#endif
+    ESP_LOGI(TAG, "Application state uses %u bytes (%u per sensor)",
+             (unsigned)(temp_sensor_num * sizeof(temp_sensor_state_t)), (unsigned)sizeof(temp_sensor_state_t));
+    ESP_LOGI(TAG, "Offline history: %u samples per sensor every %d s (%u min), %u bytes",
+             history_capacity, SAMPLE_HISTORY_INTERVAL_S, (unsigned)(history_capacity * SAMPLE_HISTORY_INTERVAL_S / 60),
+             (unsigned)(temp_sensor_num * history_capacity * sizeof(history_sample_t)));
+    return ESP_OK;
+}
+
+esp_err_t sensor_app_init(const sensor_app_platform_t *platform) {
+    temp_platform = platform;
+    ESP_RETURN_ON_ERROR(temp_sensors_create(), TAG, "Failed to create the sensor state");
+    temp_rejoin_cache_load();
+    return ESP_OK;
+}
+
+int sensor_app_get_sensor_count(void) {
+    return temp_sensor_num;
+}
+
+void sensor_app_get_alarm(int index, int16_t *low, int16_t *high) {
+    *low = temp_sensors[index].alarm_low;
+    *high = temp_sensors[index].alarm_high;
+}
+
+static const sensor_sampler_ops_t temp_sensor_sampler_ops = {
+    .trigger = temp_sensor_trigger,
+    .conversion_time_ms = ds18b20_get_conversion_time_ms,
+    .sensor_count = temp_sensor_count,
+    .read = ds18b20_read_conversion_result,
+    .publish = temp_sensor_sample_publish,
+    .prepare = temp_sensor_alarm_search,
+    .skip = temp_sensor_skip,
+};
+
+static sensor_sampler_t temp_sensor_sampler;
+static bool temp_sampling_started = false;
+
+// Sampling schedule, decided in the Zigbee task and applied by the sampler in the timer task
+static atomic_uint temp_sampling_period_ms = ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS;
+static atomic_bool temp_sampling_requested = false;
+static atomic_bool temp_sampling_realign = false;  // The network time model or the period changed
+static uint32_t temp_sampling_requested_ms = 0;
+static uint32_t temp_sensor_rescan_at_ms = 0;
+static bool temp_sensor_rescanning = false;  // A re-scan is between two of its steps
+static bool temp_alarm_applying = false;     // Thresholds are left to write
+
+uint32_t sensor_app_sampler_step(void) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (atomic_exchange(&temp_sample_drain_retry, false)) {
+        temp_sample_drain_request();
+    }
+    // An EEPROM write is in progress, the buses stay untouched until it is done
+    uint32_t bus_wait_ms = ds18b20_get_bus_wait_ms();
+    if (bus_wait_ms > 0) {
+        return bus_wait_ms;
+    }
+    sensor_sampler_set_period(&temp_sensor_sampler, atomic_load(&temp_sampling_period_ms));
+    if (atomic_exchange(&temp_sampling_requested, false)) {
+        sensor_sampler_request(&temp_sensor_sampler, now_ms);
+        temp_cycle_slotted = false;  // On demand, off the grid
+    }
+    uint32_t cycles = temp_sensor_sampler.cycles;
+    uint32_t delay_ms = sensor_sampler_step(&temp_sensor_sampler, now_ms);
+    bool cycle_done = temp_sensor_sampler.cycles != cycles;
+    if (cycle_done) {
+        latency_stats_since(LATENCY_PHASE_CYCLE, temp_cycle_started_us);
+    }
+
+    // Once the network time is known the next cycle starts on a slot of the network time grid instead of a period
+    // after the last one, every node with the same period samples at the same instants and the local clock drift
+    // does not add up
+    bool idle = temp_sensor_sampler.state == SENSOR_SAMPLER_STATE_IDLE;
+    bool bus_used = false;
+    time_sync_model_t time_model;
+    if (idle && (cycle_done || atomic_load(&temp_sampling_realign)) && temp_time_model_load(&time_model)) {
+        atomic_store(&temp_sampling_realign, false);
+        // Half a period after a cycle start is the slot nearest to one period later, a cycle that started
+        // just before its slot does not get the same slot again
+        uint32_t period_ms = temp_sensor_sampler.period_ms;
+        int64_t after_us = cycle_done ? temp_cycle_started_us + (int64_t)period_ms * 500 : esp_timer_get_time();
+        int64_t slot_us = time_sync_next_slot_us(&time_model, after_us, period_ms, ESP_TEMP_SAMPLE_PHASE_MS);
+        sensor_sampler_set_next_cycle(&temp_sensor_sampler, (uint32_t)(slot_us / 1000));
+        temp_cycle_slotted = true;
+        temp_cycle_slot_period_ms = period_ms;
+        now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        delay_ms = sensor_sampler_step(&temp_sensor_sampler, now_ms);
+    }
+
+    // The bus is free between cycles, quarantined and hot-plugged probes are looked for there
+    // and new alarm thresholds are written to the EEPROMs. One bounded step per callback, the
+    // EEPROM write of a step is waited for by the next callback
+    if (idle && atomic_exchange(&temp_alarm_config_pending, false)) {
+        temp_alarm_apply_next = 0;
+        temp_alarm_applying = true;
+    }
+    if (idle && temp_alarm_applying) {
+        temp_alarm_applying = temp_sensor_alarm_apply();
+        bus_used = true;
+    } else if (idle && (temp_sensor_rescanning || (int32_t)(now_ms - temp_sensor_rescan_at_ms) >= 0)) {
+        // One step per callback, a cycle that becomes due runs between the steps
+        temp_sensor_rescanning = ds18b20_rescan_step();
+        if (!temp_sensor_rescanning) {
+            temp_sensor_rescan_at_ms = now_ms + ESP_TEMP_SENSOR_RESCAN_PERIOD_MS;
+        }
+        bus_used = true;
+    }
+    if (bus_used) {
+        delay_ms = ds18b20_get_bus_wait_ms();  // The sampler is stepped again once the bus is free
+    }
+
+    if (atomic_load(&temp_sample_drain_retry) && delay_ms > TEMP_SAMPLE_DRAIN_RETRY_MS) {
+        delay_ms = TEMP_SAMPLE_DRAIN_RETRY_MS;
+    }
+#if ESP_TEMP_SLEEPY_END_DEVICE
+    // Without the RMT lock of the buses the chip can light sleep until the next cycle. The conversion wait is
+    // too short to be worth the heap churn of creating the buses again, the buses stay while the cycle runs
+    if (temp_sensor_sampler.state == SENSOR_SAMPLER_STATE_IDLE && delay_ms >= ESP_TEMP_BUS_RELEASE_IDLE_MS) {
+        ds18b20_release_buses();
+    }
+#endif
+
+    return delay_ms;
+}
+
+// Step the sampler right away so a new period or an on-demand request takes effect, safe from the Zigbee task
+static void temp_sensor_sampler_wake(void) {
+    if (temp_sampling_started) {
+        temp_platform->sampler_wake();
+    }
+}
+
+static uint32_t temp_clamp_period_ms(uint32_t period_ms) {
+    if (period_ms < ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS) {
+        return ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS;
+    }
+    return period_ms > ESP_TEMP_SENSOR_IDLE_SAMPLE_PERIOD_MS ? ESP_TEMP_SENSOR_IDLE_SAMPLE_PERIOD_MS : period_ms;
+}
+
+// True if the coordinator configured reporting for any window statistics attribute of a sensor
+static bool temp_sensor_stats_subscribed(int index) {
+    for (int window = 0; window < TEMP_STATS_WINDOW_NUM; window++) {
+        for (int field = CUSTOM_TEMP_STATS_MIN; field <= CUSTOM_TEMP_STATS_COUNT; field++) {
+            zigbee_hal_reporting_t reporting;
+            if (zigbee_hal_get_manufacturer_reporting(HA_ESP_SENSOR_ENDPOINT + index, CUSTOM_TEMP_STATS_ATTR_ID(window, field), &reporting)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Derive the sampling period from what is consumed: the report filter of each endpoint follows its reporting
+// configuration, and the node samples no faster than the shortest minimum reporting interval
+static void temp_sampling_schedule_update(void) {
+    uint32_t period_ms = UINT32_MAX;
+    for (int i = 0; i < temp_sensor_num; i++) {
+        temp_sensor_state_t *sensor = &temp_sensors[i];
+        zigbee_hal_reporting_t reporting;
+#if ESP_TEMP_AGGREGATE_REPORT
+        // Every sensor follows the reporting configuration of the aggregate attribute
+        bool configured = zigbee_hal_get_manufacturer_reporting(HA_ESP_SENSOR_ENDPOINT, CUSTOM_TEMP_AGGREGATE_ATTRIBUTE_ID, &reporting);
+#else
+        bool configured = zigbee_hal_get_temperature_reporting(HA_ESP_SENSOR_ENDPOINT + i, &reporting);
+#endif
+        if (configured) {
+            uint16_t max_interval = reporting.max_interval_s;
+            sensor->report_config.min_interval_ms = reporting.min_interval_s * 1000;
+            sensor->report_config.max_interval_ms = max_interval == 0xFFFF ? 0 : max_interval * 1000;  // 0 and 0xFFFF: no periodic report
+#if !ESP_TEMP_AGGREGATE_REPORT
+            // An octet string has no reportable change, the aggregate keeps the default deadband
+            sensor->report_config.deadband = reporting.delta > 0 ? reporting.delta : 0;
+#endif
+        }
+
+        uint32_t sensor_period_ms = UINT32_MAX;
+        if (sensor->sample_period_s > 0) {
+            sensor_period_ms = temp_clamp_period_ms(sensor->sample_period_s * 1000);
+        } else if (configured) {
+            sensor_period_ms = temp_clamp_period_ms(reporting.min_interval_s * 1000);
+        } else if (temp_sensor_stats_subscribed(i)) {
+            sensor_period_ms = ESP_TEMP_STATS_SAMPLE_PERIOD_MS;  // Only the window statistics consume samples
+        }
+        if (sensor_period_ms < period_ms) {
+            period_ms = sensor_period_ms;
+        }
+    }
+
+    if (!temp_network_joined) {
+        period_ms = SAMPLE_HISTORY_INTERVAL_S * 1000;  // Only the offline history consumes samples
+    } else if (period_ms == UINT32_MAX) {
+        period_ms = ESP_TEMP_SENSOR_IDLE_SAMPLE_PERIOD_MS;  // Nobody subscribed, Read Attributes sample on demand
+    }
+
+    if (atomic_exchange(&temp_sampling_period_ms, period_ms) != period_ms) {
+        ESP_LOGI(TAG, "Sampling every %lu s", (unsigned long)(period_ms / 1000));
+        atomic_store(&temp_sampling_realign, true);
+        temp_sensor_sampler_wake();
+    }
+}
+
+static void temp_sampling_schedule_cb(uint8_t param) {
+    temp_sampling_schedule_update();
+}
+
+void sensor_app_reporting_configured(void) {
+    zigbee_hal_schedule(temp_sampling_schedule_cb, 0, TEMP_SAMPLING_SCHEDULE_DELAY_MS);
+}
+
+void sensor_app_read_requested(void) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (now_ms - temp_sampling_requested_ms >= ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS) {
+        temp_sampling_requested_ms = now_ms;
+        atomic_store(&temp_sampling_requested, true);
+        temp_sensor_sampler_wake();
+    }
+}
+
+void sensor_app_time_response(uint32_t network_s) {
+    if (!temp_time_request_pending) {
+        return;
+    }
+    int64_t response_us = esp_timer_get_time();
+    temp_time_request_pending = false;
+    if (network_s == 0 || network_s == CUSTOM_TEMP_TIMESTAMP_INVALID) {
+        return;  // The coordinator does not know the time either
+    }
+
+    bool was_valid = temp_time_sync.model.valid;
+    uint32_t steps = temp_time_sync.steps;
+    time_sync_update(&temp_time_sync, temp_time_request_us, response_us, network_s);
+    temp_time_model_publish(&temp_time_sync.model);
+    if (!was_valid || temp_time_sync.steps != steps) {
+        ESP_LOGI(TAG, "Network time %s: %lu s since 2000, sampling on the grid", was_valid ? "stepped" : "synced",
+                 (unsigned long)network_s);
+        atomic_store(&temp_sampling_realign, true);
+        temp_sensor_sampler_wake();
+    }
+}
+
+void sensor_app_attr_written(uint8_t endpoint, uint16_t attr_id, const void *value) {
+    int index = endpoint - HA_ESP_SENSOR_ENDPOINT;
+    if (index < 0 || index >= temp_sensor_num || value == NULL) {
+        return;
+    }
+
+    switch (attr_id) {
+    case CUSTOM_TEMP_SAMPLE_PERIOD_ATTRIBUTE_ID:
+        temp_sensors[index].sample_period_s = *(const uint16_t *)value;
+        temp_sampling_schedule_update();
+        break;
+    case CUSTOM_TEMP_ALARM_LOW_ATTRIBUTE_ID:
+    case CUSTOM_TEMP_ALARM_HIGH_ATTRIBUTE_ID: {
+        int16_t alarm = *(const int16_t *)value;
+        if (attr_id == CUSTOM_TEMP_ALARM_LOW_ATTRIBUTE_ID) {
+            temp_sensors[index].alarm_low = alarm;
+        } else {
+            temp_sensors[index].alarm_high = alarm;
+        }
+        atomic_store(&temp_alarm_config_pending, true);  // The EEPROM write needs the bus, the sampler does it
+        temp_sensor_sampler_wake();
+        break;
+    }
+    case CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID:
+        // Printing the ring takes hundreds of milliseconds on the UART, not something for the Zigbee task
+        if (index == 0 && *(const uint8_t *)value != 0) {
+            temp_platform->trace_dump();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Copies the latency histograms into the manufacturer specific attributes of the Diagnostics cluster,
+// and the 1-Wire error counters of every sensor into its Temperature Measurement cluster
+static void temp_diagnostics_update_cb(uint8_t param) {
+    for (int i = 0; i < temp_sensor_num; i++) {
+        ds18b20_sensor_stats_t stats;
+        if (ds18b20_get_sensor_stats(i, &stats) != ESP_OK) {
+            continue;
+        }
+        uint32_t bus_stats[CUSTOM_TEMP_BUS_STATS_NUM] = {
+            [CUSTOM_TEMP_BUS_STATS_READS] = stats.reads,
+            [CUSTOM_TEMP_BUS_STATS_CRC_ERRORS] = stats.crc_errors,
+            [CUSTOM_TEMP_BUS_STATS_BUS_ERRORS] = stats.bus_errors,
+            [CUSTOM_TEMP_BUS_STATS_POWER_ON] = stats.power_on_values,
+            [CUSTOM_TEMP_BUS_STATS_RETRIES] = stats.retries,
+            [CUSTOM_TEMP_BUS_STATS_QUARANTINES] = stats.quarantines,
+        };
+        for (int field = 0; field < CUSTOM_TEMP_BUS_STATS_NUM; field++) {
+            zigbee_hal_set_manufacturer_attr(HA_ESP_SENSOR_ENDPOINT + i, CUSTOM_TEMP_BUS_STATS_ATTR_ID(field), &bus_stats[field]);
+        }
+    }
+    for (int phase = 0; phase < LATENCY_PHASE_NUM; phase++) {
+        latency_histogram_t histogram;
+        latency_stats_get(phase, &histogram);
+        uint32_t mean_us = histogram.count > 0 ? (uint32_t)(histogram.total_us / histogram.count) : 0;
+
+        // ZCL octet string: length byte followed by the bucket counts (u16, little endian)
+        uint8_t buckets_attr[1 + LATENCY_HISTOGRAM_BUCKETS * 2] = {LATENCY_HISTOGRAM_BUCKETS * 2};
+        for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+            buckets_attr[1 + i * 2] = histogram.buckets[i] & 0xFF;
+            buckets_attr[2 + i * 2] = histogram.buckets[i] >> 8;
+        }
+
+        uint16_t attr_id = CUSTOM_DIAG_LATENCY_ATTR_ID(phase, 0);
+        zigbee_hal_set_diagnostics_attr(HA_ESP_SENSOR_ENDPOINT, attr_id + CUSTOM_DIAG_LATENCY_COUNT, &histogram.count);
+        zigbee_hal_set_diagnostics_attr(HA_ESP_SENSOR_ENDPOINT, attr_id + CUSTOM_DIAG_LATENCY_MEAN, &mean_us);
+        zigbee_hal_set_diagnostics_attr(HA_ESP_SENSOR_ENDPOINT, attr_id + CUSTOM_DIAG_LATENCY_MAX, &histogram.max_us);
+        zigbee_hal_set_diagnostics_attr(HA_ESP_SENSOR_ENDPOINT, attr_id + CUSTOM_DIAG_LATENCY_BUCKETS, buckets_attr);
+    }
+    for (int counter = 0; counter < LATENCY_COUNTER_NUM; counter++) {
+        uint32_t value = latency_stats_get_counter(counter);
+        zigbee_hal_set_diagnostics_attr(HA_ESP_SENSOR_ENDPOINT, CUSTOM_DIAG_COUNTER_ATTR_ID(counter), &value);
+    }
+    uint32_t rejoin_metrics[CUSTOM_DIAG_REJOIN_NUM] = {
+        [CUSTOM_DIAG_REJOIN_LAST_MS] = rejoin_policy.last_rejoin_ms,
+        [CUSTOM_DIAG_REJOIN_LAST_ATTEMPTS] = rejoin_policy.last_attempts,
+        [CUSTOM_DIAG_REJOIN_TOTAL_ATTEMPTS] = rejoin_policy.total_attempts,
+        [CUSTOM_DIAG_REJOIN_JOINS] = rejoin_policy.joins,
+    };
+    for (int field = 0; field < CUSTOM_DIAG_REJOIN_NUM; field++) {
+        zigbee_hal_set_diagnostics_attr(HA_ESP_SENSOR_ENDPOINT, CUSTOM_DIAG_REJOIN_ATTR_ID(field), &rejoin_metrics[field]);
+    }
+    uint32_t time_metrics[CUSTOM_DIAG_TIME_NUM] = {
+        [CUSTOM_DIAG_TIME_SYNCS] = temp_time_sync.syncs,
+        [CUSTOM_DIAG_TIME_STEPS] = temp_time_sync.steps,
+        [CUSTOM_DIAG_TIME_UNCERTAINTY_US] = (uint32_t)temp_time_sync.half_width_us,
+        [CUSTOM_DIAG_TIME_SKEW_PPB] = (uint32_t)temp_time_sync.model.skew_ppb,  // s32 attributes, same bits
+        [CUSTOM_DIAG_TIME_CORRECTION_US] = (uint32_t)temp_time_sync.last_correction_us,
+    };
+    for (int field = 0; field < CUSTOM_DIAG_TIME_NUM; field++) {
+        zigbee_hal_set_diagnostics_attr(HA_ESP_SENSOR_ENDPOINT, CUSTOM_DIAG_TIME_ATTR_ID(field), &time_metrics[field]);
+    }
+
+    zigbee_hal_schedule(temp_diagnostics_update_cb, 0, ESP_TEMP_DIAGNOSTICS_PERIOD_MS);
+}
+
+// Stack high-water marks and heap use in the log, the task stacks are sized from these
+static void temp_ram_report_cb(uint8_t param) {
+    ram_budget_report();
+    zigbee_hal_schedule(temp_ram_report_cb, 0, ESP_TEMP_RAM_REPORT_PERIOD_MS);
+}
+
+// Reads the Time attribute of the coordinator, the answer goes to sensor_app_time_response()
+static void temp_time_sync_cb(uint8_t param) {
+    if (temp_network_joined) {
+        temp_time_request_us = esp_timer_get_time();
+        temp_time_request_pending = true;
+        zigbee_hal_read_network_time(HA_ESP_SENSOR_ENDPOINT);
+#if ESP_TEMP_SLEEPY_END_DEVICE
+        // The answer waits at the parent, poll for it now so the round trip, and the uncertainty, stays short
+        zigbee_hal_poll_parent();
+#endif
+    }
+    // A fixed period would read the whole seconds at nearly the same fraction every time, so a reading would only
+    // narrow the model when the fraction wraps, hours apart at a few ppm of skew. The random delay lets every
+    // reading land anywhere in the second
+    uint32_t period_ms = temp_time_sync.model.valid ? ESP_TEMP_TIME_SYNC_PERIOD_MS : ESP_TEMP_TIME_SYNC_RETRY_MS;
+    zigbee_hal_schedule(temp_time_sync_cb, 0, period_ms + esp_random() % ESP_TEMP_TIME_SYNC_DITHER_MS);
+}
+
+// Called from the Zigbee task once the stack is up
+static void temp_sensor_sampling_start(void) {
+    if (temp_sampling_started) {
+        return;
+    }
+    sensor_sampler_init(&temp_sensor_sampler, &temp_sensor_sampler_ops, ESP_TEMP_SENSOR_SAMPLE_PERIOD_MS);
+    temp_sensor_rescan_at_ms = (uint32_t)(esp_timer_get_time() / 1000) + ESP_TEMP_SENSOR_RESCAN_PERIOD_MS;
+    if (!temp_platform->sampler_start()) {
+        ESP_LOGE(TAG, "Failed to start the sampling timer");
+        return;
+    }
+    temp_sampling_started = true;
+    zigbee_hal_schedule(temp_diagnostics_update_cb, 0, ESP_TEMP_DIAGNOSTICS_PERIOD_MS);
+    zigbee_hal_schedule(temp_ram_report_cb, 0, ESP_TEMP_RAM_REPORT_PERIOD_MS);
+    temp_sampling_schedule_update();  // Reporting configurations survive a reboot in the stack
+}
+
+// Sends the stored history one frame at a time through the manufacturer specific history attribute. The next
+// frame goes out once the last one is confirmed, see sensor_app_report_sent()
+static void temp_history_flush_cb(uint8_t param) {
+    temp_history_flush_pending = false;
+    if (!temp_network_joined || temp_history_inflight.active) {
+        return;
+    }
+
+    for (int i = 0; i < temp_sensor_num; i++) {
+        sample_history_t *history = &temp_sensors[i].history;
+        if (sample_history_count(history) == 0) {
+            continue;
+        }
+
+        // ZCL octet string: length byte followed by the frame
+        static uint8_t history_attr[1 + SAMPLE_HISTORY_FRAME_MAX_SIZE];
+        uint32_t now_s = (uint32_t)(esp_timer_get_time() / 1000000);
+        uint8_t *frame = &history_attr[1];
+        history_attr[0] = (uint8_t)sample_history_encode_frame(history, (uint8_t)i, now_s, frame, SAMPLE_HISTORY_FRAME_MAX_SIZE);
+
+        uint8_t tsn;
+        temp_history_flush_pending = true;
+        if (zigbee_hal_report_manufacturer_attr(HA_ESP_SENSOR_ENDPOINT + i, CUSTOM_TEMP_HISTORY_ATTRIBUTE_ID, history_attr, &tsn) != ESP_OK) {
+            ESP_LOGW(TAG, "History frame of sensor %d not sent, retrying", i + 1);
+            zigbee_hal_schedule(temp_history_flush_cb, 0, TEMP_HISTORY_FLUSH_GAP_MS);
+            return;
+        }
+        temp_history_inflight.active = true;
+        temp_history_inflight.tsn = tsn;
+        temp_history_inflight.sensor = i;
+        temp_history_inflight.count = frame[2];  // Sample count of the frame
+        temp_history_inflight.overwritten = history->overwritten;
+        zigbee_hal_schedule(temp_history_confirm_timeout_cb, tsn, TEMP_HISTORY_CONFIRM_TIMEOUT_MS);
+        return;
+    }
+}
+
+// Ends the frame in flight, its samples are dropped only if the coordinator got them
+static void temp_history_confirmed(bool delivered) {
+    temp_history_inflight.active = false;
+    int i = temp_history_inflight.sensor;
+    sample_history_t *history = &temp_sensors[i].history;
+    if (delivered) {
+        // Samples of the frame the full ring overwrote meanwhile are gone already
+        uint32_t lost = history->overwritten - temp_history_inflight.overwritten;
+        if (lost < temp_history_inflight.count) {
+            sample_history_consume(history, temp_history_inflight.count - lost);
+        }
+        ESP_LOGI(TAG, "History frame of sensor %d sent, %u sample(s) left", i + 1, sample_history_count(history));
+    } else {
+        ESP_LOGW(TAG, "History frame of sensor %d not delivered, retrying", i + 1);
+    }
+    zigbee_hal_schedule(temp_history_flush_cb, 0, TEMP_HISTORY_FLUSH_GAP_MS);
+}
+
+static void temp_history_confirm_timeout_cb(uint8_t tsn) {
+    if (temp_history_inflight.active && temp_history_inflight.tsn == tsn) {
+        temp_history_confirmed(false);
+    }
+}
+
+void sensor_app_report_sent(uint8_t tsn, esp_err_t status) {
+    if (temp_history_inflight.active && temp_history_inflight.tsn == tsn) {
+        temp_history_confirmed(status == ESP_OK);
+    }
+}
+
+// Called from the Zigbee task whenever the node is (back) on the network
+static void temp_network_joined_set(bool joined) {
+    temp_network_joined = joined;
+    temp_sampling_schedule_update();
+    if (joined && !temp_time_sync_started) {
+        temp_time_sync_started = true;
+        time_sync_init(&temp_time_sync);
+        zigbee_hal_schedule(temp_time_sync_cb, 0, 0);
+    }
+    if (joined && !temp_history_flush_pending) {
+        temp_history_flush_pending = true;
+        zigbee_hal_schedule(temp_history_flush_cb, 0, TEMP_HISTORY_FLUSH_GAP_MS);
+    }
+}
+
+void sensor_app_stack_started(esp_err_t status, bool factory_new) {
+    // The sensors do not need the stack, samples go to the offline history until the node is on a network
+    temp_sensor_sampling_start();
+    if (status != ESP_OK) {
+        // The initialization is part of the commissioning run, it backs off like a failed steering attempt and
+        // the run goes on with steering (or the rejoin) once it succeeds
+        if (!rejoin_policy.active) {
+            rejoin_policy_attempt(&rejoin_policy, &rejoin_policy_config, (uint32_t)(esp_timer_get_time() / 1000));
+        }
+        uint32_t delay_ms = rejoin_policy_failed(&rejoin_policy, &rejoin_policy_config, esp_random());
+        ESP_LOGW(TAG, "Failed to initialize Zigbee stack (status: %s), retrying in %lu ms", esp_err_to_name(status),
+                 (unsigned long)delay_ms);
+        zigbee_hal_schedule(temp_initialization_attempt_cb, 0, delay_ms);
+        return;
+    }
+    ESP_LOGI(TAG, "Device started up in %s factory-reset mode", factory_new ? "" : "non");
+
+    if (factory_new) {
+        ESP_LOGI(TAG, "Start network steering");
+        temp_commissioning_attempt_cb(0);
+    } else {
+        ESP_LOGI(TAG, "Device rebooted, no factory reset");
+        temp_commissioning_done();
+        temp_network_joined_set(true);
+    }
+}
+
+void sensor_app_steering_done(esp_err_t status) {
+    if (status == ESP_OK) {
+        temp_commissioning_done();
+        temp_network_joined_set(true);
+        return;
+    }
+    // Back off instead of scanning every channel once a second for as long as the coordinator is gone
+    uint32_t delay_ms = rejoin_policy_failed(&rejoin_policy, &rejoin_policy_config, esp_random());
+    ESP_LOGI(TAG, "Network steering failed (status: %s), retrying in %lu ms", esp_err_to_name(status), (unsigned long)delay_ms);
+    temp_network_joined_set(false);
+    zigbee_hal_schedule(temp_commissioning_attempt_cb, 0, delay_ms);
+}
+
+void sensor_app_left(void) {
+    ESP_LOGW(TAG, "Left the network, samples go to the offline history");
+    temp_network_joined_set(false);
+}
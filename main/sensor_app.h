@@ -0,0 +1,62 @@
+// sensor_app.h
+
+#ifndef SENSOR_APP_H
+#define SENSOR_APP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/* Application logic of the node: sampling, filtering, reporting, offline history, alarm thresholds, network time
+ * and commissioning retries. It reaches the sensors through ds18b20_sensor.h and the stack only through
+ * zigbee_hal.h, main.c turns the stack callbacks into the calls below. The host build (host/) runs the same code
+ * against a simulated 1-Wire bus and a fake attribute table.
+ */
+
+// Platform side of the sampler, a one-shot timer that calls sensor_app_sampler_step() outside of the Zigbee task
+typedef struct {
+    bool (*sampler_start)(void);    // Start the timer, the first step runs right away
+    void (*sampler_wake)(void);     // Step the sampler right away, called from the Zigbee task
+    void (*trace_dump)(void);       // Have trace_log_dump() run in a low priority task, called from the Zigbee task
+} sensor_app_platform_t;
+
+// Allocate the per-sensor state for the sensors found by ds18b20_init(), before the stack starts
+esp_err_t sensor_app_init(const sensor_app_platform_t *platform);
+
+// Number of sensors, one endpoint each from HA_ESP_SENSOR_ENDPOINT on
+int sensor_app_get_sensor_count(void);
+
+// Alarm threshold attributes of a sensor at boot (centi-degrees, CUSTOM_TEMP_ALARM_DISABLED if not used)
+void sensor_app_get_alarm(int index, int16_t *low, int16_t *high);
+
+// Run the sampler from the timer, returns the delay in ms until the next step
+uint32_t sensor_app_sampler_step(void);
+
+// Stack callbacks, all from the Zigbee task
+
+// BDB initialization finished (first start or reboot). Sampling starts either way, a failed initialization
+// is repeated with the backoff of the commissioning retries
+void sensor_app_stack_started(esp_err_t status, bool factory_new);
+
+// Network steering finished, joined on ESP_OK
+void sensor_app_steering_done(esp_err_t status);
+
+// The node left the network
+void sensor_app_left(void);
+
+// The coordinator wrote a reporting configuration of the Temperature Measurement cluster
+void sensor_app_reporting_configured(void);
+
+// The coordinator reads the Temperature Measurement cluster, a sample is taken on demand
+void sensor_app_read_requested(void);
+
+// The coordinator wrote an attribute of the Temperature Measurement cluster on endpoint
+void sensor_app_attr_written(uint8_t endpoint, uint16_t attr_id, const void *value);
+
+// APS confirm of a command the node sent, status ESP_OK once the coordinator (or its parent) acknowledged it
+void sensor_app_report_sent(uint8_t tsn, esp_err_t status);
+
+// Answer to zigbee_hal_read_network_time(): the coordinator's Time attribute (UTC, s since 2000)
+void sensor_app_time_response(uint32_t network_s);
+
+#endif // SENSOR_APP_H
@@ -0,0 +1,125 @@
+// sensor_sampler.c
+
+#include <stddef.h>
+#include "sensor_sampler.h"
+
+// Milliseconds from now until deadline, 0 if the deadline already passed (wrap-around safe)
+static uint32_t ms_until(uint32_t now_ms, uint32_t deadline_ms) {
+    int32_t remaining = (int32_t)(deadline_ms - now_ms);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+void sensor_sampler_init(sensor_sampler_t *sampler, const sensor_sampler_ops_t *ops, uint32_t period_ms) {
+    sampler->ops = ops;
+    sampler->period_ms = period_ms;
+    sampler->state = SENSOR_SAMPLER_STATE_TRIGGER;
+    sampler->started = false;
+    sampler->next_cycle_ms = 0;
+    sampler->ready_at_ms = 0;
+    sampler->read_index = 0;
+    sampler->cycles = 0;
+}
+
+// Finish the cycle and schedule the next one on the fixed period grid
+static uint32_t sensor_sampler_end_cycle(sensor_sampler_t *sampler, uint32_t now_ms) {
+    sampler->state = SENSOR_SAMPLER_STATE_IDLE;
+    sampler->cycles++;
+
+    // A cycle that overran by more than one period skips the missed slots instead of bursting
+    if (ms_until(now_ms, sampler->next_cycle_ms) == 0 && now_ms - sampler->next_cycle_ms >= sampler->period_ms) {
+        sampler->next_cycle_ms = now_ms;
+    }
+    return ms_until(now_ms, sampler->next_cycle_ms);
+}
+
+// Move read_index past the sensors the caller leaves out of this cycle
+static void sensor_sampler_next_read(sensor_sampler_t *sampler) {
+    const sensor_sampler_ops_t *ops = sampler->ops;
+    while (ops->skip != NULL && sampler->read_index < ops->sensor_count() && ops->skip(sampler->read_index)) {
+        sampler->read_index++;
+    }
+}
+
+void sensor_sampler_set_period(sensor_sampler_t *sampler, uint32_t period_ms) {
+    if (period_ms == 0 || period_ms == sampler->period_ms) {
+        return;
+    }
+    if (sampler->started) {
+        // next_cycle_ms already holds the start of the running or last cycle + the old period
+        sampler->next_cycle_ms = sampler->next_cycle_ms - sampler->period_ms + period_ms;
+    }
+    sampler->period_ms = period_ms;
+}
+
+void sensor_sampler_set_next_cycle(sensor_sampler_t *sampler, uint32_t next_cycle_ms) {
+    if (sampler->state == SENSOR_SAMPLER_STATE_IDLE) {
+        sampler->next_cycle_ms = next_cycle_ms;
+    }
+}
+
+void sensor_sampler_request(sensor_sampler_t *sampler, uint32_t now_ms) {
+    if (sampler->state == SENSOR_SAMPLER_STATE_IDLE) {
+        sampler->next_cycle_ms = now_ms;
+    }
+}
+
+uint32_t sensor_sampler_step(sensor_sampler_t *sampler, uint32_t now_ms) {
+    const sensor_sampler_ops_t *ops = sampler->ops;
+
+    switch (sampler->state) {
+    case SENSOR_SAMPLER_STATE_IDLE:
+        if (ms_until(now_ms, sampler->next_cycle_ms) > 0) {
+            return ms_until(now_ms, sampler->next_cycle_ms);
+        }
+        sampler->state = SENSOR_SAMPLER_STATE_TRIGGER;
+        // fall through
+
+    case SENSOR_SAMPLER_STATE_TRIGGER: {
+        if (!sampler->started) {
+            sampler->next_cycle_ms = now_ms;
+            sampler->started = true;
+        }
+        sampler->next_cycle_ms += sampler->period_ms;
+
+        esp_err_t err = ops->trigger();
+        if (err != ESP_OK) {
+            int count = ops->sensor_count();
+            for (int i = 0; i < count; i++) {
+                ops->publish(i, err, 0);
+            }
+            return sensor_sampler_end_cycle(sampler, now_ms);
+        }
+        sampler->ready_at_ms = now_ms + ops->conversion_time_ms();
+        sampler->state = SENSOR_SAMPLER_STATE_WAIT;
+        return ms_until(now_ms, sampler->ready_at_ms);
+    }
+
+    case SENSOR_SAMPLER_STATE_WAIT:
+        if (ms_until(now_ms, sampler->ready_at_ms) > 0) {
+            return ms_until(now_ms, sampler->ready_at_ms);
+        }
+        if (ops->prepare != NULL) {
+            ops->prepare();
+        }
+        sampler->read_index = 0;
+        sensor_sampler_next_read(sampler);
+        sampler->state = SENSOR_SAMPLER_STATE_READ;
+        // fall through
+
+    case SENSOR_SAMPLER_STATE_READ:
+    default: {
+        // One sensor per step, the caller gets control back between scratchpad reads
+        if (sampler->read_index < ops->sensor_count()) {
+            int16_t temperature = 0;
+            esp_err_t err = ops->read(sampler->read_index, &temperature);
+            ops->publish(sampler->read_index, err, temperature);
+            sampler->read_index++;
+            sensor_sampler_next_read(sampler);
+        }
+        if (sampler->read_index < ops->sensor_count()) {
+            return 0;
+        }
+        return sensor_sampler_end_cycle(sampler, now_ms);
+    }
+    }
+}
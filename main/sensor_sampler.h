@@ -0,0 +1,55 @@
+// sensor_sampler.h
+
+#ifndef SENSOR_SAMPLER_H
+#define SENSOR_SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// States of one sampling cycle, the sampler never blocks while the sensors convert
+typedef enum {
+    SENSOR_SAMPLER_STATE_IDLE,      // Waiting for the start of the next cycle
+    SENSOR_SAMPLER_STATE_TRIGGER,   // Start the conversion on the bus
+    SENSOR_SAMPLER_STATE_WAIT,      // Conversion running, the bus and the CPU are free
+    SENSOR_SAMPLER_STATE_READ,      // Read back one scratchpad per step
+} sensor_sampler_state_t;
+
+// Bus and reporting operations used by the sampler, replaced by fakes when testing on a host
+typedef struct {
+    esp_err_t (*trigger)(void);
+    uint32_t (*conversion_time_ms)(void);
+    int (*sensor_count)(void);
+    esp_err_t (*read)(int index, int16_t *temperature);         // Temperature in centi-degrees Celsius
+    void (*publish)(int index, esp_err_t err, int16_t temperature);
+    void (*prepare)(void);              // Optional, runs once the conversion is done, before the first read
+    bool (*skip)(int index);            // Optional, true leaves a sensor out of this cycle, it is not published
+} sensor_sampler_ops_t;
+
+typedef struct {
+    const sensor_sampler_ops_t *ops;
+    uint32_t period_ms;
+    sensor_sampler_state_t state;
+    bool started;
+    uint32_t next_cycle_ms;     // Start of the next cycle, advanced by period_ms so the schedule does not drift
+    uint32_t ready_at_ms;       // End of the running conversion
+    int read_index;
+    uint32_t cycles;            // Completed cycles
+} sensor_sampler_t;
+
+// Initialize the sampler, the first cycle starts on the first step
+void sensor_sampler_init(sensor_sampler_t *sampler, const sensor_sampler_ops_t *ops, uint32_t period_ms);
+
+// Change the period, a waiting cycle is moved to the new grid (last cycle start + period_ms)
+void sensor_sampler_set_period(sensor_sampler_t *sampler, uint32_t period_ms);
+
+// Move a waiting cycle to next_cycle_ms (e.g. a slot of an absolute time grid), the period spaces the cycles after it
+void sensor_sampler_set_next_cycle(sensor_sampler_t *sampler, uint32_t next_cycle_ms);
+
+// Start a cycle on the next step unless one is running, the period grid restarts from now_ms
+void sensor_sampler_request(sensor_sampler_t *sampler, uint32_t now_ms);
+
+// Run the sampler at time now_ms and return the delay in ms until it must be stepped again
+uint32_t sensor_sampler_step(sensor_sampler_t *sampler, uint32_t now_ms);
+
+#endif // SENSOR_SAMPLER_H
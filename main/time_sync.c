@@ -0,0 +1,138 @@
+// time_sync.c
+
+#include "time_sync.h"
+
+void time_sync_init(time_sync_t *sync) {
+    sync->model = (time_sync_model_t){.valid = false};
+    sync->half_width_us = 0;
+    sync->skew_known = false;
+    sync->skew_start_us = 0;
+    sync->skew_window = (time_sync_window_t){0};
+    sync->skew_previous = (time_sync_window_t){0};
+    sync->syncs = 0;
+    sync->steps = 0;
+    sync->last_correction_us = 0;
+}
+
+int64_t time_sync_to_network_us(const time_sync_model_t *model, int64_t local_us) {
+    int64_t elapsed_us = local_us - model->anchor_local_us;
+    return model->anchor_network_us + elapsed_us + elapsed_us * model->skew_ppb / 1000000000;
+}
+
+int64_t time_sync_to_local_us(const time_sync_model_t *model, int64_t network_us) {
+    // elapsed_network / (1 + skew) written as elapsed_network - elapsed_network * skew / (1 + skew), no overflow
+    int64_t elapsed_us = network_us - model->anchor_network_us;
+    return model->anchor_local_us + elapsed_us - elapsed_us * model->skew_ppb / (1000000000 + model->skew_ppb);
+}
+
+// Start over from one reading, the skew is estimated again from scratch
+static void time_sync_restart(time_sync_t *sync, int64_t response_us, int64_t lower_us, int64_t upper_us) {
+    sync->model.valid = true;
+    sync->model.anchor_local_us = response_us;
+    sync->model.anchor_network_us = lower_us + (upper_us - lower_us) / 2;
+    sync->model.skew_ppb = 0;
+    sync->half_width_us = (upper_us - lower_us) / 2;
+    sync->skew_known = false;
+    sync->skew_start_us = response_us;
+    sync->skew_window = (time_sync_window_t){0};
+    sync->skew_previous = (time_sync_window_t){0};
+}
+
+// Add the midpoint of a reading to the skew window, and update the skew from the last two completed windows
+static void time_sync_skew_update(time_sync_t *sync, int64_t response_us, int64_t midpoint_us) {
+    time_sync_window_t *window = &sync->skew_window;
+    window->count++;
+    window->local_sum_us += response_us;
+    window->offset_sum_us += midpoint_us - response_us;
+    if (response_us - sync->skew_start_us < TIME_SYNC_SKEW_WINDOW_US) {
+        return;
+    }
+
+    const time_sync_window_t *previous = &sync->skew_previous;
+    if (previous->count > 0) {
+        int64_t local_span_us = window->local_sum_us / window->count - previous->local_sum_us / previous->count;
+        int64_t offset_change_us = window->offset_sum_us / window->count - previous->offset_sum_us / previous->count;
+        int64_t skew_ppb = local_span_us > 0 ? offset_change_us * 1000000000 / local_span_us : 0;
+        if (skew_ppb > TIME_SYNC_MAX_SKEW_PPB) {
+            skew_ppb = TIME_SYNC_MAX_SKEW_PPB;
+        } else if (skew_ppb < -TIME_SYNC_MAX_SKEW_PPB) {
+            skew_ppb = -TIME_SYNC_MAX_SKEW_PPB;
+        }
+        sync->model.skew_ppb = (int32_t)skew_ppb;
+        sync->skew_known = true;
+    }
+    sync->skew_previous = *window;
+    sync->skew_window = (time_sync_window_t){0};
+    sync->skew_start_us = response_us;
+}
+
+void time_sync_update(time_sync_t *sync, int64_t request_us, int64_t response_us, uint32_t network_s) {
+    if (response_us < request_us) {
+        return;
+    }
+    // The attribute was read somewhere between request and response and truncated to the second
+    int64_t lower_us = (int64_t)network_s * 1000000;
+    int64_t upper_us = lower_us + 1000000 + (response_us - request_us);
+    sync->syncs++;
+
+    if (!sync->model.valid) {
+        time_sync_restart(sync, response_us, lower_us, upper_us);
+        time_sync_skew_update(sync, response_us, lower_us + (upper_us - lower_us) / 2);
+        sync->last_correction_us = 0;
+        return;
+    }
+
+    int64_t predicted_us = time_sync_to_network_us(&sync->model, response_us);
+    int64_t allowance_ppm = sync->skew_known ? TIME_SYNC_RESIDUAL_DRIFT_PPM : TIME_SYNC_DRIFT_ALLOWANCE_PPM;
+    int64_t half_width_us = sync->half_width_us + (response_us - sync->model.anchor_local_us) * allowance_ppm / 1000000;
+    int64_t low_us = predicted_us - half_width_us > lower_us ? predicted_us - half_width_us : lower_us;
+    int64_t high_us = predicted_us + half_width_us < upper_us ? predicted_us + half_width_us : upper_us;
+
+    if (high_us - low_us < -TIME_SYNC_STEP_US) {
+        // Far outside of the model: the coordinator's clock was set
+        int64_t correction_us = lower_us + (upper_us - lower_us) / 2 - predicted_us;
+        sync->last_correction_us = correction_us > INT32_MAX ? INT32_MAX : (correction_us < INT32_MIN ? INT32_MIN : (int32_t)correction_us);
+        sync->steps++;
+        time_sync_restart(sync, response_us, lower_us, upper_us);
+        time_sync_skew_update(sync, response_us, lower_us + (upper_us - lower_us) / 2);
+        return;
+    }
+    if (low_us > high_us) {
+        // Drift beyond the allowance, keep the width at the edge of the reading closest to the model
+        if (predicted_us < lower_us) {
+            low_us = lower_us;
+            high_us = lower_us + 2 * half_width_us < upper_us ? lower_us + 2 * half_width_us : upper_us;
+        } else {
+            high_us = upper_us;
+            low_us = upper_us - 2 * half_width_us > lower_us ? upper_us - 2 * half_width_us : lower_us;
+        }
+    }
+
+    int64_t estimate_us = low_us + (high_us - low_us) / 2;
+    sync->last_correction_us = (int32_t)(estimate_us - predicted_us);
+    sync->model.anchor_local_us = response_us;
+    sync->model.anchor_network_us = estimate_us;
+    sync->half_width_us = (high_us - low_us) / 2;
+    time_sync_skew_update(sync, response_us, lower_us + (upper_us - lower_us) / 2);
+}
+
+// Floor division for a possibly negative dividend
+static int64_t time_sync_floor_div(int64_t dividend, int64_t divisor) {
+    int64_t quotient = dividend / divisor;
+    return (dividend % divisor != 0 && dividend < 0) ? quotient - 1 : quotient;
+}
+
+int64_t time_sync_next_slot_us(const time_sync_model_t *model, int64_t after_local_us, uint32_t period_ms, uint32_t phase_ms) {
+    int64_t period_us = (int64_t)period_ms * 1000;
+    int64_t phase_us = (int64_t)phase_ms * 1000;
+    int64_t network_us = time_sync_to_network_us(model, after_local_us);
+    int64_t slot = time_sync_floor_div(network_us - phase_us, period_us) + 1;
+    return time_sync_to_local_us(model, slot * period_us + phase_us);
+}
+
+int32_t time_sync_slot_error_us(const time_sync_model_t *model, int64_t local_us, uint32_t period_ms, uint32_t phase_ms) {
+    int64_t period_us = (int64_t)period_ms * 1000;
+    int64_t offset_us = time_sync_to_network_us(model, local_us) - (int64_t)phase_ms * 1000;
+    int64_t error_us = offset_us - time_sync_floor_div(offset_us, period_us) * period_us;  // 0..period
+    return (int32_t)(error_us > period_us / 2 ? error_us - period_us : error_us);
+}
@@ -0,0 +1,74 @@
+// time_sync.h
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Network time from the coordinator's ZCL Time attribute (whole seconds since 2000-01-01 UTC).
+ *
+ * A reading only says that the network time at the response lies in [time, time + 1 s + round trip].
+ * The model keeps the interval the network time must be in, widened by the drift allowance for the time
+ * since the last reading, and intersects it with every new reading. The interval settles where the widening
+ * and the narrowing balance, about sqrt(2 * allowance * sync period): ~80 ms at 10 ppm and 5 min.
+ * A reading just outside of the interval is drift beyond the allowance, the interval moves to the edge of
+ * the reading. A reading more than TIME_SYNC_STEP_US outside means the coordinator's clock was set, the
+ * model starts over from it.
+ *
+ * The skew of the local clock comes from the mean offset (midpoint of the reading - local time) of two
+ * consecutive TIME_SYNC_SKEW_WINDOW_US windows, which averages out the one second resolution. A coordinator
+ * that rounds instead of truncating shifts the grid of every node by the same half second.
+ */
+#define TIME_SYNC_DRIFT_ALLOWANCE_PPM   100                     // Rate error between two readings until the skew is known
+#define TIME_SYNC_RESIDUAL_DRIFT_PPM    10                      // Rate error left once the skew is corrected
+#define TIME_SYNC_SKEW_WINDOW_US        (6 * 3600LL * 1000000)  // Averaging window of the skew estimate
+#define TIME_SYNC_MAX_SKEW_PPB          500000                  // Bound of the skew estimate (500 ppm)
+#define TIME_SYNC_STEP_US               (2LL * 1000000)         // A reading further outside means the clock was set
+
+// Mapping from the local clock (esp_timer microseconds) to network time (microseconds since 2000-01-01)
+typedef struct {
+    bool valid;
+    int64_t anchor_local_us;
+    int64_t anchor_network_us;
+    int32_t skew_ppb;           // Network clock rate minus local clock rate, parts per billion
+} time_sync_model_t;
+
+// Readings of one skew window, summed
+typedef struct {
+    uint32_t count;
+    int64_t local_sum_us;
+    int64_t offset_sum_us;      // Network time (midpoint of the reading) - local time
+} time_sync_window_t;
+
+typedef struct {
+    time_sync_model_t model;
+    int64_t half_width_us;      // Uncertainty of the model at anchor_local_us
+    bool skew_known;
+    int64_t skew_start_us;      // Local start of the running skew window
+    time_sync_window_t skew_window;
+    time_sync_window_t skew_previous;   // Empty until one window was completed
+    // Metrics
+    uint32_t syncs;             // Readings used
+    uint32_t steps;             // Readings that contradicted the model, the coordinator's clock was set
+    int32_t last_correction_us; // Correction made by the last reading
+} time_sync_t;
+
+void time_sync_init(time_sync_t *sync);
+
+// One reading of the Time attribute, requested at request_us and answered at response_us (local clock)
+void time_sync_update(time_sync_t *sync, int64_t request_us, int64_t response_us, uint32_t network_s);
+
+int64_t time_sync_to_network_us(const time_sync_model_t *model, int64_t local_us);
+
+int64_t time_sync_to_local_us(const time_sync_model_t *model, int64_t network_us);
+
+/* Local time of the first slot of the network time grid after after_local_us. Slots are every period_ms
+ * from the epoch, shifted by phase_ms, so every node with the same period samples at the same instants.
+ */
+int64_t time_sync_next_slot_us(const time_sync_model_t *model, int64_t after_local_us, uint32_t period_ms, uint32_t phase_ms);
+
+// Signed distance in microseconds from local_us to the nearest slot of the grid, positive when after it
+int32_t time_sync_slot_error_us(const time_sync_model_t *model, int64_t local_us, uint32_t period_ms, uint32_t phase_ms);
+
+#endif // TIME_SYNC_H
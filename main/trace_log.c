@@ -0,0 +1,61 @@
+// trace_log.c
+
+#include <stdatomic.h>
+#include "trace_log.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+_Static_assert((TRACE_LOG_CAPACITY & (TRACE_LOG_CAPACITY - 1)) == 0, "TRACE_LOG_CAPACITY must be a power of two");
+_Static_assert(sizeof(trace_record_t) == 8, "The decoder expects 8 byte records");
+
+#define TRACE_DUMP_RECORDS_PER_LINE 8
+
+static trace_record_t trace_ring[TRACE_LOG_CAPACITY];
+static atomic_uint trace_head = 0;  // Records written since boot
+
+static const char *TAG = "TRACE";
+
+#if TRACE_LOG_ECHO
+static void trace_log_echo(const trace_record_t *record) {
+    ESP_LOGI(TAG, "event %u sensor %u value %d", record->event, record->sensor, record->value);
+}
+#endif
+
+void trace_log_write(trace_event_t event, uint8_t sensor, int16_t value) {
+    // The timer task and the Zigbee task both write, each claims its own slot
+    unsigned slot = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+    trace_record_t *record = &trace_ring[slot & (TRACE_LOG_CAPACITY - 1)];
+    record->time = (uint32_t)(esp_timer_get_time() >> 10);  // Shift instead of a 64-bit division
+    record->event = event;
+    record->sensor = sensor;
+    record->value = value;
+#if TRACE_LOG_ECHO
+    trace_log_echo(record);
+#endif
+}
+
+void trace_log_dump(void) {
+    unsigned head = atomic_load(&trace_head);
+    unsigned count = head < TRACE_LOG_CAPACITY ? head : TRACE_LOG_CAPACITY;
+    static const char hex[] = "0123456789abcdef";
+    char line[TRACE_DUMP_RECORDS_PER_LINE * (2 * sizeof(trace_record_t) + 1)];
+
+    // Records written while dumping may show up torn, the decoder skips unknown tags
+    ESP_LOGI(TAG, "TRACE BEGIN %d %u", TRACE_LOG_VERSION, head - count);
+    char *out = line;
+    for (unsigned i = 0; i < count; i++) {
+        const uint8_t *bytes = (const uint8_t *)&trace_ring[(head - count + i) & (TRACE_LOG_CAPACITY - 1)];
+        for (int b = 0; b < (int)sizeof(trace_record_t); b++) {
+            *out++ = hex[bytes[b] >> 4];
+            *out++ = hex[bytes[b] & 0x0F];
+        }
+        if ((i + 1) % TRACE_DUMP_RECORDS_PER_LINE == 0 || i + 1 == count) {
+            *out = '\0';
+            ESP_LOGI(TAG, "%s", line);
+            out = line;
+        } else {
+            *out++ = ' ';
+        }
+    }
+    ESP_LOGI(TAG, "TRACE END");
+}
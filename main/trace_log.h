@@ -0,0 +1,43 @@
+// trace_log.h
+
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+#include <stdint.h>
+
+/* Binary event log for the sampling hot path. A record is written with a few stores into a fixed ring,
+ * no formatting and no UART. trace_log_dump() logs the ring as hex and tools/trace_decode.py turns
+ * it back into text on the host. Set TRACE_LOG_ECHO to 1 to also print every record as it is written.
+ */
+#ifndef TRACE_LOG_ECHO
+#define TRACE_LOG_ECHO          0
+#endif
+
+#define TRACE_LOG_CAPACITY      256     // Records, a power of two (2 KiB)
+#define TRACE_LOG_VERSION       1
+
+// Record tags, keep tools/trace_decode.py in sync
+typedef enum {
+    TRACE_EVENT_SAMPLE = 1,     // value: centi-degrees read from the sensor
+    TRACE_EVENT_READ_ERROR,     // value: esp_err_t of the failed read
+    TRACE_EVENT_REPORT,         // value: centi-degrees written to the attribute
+    TRACE_EVENT_RESOLUTION,     // value: new resolution in bits
+    TRACE_EVENT_QUEUE_DROP,     // value: samples dropped so far (saturated)
+    TRACE_EVENT_OUTLIER,        // value: centi-degrees rejected by the sample filter
+} trace_event_t;
+
+typedef struct {
+    uint32_t time;              // esp_timer microseconds >> 10, i.e. units of 1.024 ms
+    uint8_t event;
+    uint8_t sensor;             // Registry index
+    int16_t value;
+} trace_record_t;
+
+// Append one record, safe from any task, the oldest record is overwritten when the ring is full
+void trace_log_write(trace_event_t event, uint8_t sensor, int16_t value);
+
+// Log the ring (ESP_LOGI, tag TRACE) between "TRACE BEGIN" and "TRACE END" lines for tools/trace_decode.py.
+// Slow on the UART, main.c runs it in a task of its own when CUSTOM_TEMP_TRACE_DUMP_ATTRIBUTE_ID is written
+void trace_log_dump(void);
+
+#endif // TRACE_LOG_H
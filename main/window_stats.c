@@ -0,0 +1,101 @@
+// window_stats.c
+
+#include "window_stats.h"
+
+static void window_stats_start(window_stats_window_t *window, uint32_t now_ms) {
+    window->start_ms = now_ms - now_ms % window->length_ms;
+    window->count = 0;
+    window->sum = 0;
+    window->sum_sq = 0;
+}
+
+void window_stats_init(window_stats_t *stats, const uint32_t *lengths_s, int num) {
+    stats->num = num > WINDOW_STATS_MAX_WINDOWS ? WINDOW_STATS_MAX_WINDOWS : (uint8_t)num;
+    stats->started = false;
+    for (int i = 0; i < stats->num; i++) {
+        stats->windows[i].length_ms = lengths_s[i] > 0 ? lengths_s[i] * 1000 : 1000;
+        window_stats_start(&stats->windows[i], 0);
+    }
+}
+
+// Division rounded to nearest, for either sign of the dividend
+static int64_t window_stats_div_round(int64_t dividend, int64_t divisor) {
+    return dividend >= 0 ? (dividend + divisor / 2) / divisor : (dividend - divisor / 2) / divisor;
+}
+
+// Square root rounded to nearest
+static uint32_t window_stats_sqrt_round(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    // value now holds the remainder n - root², round up once it exceeds root (i.e. n > (root + 0.5)²)
+    return (uint32_t)(value > root ? root + 1 : root);
+}
+
+static void window_stats_close(const window_stats_window_t *window, window_stats_result_t *result) {
+    if (window->count == 0) {
+        *result = (window_stats_result_t){
+            .min = WINDOW_STATS_INVALID, .max = WINDOW_STATS_INVALID, .mean = WINDOW_STATS_INVALID,
+        };
+        return;
+    }
+    int64_t n = window->count;
+    // n * variance = sum_sq - sum² / n, with sum² / n split as (sum / n) * sum + (sum % n) * sum / n so that
+    // nothing overflows, whatever the window length
+    int64_t sum_sq_over_n = (window->sum / n) * window->sum + (window->sum % n) * window->sum / n;
+    int64_t scaled_variance = window->sum_sq - sum_sq_over_n;
+    uint64_t variance = scaled_variance > 0 ? (uint64_t)window_stats_div_round(scaled_variance, n) : 0;
+    uint32_t stddev = window_stats_sqrt_round(variance);
+
+    result->min = window->min;
+    result->max = window->max;
+    result->mean = (int16_t)(window->reference + window_stats_div_round(window->sum, n));
+    result->stddev = stddev > UINT16_MAX ? UINT16_MAX : (uint16_t)stddev;
+    result->count = window->count > UINT16_MAX ? UINT16_MAX : (uint16_t)window->count;
+}
+
+uint32_t window_stats_update(window_stats_t *stats, int16_t value, uint32_t now_ms, window_stats_result_t *results) {
+    uint32_t closed = 0;
+    for (int i = 0; i < stats->num; i++) {
+        window_stats_window_t *window = &stats->windows[i];
+        if (!stats->started) {
+            window_stats_start(window, now_ms);
+        } else if (now_ms - window->start_ms >= window->length_ms) {
+            window_stats_close(window, &results[i]);
+            closed |= 1u << i;
+            window_stats_start(window, now_ms);
+        }
+
+        int32_t delta;
+        if (window->count == 0) {
+            window->reference = value;
+            window->min = value;
+            window->max = value;
+            delta = 0;
+        } else {
+            delta = (int32_t)value - window->reference;
+            if (value < window->min) {
+                window->min = value;
+            }
+            if (value > window->max) {
+                window->max = value;
+            }
+        }
+        window->count++;
+        window->sum += delta;
+        window->sum_sq += (int64_t)delta * delta;
+    }
+    stats->started = true;
+    return closed;
+}
@@ -0,0 +1,50 @@
+// window_stats.h
+
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Per-sensor statistics over tumbling windows (e.g. 5 min, 1 h, 24 h) aligned to multiples of their length
+ * in uptime. Each update is integer only and costs the same whatever the window length. Sums are kept
+ * relative to the first sample of the window, so a large mean costs the variance no precision.
+ */
+#define WINDOW_STATS_MAX_WINDOWS    4
+#define WINDOW_STATS_INVALID        ((int16_t)0x8000)   // ZCL invalid s16, a window that closed without samples
+
+// Result of a closed window, all values in centi-degrees Celsius
+typedef struct {
+    int16_t min;
+    int16_t max;
+    int16_t mean;               // Rounded to nearest
+    uint16_t stddev;            // Population standard deviation, rounded to nearest
+    uint16_t count;             // Samples in the window, saturates at UINT16_MAX
+} window_stats_result_t;
+
+typedef struct {
+    uint32_t length_ms;
+    uint32_t start_ms;
+    uint32_t count;
+    int16_t reference;          // First sample of the window
+    int16_t min;
+    int16_t max;
+    int64_t sum;                // Of (value - reference)
+    int64_t sum_sq;             // Of (value - reference)²
+} window_stats_window_t;
+
+typedef struct {
+    window_stats_window_t windows[WINDOW_STATS_MAX_WINDOWS];
+    uint8_t num;
+    bool started;
+} window_stats_t;
+
+// lengths_s: window lengths in seconds, up to WINDOW_STATS_MAX_WINDOWS
+void window_stats_init(window_stats_t *stats, const uint32_t *lengths_s, int num);
+
+/* Feed one sample taken at now_ms. Windows that ended before now_ms are closed first, their results go
+ * to results[window]. Returns a bit mask of the windows that closed.
+ */
+uint32_t window_stats_update(window_stats_t *stats, int16_t value, uint32_t now_ms, window_stats_result_t *results);
+
+#endif // WINDOW_STATS_H
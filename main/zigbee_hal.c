@@ -0,0 +1,141 @@
+// zigbee_hal.c
+
+#include "zigbee_hal.h"
+#include "main.h"
+#include "esp_zigbee_core.h"
+#include "zboss_api.h"
+
+esp_err_t zigbee_hal_set_temperature(uint8_t endpoint, int16_t value) {
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(
+        endpoint,
+        ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+        ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
+        &value,
+        false
+    );
+    return status == ESP_ZB_ZCL_STATUS_SUCCESS ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t zigbee_hal_report_temperature(uint8_t endpoint) {
+    esp_zb_zcl_report_attr_cmd_t report_cmd = {
+        .zcl_basic_cmd.src_endpoint = endpoint,
+        .address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT,  // To the bound coordinator
+        .clusterID = ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+        .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI,
+        .attributeID = ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
+    };
+    esp_zb_zcl_report_attr_cmd_req(&report_cmd);  // Returns the sequence number, the outcome comes with the confirm
+    return ESP_OK;
+}
+
+esp_err_t zigbee_hal_set_manufacturer_attr(uint8_t endpoint, uint16_t attr_id, void *value) {
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_manufacturer_attribute_val(
+        endpoint, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        CUSTOM_MANUFACTURER_CODE, attr_id, value, false);
+    return status == ESP_ZB_ZCL_STATUS_SUCCESS ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t zigbee_hal_report_manufacturer_attr(uint8_t endpoint, uint16_t attr_id, void *value, uint8_t *tsn) {
+    esp_err_t ret = zigbee_hal_set_manufacturer_attr(endpoint, attr_id, value);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    esp_zb_zcl_report_attr_cmd_t report_cmd = {
+        .zcl_basic_cmd.src_endpoint = endpoint,
+        .address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT,  // To the bound coordinator
+        .clusterID = ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+        .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI,
+        .attributeID = attr_id,
+        .manuf_specific = 1,
+        .manuf_code = CUSTOM_MANUFACTURER_CODE,
+    };
+    uint8_t report_tsn = esp_zb_zcl_report_attr_cmd_req(&report_cmd);
+    if (tsn != NULL) {
+        *tsn = report_tsn;
+    }
+    return ESP_OK;
+}
+
+esp_err_t zigbee_hal_set_diagnostics_attr(uint8_t endpoint, uint16_t attr_id, void *value) {
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_manufacturer_attribute_val(
+        endpoint, ESP_ZB_ZCL_CLUSTER_ID_DIAGNOSTICS, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        CUSTOM_MANUFACTURER_CODE, attr_id, value, false);
+    return status == ESP_ZB_ZCL_STATUS_SUCCESS ? ESP_OK : ESP_FAIL;
+}
+
+void zigbee_hal_schedule(zigbee_hal_callback_t callback, uint8_t param, uint32_t delay_ms) {
+    esp_zb_scheduler_alarm(callback, param, delay_ms);
+}
+
+bool zigbee_hal_try_lock(void) {
+    return esp_zb_lock_acquire(0);
+}
+
+void zigbee_hal_unlock(void) {
+    esp_zb_lock_release();
+}
+
+static bool zigbee_hal_get_reporting(uint8_t endpoint, uint16_t manuf_code, uint16_t attr_id, zigbee_hal_reporting_t *reporting) {
+    esp_zb_zcl_attr_location_info_t location = {
+        .endpoint_id = endpoint,
+        .cluster_id = ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+        .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        .manuf_code = manuf_code,
+        .attr_id = attr_id,
+    };
+    esp_zb_zcl_reporting_info_t *info = esp_zb_zcl_find_reporting_info(location);
+    if (info == NULL) {
+        return false;
+    }
+    reporting->min_interval_s = info->u.send_info.min_interval;
+    reporting->max_interval_s = info->u.send_info.max_interval;
+    reporting->delta = info->u.send_info.delta.s16;
+    return true;
+}
+
+bool zigbee_hal_get_temperature_reporting(uint8_t endpoint, zigbee_hal_reporting_t *reporting) {
+    return zigbee_hal_get_reporting(endpoint, ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
+                                    ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID, reporting);
+}
+
+bool zigbee_hal_get_manufacturer_reporting(uint8_t endpoint, uint16_t attr_id, zigbee_hal_reporting_t *reporting) {
+    return zigbee_hal_get_reporting(endpoint, CUSTOM_MANUFACTURER_CODE, attr_id, reporting);
+}
+
+esp_err_t zigbee_hal_read_network_time(uint8_t endpoint) {
+    uint16_t attributes[] = {ESP_ZB_ZCL_ATTR_TIME_TIME_ID};
+    esp_zb_zcl_read_attr_cmd_t read_req = {
+        .zcl_basic_cmd = {
+            .dst_addr_u.addr_short = 0x0000,  // Coordinator
+            .dst_endpoint = ESP_TEMP_TIME_SERVER_ENDPOINT,
+            .src_endpoint = endpoint,
+        },
+        .address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .clusterID = ESP_ZB_ZCL_CLUSTER_ID_TIME,
+        .attr_number = sizeof(attributes) / sizeof(attributes[0]),
+        .attr_field = attributes,
+    };
+    esp_zb_zcl_read_attr_cmd_req(&read_req);
+    return ESP_OK;
+}
+
+esp_err_t zigbee_hal_start_initialization(void) {
+    return esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
+}
+
+esp_err_t zigbee_hal_start_steering(uint32_t channel_mask) {
+    esp_zb_set_primary_network_channel_set(channel_mask);
+    esp_zb_set_secondary_network_channel_set(0);  // Nothing else is scanned when the primary set fails
+    return esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
+}
+
+void zigbee_hal_get_network(uint8_t *channel, uint16_t *pan_id) {
+    *channel = esp_zb_get_current_channel();
+    *pan_id = esp_zb_get_pan_id();
+}
+
+void zigbee_hal_poll_parent(void) {
+    zb_zdo_pim_start_turbo_poll_packets(1);
+}
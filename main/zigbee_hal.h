@@ -0,0 +1,76 @@
+// zigbee_hal.h
+
+#ifndef ZIGBEE_HAL_H
+#define ZIGBEE_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/* Stack operations used by the application logic in sensor_app.c. The sensor and reporting code only sees
+ * these calls, the ESP Zigbee stack stays behind them together with the endpoint setup in main.c, and the host
+ * build (host/) puts a fake attribute table and scheduler behind the same calls.
+ * Must be called from the Zigbee task unless noted otherwise.
+ */
+
+// Write MeasuredValue (centi-degrees) of the Temperature Measurement cluster on endpoint
+esp_err_t zigbee_hal_set_temperature(uint8_t endpoint, int16_t value);
+
+/* The report calls below only queue the command. Whether it reached the coordinator is known from its APS
+ * confirm, which main.c passes to sensor_app_report_sent() with the transaction sequence number.
+ */
+
+// Report MeasuredValue of endpoint to the bound coordinator now, outside of the reporting configuration
+esp_err_t zigbee_hal_report_temperature(uint8_t endpoint);
+
+// Write a manufacturer specific attribute of the Temperature Measurement cluster on endpoint, the stack
+// reports it according to its reporting configuration
+esp_err_t zigbee_hal_set_manufacturer_attr(uint8_t endpoint, uint16_t attr_id, void *value);
+
+// Write a manufacturer specific attribute of the Temperature Measurement cluster on endpoint
+// and report it to the bound coordinator. tsn (may be NULL) receives the sequence number of the report
+esp_err_t zigbee_hal_report_manufacturer_attr(uint8_t endpoint, uint16_t attr_id, void *value, uint8_t *tsn);
+
+// Write a manufacturer specific attribute of the Diagnostics cluster on endpoint
+esp_err_t zigbee_hal_set_diagnostics_attr(uint8_t endpoint, uint16_t attr_id, void *value);
+
+// Callback run by the stack scheduler in the Zigbee task
+typedef void (*zigbee_hal_callback_t)(uint8_t param);
+
+// Run callback in the Zigbee task after delay_ms
+void zigbee_hal_schedule(zigbee_hal_callback_t callback, uint8_t param, uint32_t delay_ms);
+
+// Take the stack lock without waiting, for zigbee_hal_schedule() from another task. Returns false if it is busy
+bool zigbee_hal_try_lock(void);
+void zigbee_hal_unlock(void);
+
+// Reporting configuration the coordinator wrote for an attribute of the Temperature Measurement cluster
+typedef struct {
+    uint16_t min_interval_s;
+    uint16_t max_interval_s;    // 0 or 0xFFFF: no periodic report
+    int16_t delta;              // Reportable change of an s16 attribute
+} zigbee_hal_reporting_t;
+
+// Reporting configuration of MeasuredValue on endpoint, false if reporting was not configured for it
+bool zigbee_hal_get_temperature_reporting(uint8_t endpoint, zigbee_hal_reporting_t *reporting);
+
+// Reporting configuration of a manufacturer specific attribute on endpoint, false if reporting was not configured for it
+bool zigbee_hal_get_manufacturer_reporting(uint8_t endpoint, uint16_t attr_id, zigbee_hal_reporting_t *reporting);
+
+// Read the Time attribute of the coordinator's Time cluster from endpoint, the answer goes to
+// sensor_app_time_response()
+esp_err_t zigbee_hal_read_network_time(uint8_t endpoint);
+
+// Start BDB initialization, the result arrives as the first start or reboot signal
+esp_err_t zigbee_hal_start_initialization(void);
+
+// Start BDB network steering on the channels of channel_mask, the result arrives as the steering signal
+esp_err_t zigbee_hal_start_steering(uint32_t channel_mask);
+
+// Channel and PAN ID of the network the node is on
+void zigbee_hal_get_network(uint8_t *channel, uint16_t *pan_id);
+
+// Poll the parent now, a sleepy end device picks up what the parent buffered for it
+void zigbee_hal_poll_parent(void);
+
+#endif // ZIGBEE_HAL_H
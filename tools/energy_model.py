@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Estimate the battery drain in mAh per day of the sensor node for a few operating modes.
+
+Usage: python3 tools/energy_model.py --awake-ms 40 --probes 2
+       python3 tools/energy_model.py --awake-ms 40 --probes 2 --period 30 --period 300 --capacity 2600
+
+--awake-ms is the CPU time of one sampling cycle without the conversion wait. Take it from the Diagnostics
+cluster: latency_trigger_mean_us + probes * latency_read_mean_us + latency_attr_set_mean_us, or from the
+timestamps of the trace log. The currents default to ESP32-C6 and DS18B20 datasheet typicals, replace them
+with measured values where available.
+"""
+
+import argparse
+
+HOURS_PER_DAY = 24
+
+
+def average_ma(args, period_s, sleepy):
+    """Average current over one sampling period."""
+    period_ms = period_s * 1000.0
+    conversion_ma_ms = args.probes * args.convert_ma * args.conversion_ms
+    tx_ma_ms = args.reports * args.tx_ms * args.tx_ma
+
+    if not sleepy:
+        # rx-on-when-idle: the radio listens all the time and the CPU never sleeps
+        charge = args.rx_ma * period_ms + tx_ma_ms + conversion_ma_ms
+        return charge / period_ms + args.probes * args.standby_ma
+
+    # Sleepy end device: awake for the trigger, the reads and the reports, asleep during the conversion
+    polls = period_ms / args.poll_ms
+    awake_ms = args.awake_ms + args.reports * args.tx_ms
+    poll_ms = polls * args.poll_rx_ms
+    asleep_ms = max(period_ms - awake_ms - poll_ms, 0.0)
+    charge = (args.awake_ms * args.cpu_ma + tx_ma_ms + poll_ms * args.rx_ma
+              + asleep_ms * args.sleep_ma + conversion_ma_ms)
+    return charge / period_ms + args.probes * args.standby_ma
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--awake-ms", type=float, required=True, help="measured CPU time per cycle, ms")
+    parser.add_argument("--probes", type=int, default=2, help="DS18B20 probes on the node")
+    parser.add_argument("--period", type=float, action="append", help="sampling period, s (repeatable)")
+    parser.add_argument("--reports", type=float, default=1.0, help="reports sent per cycle (after the report filter)")
+    parser.add_argument("--conversion-ms", type=float, default=750.0, help="conversion time, 750 ms at 12 bit")
+    parser.add_argument("--poll-ms", type=float, default=7000.0, help="sleepy poll interval (ED_KEEP_ALIVE), ms")
+    parser.add_argument("--poll-rx-ms", type=float, default=5.0, help="radio time per data poll, ms")
+    parser.add_argument("--tx-ms", type=float, default=4.0, help="radio time per report incl. the MAC ACK, ms")
+    parser.add_argument("--cpu-ma", type=float, default=25.0, help="CPU active, radio off, mA")
+    parser.add_argument("--rx-ma", type=float, default=75.0, help="CPU active, radio receiving, mA")
+    parser.add_argument("--tx-ma", type=float, default=80.0, help="radio transmitting at 0 dBm, mA")
+    parser.add_argument("--sleep-ma", type=float, default=0.18, help="light sleep, mA")
+    parser.add_argument("--convert-ma", type=float, default=1.5, help="DS18B20 converting, mA per probe")
+    parser.add_argument("--standby-ma", type=float, default=0.001, help="DS18B20 standby, mA per probe")
+    parser.add_argument("--capacity", type=float, default=2600.0, help="battery capacity for the runtime column, mAh")
+    args = parser.parse_args()
+
+    periods = args.period or [5, 30, 60, 300, 600]
+    print(f"{'mode':<12}{'period':>9}{'avg mA':>10}{'mAh/day':>10}{'days':>9}")
+    for sleepy in (False, True):
+        for period_s in periods:
+            ma = average_ma(args, period_s, sleepy)
+            mah_day = ma * HOURS_PER_DAY
+            print(f"{'sleepy' if sleepy else 'always-on':<12}{period_s:>8g}s{ma:>10.3f}{mah_day:>10.1f}"
+                  f"{args.capacity / mah_day:>9.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Decode the binary trace log printed by trace_log_dump() (main/trace_log.c).
+
+Usage: idf.py monitor | tee monitor.log, write a non-zero value to the trace dump attribute (0x8006) of the
+       first endpoint, e.g. with trace_dump in Zigbee2MQTT, then
+       python3 tools/trace_decode.py monitor.log   (or pipe the log into stdin)
+"""
+
+import re
+import struct
+import sys
+
+RECORD = struct.Struct("<IBBh")  # trace_record_t: time (1.024 ms units), event, sensor, value
+TIME_UNIT_MS = 1.024
+
+# Keep in sync with trace_event_t in main/trace_log.h
+EVENTS = {
+    1: ("sample", lambda v: f"{v / 100:.2f} C"),
+    2: ("read_error", lambda v: f"esp_err 0x{v & 0xFFFF:x}"),
+    3: ("report", lambda v: f"{v / 100:.2f} C"),
+    4: ("resolution", lambda v: f"{v} bit"),
+    5: ("queue_drop", lambda v: f"{v} dropped"),
+    6: ("outlier", lambda v: f"{v / 100:.2f} C rejected"),
+}
+
+HEX_LINE = re.compile(r"^(?:[0-9a-f]{16}\s*)+$")
+# ESP_LOG prefix and colors of a line, e.g. "\x1b[0;32mI (12345) TRACE: ...\x1b[0m"
+LOG_PREFIX = re.compile(r"^(?:\x1b\[[0-9;]*m)?[EWIDV] \(\d+\) TRACE: ")
+LOG_COLOR_END = re.compile(r"\x1b\[0m$")
+
+
+def decode(lines):
+    in_dump = False
+    for line in lines:
+        line = LOG_COLOR_END.sub("", LOG_PREFIX.sub("", line.strip()))
+        begin = re.search(r"TRACE BEGIN (\d+) (\d+)", line)
+        if begin:
+            in_dump = True
+            print(f"# trace version {begin.group(1)}, {begin.group(2)} older record(s) overwritten")
+            continue
+        if "TRACE END" in line:
+            in_dump = False
+            continue
+        if not in_dump or not HEX_LINE.match(line):
+            continue
+        for word in line.split():
+            time, event, sensor, value = RECORD.unpack(bytes.fromhex(word))
+            if event not in EVENTS:
+                continue
+            name, fmt = EVENTS[event]
+            print(f"{time * TIME_UNIT_MS / 1000:12.3f} s  sensor {sensor + 1:2d}  {name:<10s} {fmt(value)}")
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], errors="replace") as f:
+            decode(f)
+    else:
+        decode(sys.stdin)
+
+
+if __name__ == "__main__":
+    main()